@@ -18,6 +18,9 @@
 
 // (You can add your own code in this section, and the Projucer will not overwrite it)
 
+// The standalone app is our own, see Source/PianoMannStandaloneApp.cpp.
+#define JUCE_USE_CUSTOM_PLUGIN_STANDALONE_APP 1
+
 // [END_USER_CODE_SECTION]
 
 /*
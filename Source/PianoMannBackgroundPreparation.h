@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    PianoMannBackgroundPreparation.h
+    Created: 19 Oct 2026 5:02:17pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/**
+ * Runs the expensive part of preparing for a sample rate on a background thread, so the host is
+ * not stalled by it. The work is split into small steps which each publish their own result, so
+ * whatever is done is usable right away and stopping only waits for the step in progress.
+ */
+class PianoMannBackgroundPreparation : private Thread {
+public:
+  using Step = std::function<void()>;
+
+  PianoMannBackgroundPreparation() : Thread("PianoMann preparation") {}
+  ~PianoMannBackgroundPreparation() { stop(); }
+
+  /**
+   * Runs `stepsToRun` in order, abandoning any steps left from a previous start.
+   */
+  void start(std::vector<Step> stepsToRun) {
+    stop();
+    steps = std::move(stepsToRun);
+    isFinished = steps.empty();
+    if (!isFinished) {
+      startThread(3);
+    }
+  }
+
+  /**
+   * Abandons the remaining steps, waiting for the one in progress.
+   */
+  void stop() {
+    stopThread(-1);
+    steps.clear();
+  }
+
+  /**
+   * Whether every step of the last start has run.
+   */
+  bool isPrepared() const { return isFinished.load(); }
+
+private:
+  void run() override {
+    for (auto &step : steps) {
+      if (threadShouldExit()) {
+        return;
+      }
+      step();
+    }
+    isFinished = true;
+  }
+
+  std::vector<Step> steps;
+  std::atomic<bool> isFinished{true};
+};
@@ -0,0 +1,585 @@
+/*
+  ==============================================================================
+
+    PianoMannBenchmarks.cpp
+    Created: 20 Oct 2026 10:02:15am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannBenchmarks.h"
+#include "PianoMannOfflineRenderer.h"
+#include "PianoMannQualityGovernor.h"
+#include "PluginProcessor.h"
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#if JUCE_LINUX
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+/**
+ * Strings keep ringing after the last event of a MIDI file, and that costs as much as playing.
+ */
+constexpr double kTailSeconds = 3.0;
+
+struct TimedMessage {
+  int64 samplePosition;
+  MidiMessage message;
+};
+
+/**
+ * The channel messages of `midi`, whose timestamps are in seconds, by sample.
+ */
+std::vector<TimedMessage> getTimedMessages(const MidiMessageSequence &midi,
+                                           double sampleRate) {
+  std::vector<TimedMessage> messages;
+  for (const auto *holder : midi) {
+    const auto &message = holder->message;
+    if (message.getChannel() == 0) {
+      continue;
+    }
+    messages.push_back(
+        {jmax(int64(0), static_cast<int64>(
+                            std::llround(message.getTimeStamp() * sampleRate))),
+         message});
+  }
+  return messages;
+}
+
+/**
+ * An instance prepared as a host would prepare it, at `qualityTier`, once its strings are built.
+ * Settings that take effect on preparing can be made in `configure`. Returns `nullptr` if
+ * `shouldExit` returned `true` meanwhile.
+ */
+std::unique_ptr<PianoMannAudioProcessor> createProcessor(
+    const PianoMannBenchmarks::Settings &settings, int qualityTier,
+    const std::function<bool()> &shouldExit,
+    const std::function<void(PianoMannAudioProcessor &)> &configure = {}) {
+  auto processor = std::make_unique<PianoMannAudioProcessor>();
+  processor->setPinnedQualityTier(qualityTier);
+  if (configure) {
+    configure(*processor);
+  }
+  processor->setRateAndBufferSizeDetails(settings.sampleRate,
+                                         settings.blockSize);
+  processor->prepareToPlay(settings.sampleRate, settings.blockSize);
+  while (!processor->isBackgroundPreparationFinished()) {
+    if (shouldExit && shouldExit()) {
+      return nullptr;
+    }
+    Thread::sleep(1);
+  }
+  return processor;
+}
+
+struct Timing {
+  int numBlocks = 0;
+  int64 numSamples = 0;
+  double totalSeconds = 0.0;
+  double maxBlockSeconds = 0.0;
+};
+
+/**
+ * Plays `messages` through `processor` a block at a time up to `numSamples`, timing every block.
+ * Copies what it plays into `output` if given, outside the timing.
+ */
+Timing play(PianoMannAudioProcessor &processor,
+            const std::vector<TimedMessage> &messages, int blockSize,
+            int64 numSamples, const std::function<bool()> &shouldExit,
+            AudioBuffer<float> *output = nullptr) {
+  AudioBuffer<float> buffer(jmax(processor.getTotalNumInputChannels(),
+                                 processor.getTotalNumOutputChannels()),
+                            blockSize);
+  if (output != nullptr) {
+    output->setSize(buffer.getNumChannels(),
+                    static_cast<int>((numSamples + blockSize - 1) /
+                                     blockSize * blockSize));
+  }
+  MidiBuffer midi;
+  midi.ensureSize(4096);
+  Timing timing;
+  size_t nextMessage = 0;
+  for (int64 samplePosition = 0; samplePosition < numSamples;
+       samplePosition += blockSize) {
+    if (shouldExit && shouldExit()) {
+      break;
+    }
+    midi.clear();
+    for (; nextMessage < messages.size() &&
+           messages[nextMessage].samplePosition < samplePosition + blockSize;
+         ++nextMessage) {
+      midi.addEvent(messages[nextMessage].message,
+                    static_cast<int>(messages[nextMessage].samplePosition -
+                                     samplePosition));
+    }
+    const auto startTicks = Time::getHighResolutionTicks();
+    processor.processBlock(buffer, midi);
+    const auto seconds = Time::highResolutionTicksToSeconds(
+        Time::getHighResolutionTicks() - startTicks);
+    timing.totalSeconds += seconds;
+    timing.maxBlockSeconds = jmax(timing.maxBlockSeconds, seconds);
+    if (output != nullptr) {
+      for (auto channel = 0; channel < buffer.getNumChannels(); ++channel) {
+        output->copyFrom(channel, static_cast<int>(samplePosition), buffer,
+                         channel, 0, blockSize);
+      }
+    }
+    timing.numSamples += blockSize;
+    ++timing.numBlocks;
+  }
+  return timing;
+}
+
+/**
+ * How fast `timing` ran against real time, and how much of each block period it took.
+ */
+String formatTiming(const Timing &timing, double sampleRate, int blockSize) {
+  if (timing.numBlocks == 0 || timing.totalSeconds <= 0.0) {
+    return "nothing played";
+  }
+  const auto periodSeconds = blockSize / sampleRate;
+  const auto meanBlockSeconds = timing.totalSeconds / timing.numBlocks;
+  return String(static_cast<double>(timing.numSamples) / sampleRate /
+                    timing.totalSeconds,
+                1) +
+         "x real time, blocks took " +
+         String(roundToInt(meanBlockSeconds / periodSeconds * 100.0)) +
+         "% of their period on average and " +
+         String(roundToInt(timing.maxBlockSeconds / periodSeconds * 100.0)) +
+         "% at most";
+}
+
+/**
+ * Counts the last-level cache misses of the calling thread in user space, where the system allows
+ * it: on Linux through `perf_event_open`, if the kernel lets unprivileged processes count.
+ */
+class CacheMissCounter {
+public:
+  CacheMissCounter() {
+#if JUCE_LINUX
+    perf_event_attr attributes{};
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    descriptor = static_cast<int>(
+        syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+  }
+
+  ~CacheMissCounter() {
+#if JUCE_LINUX
+    if (descriptor >= 0) {
+      close(descriptor);
+    }
+#endif
+  }
+
+  bool isAvailable() const { return descriptor >= 0; }
+
+  /**
+   * The misses counted since the counter was created, or -1 if it is not available.
+   */
+  int64 read() const {
+#if JUCE_LINUX
+    uint64_t count = 0;
+    if (descriptor >= 0 &&
+        ::read(descriptor, &count, sizeof(count)) == sizeof(count)) {
+      return static_cast<int64>(count);
+    }
+#endif
+    return -1;
+  }
+
+private:
+  int descriptor = -1;
+
+  JUCE_DECLARE_NON_COPYABLE(CacheMissCounter)
+};
+
+/**
+ * Adds the blocks of `timing` to `total`, for benchmarks that take turns.
+ */
+void addTiming(Timing &total, const Timing &timing) {
+  total.numBlocks += timing.numBlocks;
+  total.numSamples += timing.numSamples;
+  total.totalSeconds += timing.totalSeconds;
+  total.maxBlockSeconds = jmax(total.maxBlockSeconds, timing.maxBlockSeconds);
+}
+
+/**
+ * Reads `Settings::midiFile` into `messages`, and the length to play it for with its tail into
+ * `numSamples`, printing what is about to be played.
+ */
+Result readMidiFile(const PianoMannBenchmarks::Settings &settings,
+                    const PianoMannBenchmarks::PrintLine &printLine,
+                    std::vector<TimedMessage> &messages, int64 &numSamples) {
+  MidiMessageSequence midi;
+  if (!PianoMannOfflineRenderer::readMidiFile(settings.midiFile, midi)) {
+    return Result::fail("Could not read " +
+                        settings.midiFile.getFullPathName());
+  }
+  messages = getTimedMessages(midi, settings.sampleRate);
+  numSamples = (messages.empty() ? 0 : messages.back().samplePosition) +
+               static_cast<int64>(kTailSeconds * settings.sampleRate);
+  printLine(settings.midiFile.getFileName() + ", " +
+            String(static_cast<double>(numSamples) / settings.sampleRate, 1) +
+            " s at " + String(settings.sampleRate) + " Hz in blocks of " +
+            String(settings.blockSize));
+  return Result::ok();
+}
+} // namespace
+
+Result PianoMannBenchmarks::runPedalBenchmark(
+    const Settings &settings, const PrintLine &printLine,
+    const std::function<bool()> &shouldExit) {
+  std::vector<TimedMessage> messages;
+  int64 numSamples = 0;
+  const auto readResult =
+      readMidiFile(settings, printLine, messages, numSamples);
+  if (readResult.failed()) {
+    return readResult;
+  }
+
+  for (auto tier = 0; tier < PianoMannQualityGovernor::kNumTiers; ++tier) {
+    auto processor = createProcessor(settings, tier, shouldExit);
+    if (processor == nullptr) {
+      return Result::fail("Stopped");
+    }
+    if (tier == 0) {
+      printLine(String("DSP kernels: ") + processor->getIsaName());
+    }
+    const auto timing = play(*processor, messages, settings.blockSize,
+                             numSamples, shouldExit);
+    if (shouldExit && shouldExit()) {
+      return Result::fail("Stopped");
+    }
+    const auto stats = processor->getRetirementStats();
+    processor->releaseResources();
+
+    const auto tierSpec = PianoMannQualityGovernor::getTierSpec(tier);
+    const auto retiredPercent =
+        stats.numStrikes > 0
+            ? roundToInt(100.0 * static_cast<double>(stats.numRetiredVoices) /
+                         static_cast<double>(stats.numStrikes))
+            : 0;
+    printLine("tier " + String(tier) + ", at most " +
+              String(tierSpec.maxRingingVoices) + " strings: " +
+              formatTiming(timing, settings.sampleRate, settings.blockSize) +
+              ". " + String(stats.numStrikes) + " strikes, up to " +
+              String(stats.maxRingingVoices) +
+              " strings ringing at once before retiring, " +
+              String(stats.numRetiredVoices) + " retired to make room (" +
+              String(retiredPercent) + "% of strikes)");
+  }
+  return Result::ok();
+}
+
+Result PianoMannBenchmarks::runEditorBenchmark(
+    const Settings &settings, const PrintLine &printLine,
+    const std::function<bool()> &shouldExit) {
+  std::vector<TimedMessage> messages;
+  int64 numSamples = 0;
+  const auto readResult =
+      readMidiFile(settings, printLine, messages, numSamples);
+  if (readResult.failed()) {
+    return readResult;
+  }
+
+  constexpr auto kNumTurns = 3;
+  Timing timings[2];
+  for (auto turn = 0; turn < 2 * kNumTurns; ++turn) {
+    const auto isEditorOpen = turn % 2 == 1;
+    auto processor = createProcessor(settings, 0, shouldExit);
+    if (processor == nullptr) {
+      return Result::fail("Stopped");
+    }
+    if (turn == 0) {
+      printLine(String("DSP kernels: ") + processor->getIsaName());
+    }
+    // What the editor's visualiser and keyboard ask of the processor.
+    if (isEditorOpen) {
+      processor->setVisualiserOpen(true);
+      processor->setKeyboardShown(true);
+    }
+    const auto timing = play(*processor, messages, settings.blockSize,
+                             numSamples, shouldExit);
+    if (shouldExit && shouldExit()) {
+      return Result::fail("Stopped");
+    }
+    if (isEditorOpen) {
+      processor->setKeyboardShown(false);
+      processor->setVisualiserOpen(false);
+    }
+    processor->releaseResources();
+
+    addTiming(timings[isEditorOpen ? 1 : 0], timing);
+  }
+
+  const auto &closed = timings[0];
+  const auto &open = timings[1];
+  printLine("editor closed: " +
+            formatTiming(closed, settings.sampleRate, settings.blockSize));
+  printLine("editor open: " +
+            formatTiming(open, settings.sampleRate, settings.blockSize));
+  if (closed.totalSeconds > 0.0 && closed.numBlocks > 0 &&
+      open.numBlocks > 0) {
+    const auto closedMicroseconds =
+        closed.totalSeconds / closed.numBlocks * 1e6;
+    const auto openMicroseconds = open.totalSeconds / open.numBlocks * 1e6;
+    printLine("opening the editor changed the mean block from " +
+              String(closedMicroseconds, 1) + " to " +
+              String(openMicroseconds, 1) + " us (" +
+              String((openMicroseconds / closedMicroseconds - 1.0) * 100.0, 1) +
+              "%)");
+  }
+  return Result::ok();
+}
+
+Result PianoMannBenchmarks::runAttackBenchmark(
+    const Settings &settings, const PrintLine &printLine,
+    const std::function<bool()> &shouldExit) {
+  std::vector<TimedMessage> messages;
+  int64 numSamples = 0;
+  const auto readResult =
+      readMidiFile(settings, printLine, messages, numSamples);
+  if (readResult.failed()) {
+    return readResult;
+  }
+
+  constexpr auto kNumTurns = 3;
+  Timing timings[2];
+  PianoMannSynthesiser::AttackStats attackStats;
+  for (auto turn = 0; turn < 2 * kNumTurns; ++turn) {
+    const auto isHammered = turn % 2 == 1;
+    auto processor = createProcessor(settings, 0, shouldExit);
+    if (processor == nullptr) {
+      return Result::fail("Stopped");
+    }
+    if (turn == 0) {
+      printLine(String("DSP kernels: ") + processor->getIsaName());
+    }
+    processor->setHammerModelEnabled(isHammered);
+    const auto timing = play(*processor, messages, settings.blockSize,
+                             numSamples, shouldExit);
+    if (shouldExit && shouldExit()) {
+      return Result::fail("Stopped");
+    }
+    const auto stats = processor->getAttackStats();
+    processor->releaseResources();
+
+    addTiming(timings[isHammered ? 1 : 0], timing);
+    attackStats.numHammeredStrikes += stats.numHammeredStrikes;
+    attackStats.numAttackSamples += stats.numAttackSamples;
+  }
+
+  const auto &noise = timings[0];
+  const auto &hammer = timings[1];
+  printLine("struck with noise: " +
+            formatTiming(noise, settings.sampleRate, settings.blockSize));
+  printLine("struck with the hammer: " +
+            formatTiming(hammer, settings.sampleRate, settings.blockSize));
+  if (attackStats.numHammeredStrikes == 0 || hammer.totalSeconds <= 0.0) {
+    return Result::ok();
+  }
+  const auto attackSeconds = hammer.totalSeconds - noise.totalSeconds;
+  const auto numStrikes = static_cast<double>(attackStats.numHammeredStrikes);
+  const auto numAttackSamples =
+      static_cast<double>(attackStats.numAttackSamples);
+  printLine(String(attackStats.numHammeredStrikes / kNumTurns) +
+            " strikes, each in contact for " +
+            String(numAttackSamples / numStrikes / settings.sampleRate * 1e3,
+                   2) +
+            " ms on average");
+  printLine("the attacks cost " + String(attackSeconds / numStrikes * 1e6, 2) +
+            " us a strike over noise, " +
+            String(attackSeconds / numAttackSamples * 1e9, 1) +
+            " ns a sample of attack, " +
+            String(attackSeconds / hammer.totalSeconds * 100.0, 1) +
+            "% of the time with the hammer");
+  return Result::ok();
+}
+
+Result PianoMannBenchmarks::runBlockSizeBenchmark(
+    const Settings &settings, const PrintLine &printLine,
+    const std::function<bool()> &shouldExit) {
+  std::vector<TimedMessage> messages;
+  int64 numSamples = 0;
+  const auto readResult =
+      readMidiFile(settings, printLine, messages, numSamples);
+  if (readResult.failed()) {
+    return readResult;
+  }
+
+  constexpr int kBlockSizes[] = {1,   7,   16,  32,   64,   128,
+                                 256, 480, 512, 1024, 4096, 8192};
+  // The cheapest and the dearest sample, unbuffered and buffered.
+  double minNanoseconds[2] = {std::numeric_limits<double>::max(),
+                              std::numeric_limits<double>::max()};
+  double maxNanoseconds[2] = {};
+  for (const auto blockSize : kBlockSizes) {
+    auto blockSettings = settings;
+    blockSettings.blockSize = blockSize;
+    auto line = "blocks of " + String(blockSize) + ":";
+    for (auto mode = 0; mode < 2; ++mode) {
+      const auto isBuffering = mode == 1;
+      auto processor = createProcessor(
+          blockSettings, 0, shouldExit,
+          [isBuffering](PianoMannAudioProcessor &processorToConfigure) {
+            processorToConfigure.setQuantumBufferingEnabled(isBuffering);
+          });
+      if (processor == nullptr) {
+        return Result::fail("Stopped");
+      }
+      if (blockSize == kBlockSizes[0] && !isBuffering) {
+        printLine(String("DSP kernels: ") + processor->getIsaName());
+      }
+      const auto timing =
+          play(*processor, messages, blockSize, numSamples, shouldExit);
+      if (shouldExit && shouldExit()) {
+        return Result::fail("Stopped");
+      }
+      processor->releaseResources();
+      if (timing.numSamples == 0) {
+        continue;
+      }
+
+      const auto nanoseconds = timing.totalSeconds /
+                               static_cast<double>(timing.numSamples) * 1e9;
+      minNanoseconds[mode] = jmin(minNanoseconds[mode], nanoseconds);
+      maxNanoseconds[mode] = jmax(maxNanoseconds[mode], nanoseconds);
+      line += " " + String(nanoseconds, 1) + " ns a sample" +
+              (isBuffering ? " buffered" : ",");
+    }
+    printLine(line);
+  }
+
+  for (auto mode = 0; mode < 2; ++mode) {
+    if (maxNanoseconds[mode] > 0.0) {
+      const auto spread = maxNanoseconds[mode] / minNanoseconds[mode] - 1.0;
+      printLine(String(mode == 1 ? "buffered" : "unbuffered") +
+                ": the dearest block size cost " + String(spread * 100.0, 1) +
+                "% more a sample than the cheapest");
+    }
+  }
+  return Result::ok();
+}
+
+Result PianoMannBenchmarks::runCompactDelayLineBenchmark(
+    const Settings &settings, const PrintLine &printLine,
+    const std::function<bool()> &shouldExit) {
+  std::vector<TimedMessage> messages;
+  int64 numSamples = 0;
+  const auto readResult =
+      readMidiFile(settings, printLine, messages, numSamples);
+  if (readResult.failed()) {
+    return readResult;
+  }
+
+  constexpr auto kNumTurns = 3;
+  Timing timings[2];
+  int64 cacheMisses[2] = {};
+  AudioBuffer<float> outputs[2];
+  CacheMissCounter cacheMissCounter;
+  for (auto turn = 0; turn < 2 * kNumTurns; ++turn) {
+    const auto isCompact = turn % 2 == 1;
+    auto processor = createProcessor(
+        settings, 0, shouldExit,
+        [isCompact](PianoMannAudioProcessor &processorToConfigure) {
+          processorToConfigure.setCompactDelayLineEnabled(isCompact);
+        });
+    if (processor == nullptr) {
+      return Result::fail("Stopped");
+    }
+    if (turn == 0) {
+      printLine(String("DSP kernels: ") + processor->getIsaName());
+    }
+    // Strikes are seeded alike, so the first turn of each is enough to
+    // compare what they play.
+    const auto cacheMissesBefore = cacheMissCounter.read();
+    const auto timing =
+        play(*processor, messages, settings.blockSize, numSamples, shouldExit,
+             turn < 2 ? &outputs[isCompact ? 1 : 0] : nullptr);
+    const auto cacheMissesAfter = cacheMissCounter.read();
+    if (shouldExit && shouldExit()) {
+      return Result::fail("Stopped");
+    }
+    processor->releaseResources();
+
+    addTiming(timings[isCompact ? 1 : 0], timing);
+    cacheMisses[isCompact ? 1 : 0] += cacheMissesAfter - cacheMissesBefore;
+  }
+
+  const auto formatCacheMisses = [&](int mode) {
+    if (!cacheMissCounter.isAvailable() || timings[mode].numSamples == 0) {
+      return String("cache misses not countable here");
+    }
+    return String(static_cast<double>(cacheMisses[mode]) /
+                      static_cast<double>(timings[mode].numSamples),
+                  2) +
+           " cache misses a sample";
+  };
+  const auto &full = timings[0];
+  const auto &compact = timings[1];
+  printLine("single precision: " +
+            formatTiming(full, settings.sampleRate, settings.blockSize) +
+            ", " + formatCacheMisses(0));
+  printLine("half precision: " +
+            formatTiming(compact, settings.sampleRate, settings.blockSize) +
+            ", " + formatCacheMisses(1));
+  if (full.totalSeconds > 0.0 && full.numBlocks > 0 &&
+      compact.numBlocks > 0) {
+    const auto fullMicroseconds = full.totalSeconds / full.numBlocks * 1e6;
+    const auto compactMicroseconds =
+        compact.totalSeconds / compact.numBlocks * 1e6;
+    printLine("half precision changed the mean block from " +
+              String(fullMicroseconds, 1) + " to " +
+              String(compactMicroseconds, 1) + " us (" +
+              String((compactMicroseconds / fullMicroseconds - 1.0) * 100.0,
+                     1) +
+              "%)");
+  }
+
+  // The error the compact delay line adds, against the signal and full scale.
+  const auto &reference = outputs[0];
+  const auto &rounded = outputs[1];
+  if (reference.getNumSamples() == 0 ||
+      reference.getNumSamples() != rounded.getNumSamples()) {
+    return Result::ok();
+  }
+  auto signalEnergy = 0.0, errorEnergy = 0.0;
+  auto maxError = 0.f;
+  for (auto channel = 0; channel < reference.getNumChannels(); ++channel) {
+    const auto *referenceSamples = reference.getReadPointer(channel);
+    const auto *roundedSamples = rounded.getReadPointer(channel);
+    for (auto sample = 0; sample < reference.getNumSamples(); ++sample) {
+      const auto error = roundedSamples[sample] - referenceSamples[sample];
+      signalEnergy += static_cast<double>(referenceSamples[sample]) *
+                      referenceSamples[sample];
+      errorEnergy += static_cast<double>(error) * error;
+      maxError = jmax(maxError, std::abs(error));
+    }
+  }
+  if (errorEnergy == 0.0) {
+    printLine("noise floor: identical to single precision");
+    return Result::ok();
+  }
+  const auto numValues = static_cast<double>(reference.getNumChannels()) *
+                         reference.getNumSamples();
+  printLine("noise floor: the error peaks at " +
+            String(Decibels::gainToDecibels(maxError, -200.f), 1) +
+            " dBFS, its RMS is " +
+            String(10.0 * std::log10(errorEnergy / numValues), 1) +
+            " dBFS and " +
+            String(10.0 * std::log10(signalEnergy / errorEnergy), 1) +
+            " dB below the signal");
+  return Result::ok();
+}
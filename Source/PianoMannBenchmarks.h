@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    PianoMannBenchmarks.h
+    Created: 20 Oct 2026 10:02:15am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+
+/**
+ * Benchmarks of a single instance, each timing `PianoMannAudioProcessor::processBlock` as a host
+ * would call it, as fast as it will go rather than paced in real time. Where
+ * `PianoMannStressHarness` finds how many instances fit, these measure what one instance costs
+ * and why. Run from the command line of the standalone app, see `PianoMannStandaloneApp.cpp`.
+ *
+ * Each benchmark reports its results a line at a time to `printLine`, and stops early if
+ * `shouldExit` returns `true`.
+ */
+class PianoMannBenchmarks {
+public:
+  struct Settings {
+    double sampleRate = 48000.0;
+    int blockSize = 256;
+    /**
+     * The MIDI file to play, for the benchmarks that play one.
+     */
+    File midiFile;
+  };
+
+  using PrintLine = std::function<void(const String &)>;
+
+  /**
+   * Plays `Settings::midiFile`, meant to be pedal-heavy such as `Benchmarks/PedalHeavy.mid`, at
+   * each quality tier in turn. Reports the cost, and how many strings the pedal left ringing and
+   * how many of them were retired to bound it, see `PianoMannSynthesiser::getRetirementStats`.
+   */
+  static Result runPedalBenchmark(const Settings &settings,
+                                  const PrintLine &printLine,
+                                  const std::function<bool()> &shouldExit);
+
+  /**
+   * Plays `Settings::midiFile` at the top quality tier with the editor closed and then open, taking
+   * turns so that neither gains from a warmer cache or a faster clock. Reports the cost of each
+   * and how much opening the editor added, which should be nothing measurable.
+   */
+  static Result runEditorBenchmark(const Settings &settings,
+                                   const PrintLine &printLine,
+                                   const std::function<bool()> &shouldExit);
+
+  /**
+   * Plays `Settings::midiFile` at the top quality tier with the hammer model off and on, taking
+   * turns like `runEditorBenchmark`. Only the attack pays for the hammer, so the difference is
+   * what the attacks cost over striking with noise. Reports it per strike and per sample of
+   * attack, along with how long the attacks lasted, see `PianoMannSynthesiser::getAttackStats`.
+   */
+  static Result runAttackBenchmark(const Settings &settings,
+                                   const PrintLine &printLine,
+                                   const std::function<bool()> &shouldExit);
+
+  /**
+   * Plays `Settings::midiFile` at the top quality tier in host blocks of every size from 1 to 8192
+   * samples, in place of `Settings::blockSize`, with quantum buffering off and on, see
+   * `PianoMannAudioProcessor::setQuantumBufferingEnabled`. The engine renders in fixed quanta
+   * either way, so the cost of a sample should hardly depend on the block size. Reports it for
+   * each, and how far it spreads.
+   */
+  static Result runBlockSizeBenchmark(const Settings &settings,
+                                      const PrintLine &printLine,
+                                      const std::function<bool()> &shouldExit);
+
+  /**
+   * Plays `Settings::midiFile` at the top quality tier with the delay lines in single and in half
+   * precision, taking turns like `runEditorBenchmark`, see
+   * `PianoMannAudioProcessor::setCompactDelayLineEnabled`. Reports the cost and the cache misses
+   * of each where they can be counted, and the noise floor the half-precision lines add: how far
+   * their output strays from single precision, at most and on average.
+   */
+  static Result
+  runCompactDelayLineBenchmark(const Settings &settings,
+                               const PrintLine &printLine,
+                               const std::function<bool()> &shouldExit);
+};
@@ -10,43 +10,95 @@
 
 #pragma once
 
+#include "PianoMannDspKernels.h"
 #include <JuceHeader.h>
+#include <cmath>
 #include <vector>
 
 /**
- * A Low-pass Butterworth filter processor with compile-time cut-off frequency and order.
+ * A Low-pass Butterworth filter processor. Its sections are designed by `design`, ahead of time or
+ * from precomputed tables, see `PianoMannVoicing`, and the cascade runs through
+ * `PianoMannDspKernels`.
  */
-template <int kCutoffFrequency, int kOrder>
 class PianoMannButterworthLowPassFilter : dsp::ProcessorBase {
-  using IIRFilter = dsp::ProcessorDuplicator<dsp::IIR::Filter<float>,
-                                             dsp::IIR::Coefficients<float>>;
-  std::vector<IIRFilter> filters;
+  PianoMannDspKernels::BiquadCascade cascade;
+  std::vector<PianoMannDspKernels::BiquadState> channelStates;
 
 public:
-  void prepare(const dsp::ProcessSpec &spec) override {
+  static PianoMannDspKernels::BiquadCascade
+  design(float cutoffFrequency, double sampleRate, int order) {
+    jassert((order + 1) / 2 <= PianoMannDspKernels::BiquadCascade::kMaxSections);
     auto coefficientsArrays =
         dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(
-            kCutoffFrequency, spec.sampleRate, kOrder);
-    filters.clear();
-    filters.resize(coefficientsArrays.size());
-
-    auto filterIterator = filters.begin();
-    for (auto &coefficients : coefficientsArrays) {
-      filterIterator->state = coefficients;
-      filterIterator->prepare(spec);
-      ++filterIterator;
+            cutoffFrequency, sampleRate, order);
+    PianoMannDspKernels::BiquadCascade designed;
+    for (auto *coefficients : coefficientsArrays) {
+      // Normalised as b0, b1, [b2,] a1[, a2].
+      const auto *raw = coefficients->getRawCoefficients();
+      const auto section = designed.numSections++;
+      designed.b0[section] = raw[0];
+      designed.b1[section] = raw[1];
+      if (coefficients->getFilterOrder() == 2) {
+        designed.b2[section] = raw[2];
+        designed.a1[section] = raw[3];
+        designed.a2[section] = raw[4];
+      } else {
+        jassert(coefficients->getFilterOrder() == 1);
+        designed.a1[section] = raw[2];
+      }
     }
+    return designed;
+  }
+
+  /**
+   * Switches to the sections of `newCascade`. Sections it shares with the current cascade carry on
+   * from their state, and any others start from silence.
+   */
+  void setCascade(const PianoMannDspKernels::BiquadCascade &newCascade) {
+    for (auto &state : channelStates) {
+      for (auto section = cascade.numSections; section < newCascade.numSections;
+           ++section) {
+        state.s1[section] = 0.f;
+        state.s2[section] = 0.f;
+      }
+    }
+    cascade = newCascade;
+  }
+
+  void prepare(const dsp::ProcessSpec &spec) override {
+    channelStates.assign(spec.numChannels, {});
   }
 
   void process(const dsp::ProcessContextReplacing<float> &context) override {
-    for (auto &filter : filters) {
-      filter.process(context);
+    auto &block = context.getOutputBlock();
+    const auto &kernels = PianoMannDspKernels::getKernels();
+    const auto numChannels =
+        jmin(block.getNumChannels(), channelStates.size());
+    for (size_t channel = 0; channel < numChannels; ++channel) {
+      auto &state = channelStates[channel];
+      kernels.processBiquadCascade(cascade, state,
+                                   block.getChannelPointer(channel),
+                                   static_cast<int>(block.getNumSamples()));
+      snapToZero(state);
     }
   }
 
   void reset() override {
-    for (auto &filter : filters) {
-      filter.reset();
+    std::fill(channelStates.begin(), channelStates.end(),
+              PianoMannDspKernels::BiquadState{});
+  }
+
+private:
+  /**
+   * Keeps a decaying tail from turning into denormals.
+   */
+  void snapToZero(PianoMannDspKernels::BiquadState &state) const {
+    for (auto section = 0; section < cascade.numSections; ++section) {
+      for (auto *value : {&state.s1[section], &state.s2[section]}) {
+        if (std::abs(*value) < 1.0e-8f) {
+          *value = 0.f;
+        }
+      }
     }
   }
 };
@@ -0,0 +1,777 @@
+/*
+  ==============================================================================
+
+    PianoMannDspKernels.cpp
+    Created: 19 Oct 2026 9:52:07pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannDspKernels.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if JUCE_INTEL
+#if JUCE_MSVC
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// MSVC accepts intrinsics for any instruction set anywhere, while GCC and
+// Clang need each function to declare the instruction sets it uses.
+#if JUCE_MSVC
+#define PIANOMANN_TARGET(isa)
+#else
+#define PIANOMANN_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace PianoMannDspKernels {
+namespace {
+//==============================================================================
+float addToChannelsScalar(const float *source, float *const *destinations,
+                          int numChannels, int destinationOffset,
+                          int numSamples) {
+  auto peak = 0.f;
+  for (auto index = 0; index < numSamples; ++index) {
+    peak = jmax(peak, std::abs(source[index]));
+  }
+  for (auto channel = 0; channel < numChannels; ++channel) {
+    auto *destination = destinations[channel] + destinationOffset;
+    for (auto index = 0; index < numSamples; ++index) {
+      destination[index] += source[index];
+    }
+  }
+  return peak;
+}
+
+void renderStringScalar(StringLoop &loop, float filterFactor, float decay,
+                        float *output, int numSamples) {
+  auto *delayLine = loop.delayLine;
+  const auto delayLineSize = loop.delayLineSize;
+  const auto allpassCoefficient = loop.allpassCoefficient;
+  auto position = loop.position;
+  auto allpassInput = loop.allpassInput, allpassOutput = loop.allpassOutput;
+  const auto currentWeight = 1 - filterFactor;
+  for (auto index = 0; index < numSamples; ++index) {
+    const auto nextPosition = position + 1 == delayLineSize ? 0 : position + 1;
+    const auto delayed = delayLine[nextPosition];
+    allpassOutput = allpassCoefficient * (delayed - allpassOutput) + allpassInput;
+    allpassInput = delayed;
+    delayLine[nextPosition] = decay * (filterFactor * allpassOutput +
+                                       currentWeight * delayLine[position]);
+    output[index] = delayLine[position];
+    position = nextPosition;
+  }
+  loop.position = position;
+  loop.allpassInput = allpassInput;
+  loop.allpassOutput = allpassOutput;
+}
+
+void renderCompactStringScalar(CompactStringLoop &loop, float filterFactor,
+                               float decay, float *output, int numSamples) {
+  auto *delayLine = loop.delayLine;
+  const auto delayLineSize = loop.delayLineSize;
+  const auto allpassCoefficient = loop.allpassCoefficient;
+  auto position = loop.position;
+  auto allpassInput = loop.allpassInput, allpassOutput = loop.allpassOutput;
+  const auto currentWeight = 1 - filterFactor;
+  // The sample just stored is carried over as it was rounded, so the loop
+  // goes on the same however it is split into calls.
+  auto current = halfToFloat(delayLine[position]);
+  for (auto index = 0; index < numSamples; ++index) {
+    const auto nextPosition = position + 1 == delayLineSize ? 0 : position + 1;
+    const auto delayed = halfToFloat(delayLine[nextPosition]);
+    allpassOutput = allpassCoefficient * (delayed - allpassOutput) + allpassInput;
+    allpassInput = delayed;
+    const auto stored = floatToHalf(
+        decay * (filterFactor * allpassOutput + currentWeight * current));
+    delayLine[nextPosition] = stored;
+    output[index] = current;
+    current = halfToFloat(stored);
+    position = nextPosition;
+  }
+  loop.position = position;
+  loop.allpassInput = allpassInput;
+  loop.allpassOutput = allpassOutput;
+}
+
+void floatsToHalvesScalar(const float *source, uint16 *destination,
+                          int numSamples) {
+  for (auto index = 0; index < numSamples; ++index) {
+    destination[index] = floatToHalf(source[index]);
+  }
+}
+
+void halvesToFloatsScalar(const uint16 *source, float *destination,
+                          int numSamples) {
+  for (auto index = 0; index < numSamples; ++index) {
+    destination[index] = halfToFloat(source[index]);
+  }
+}
+
+void generateNoiseScalar(uint32 key, uint32 counter, float *output,
+                         int numSamples) {
+  for (auto index = 0; index < numSamples; ++index) {
+    output[index] =
+        hashToSample(hash(key + counter + static_cast<uint32>(index)));
+  }
+}
+
+void processBiquadCascadeScalar(const BiquadCascade &cascade,
+                                BiquadState &state, float *samples,
+                                int numSamples) {
+  for (auto section = 0; section < cascade.numSections; ++section) {
+    const auto b0 = cascade.b0[section], b1 = cascade.b1[section],
+               b2 = cascade.b2[section], a1 = cascade.a1[section],
+               a2 = cascade.a2[section];
+    auto s1 = state.s1[section], s2 = state.s2[section];
+    for (auto index = 0; index < numSamples; ++index) {
+      const auto input = samples[index];
+      const auto output = b0 * input + s1;
+      s1 = b1 * input - a1 * output + s2;
+      s2 = b2 * input - a2 * output;
+      samples[index] = output;
+    }
+    state.s1[section] = s1;
+    state.s2[section] = s2;
+  }
+}
+
+//==============================================================================
+// The vector cascades run as a wavefront: lane `k` holds section `k` of a
+// group, and at step `t` filters sample `t - k`, taking its input from the
+// output of lane `k - 1` at the step before. A group of `g` sections takes
+// `numSamples + g - 1` steps. While the wavefront fills and drains, the lanes
+// without a sample keep their state.
+
+#if JUCE_INTEL
+PIANOMANN_TARGET("sse2")
+float addToChannelsSse2(const float *source, float *const *destinations,
+                        int numChannels, int destinationOffset,
+                        int numSamples) {
+  const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  auto peaks = _mm_setzero_ps();
+  auto index = 0;
+  for (; index + 4 <= numSamples; index += 4) {
+    const auto samples = _mm_loadu_ps(source + index);
+    peaks = _mm_max_ps(peaks, _mm_and_ps(samples, absMask));
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      auto *destination = destinations[channel] + destinationOffset + index;
+      _mm_storeu_ps(destination,
+                    _mm_add_ps(_mm_loadu_ps(destination), samples));
+    }
+  }
+  peaks = _mm_max_ps(peaks, _mm_shuffle_ps(peaks, peaks, _MM_SHUFFLE(1, 0, 3, 2)));
+  peaks = _mm_max_ps(peaks, _mm_shuffle_ps(peaks, peaks, _MM_SHUFFLE(2, 3, 0, 1)));
+  auto peak = _mm_cvtss_f32(peaks);
+  for (; index < numSamples; ++index) {
+    peak = jmax(peak, std::abs(source[index]));
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      destinations[channel][destinationOffset + index] += source[index];
+    }
+  }
+  return peak;
+}
+
+PIANOMANN_TARGET("sse2")
+void processBiquadCascadeSse2(const BiquadCascade &cascade, BiquadState &state,
+                              float *samples, int numSamples) {
+  constexpr int kNumLanes = 4;
+  const auto laneIndices = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+  alignas(16) float outputs[kNumLanes];
+  for (auto first = 0; first < cascade.numSections; first += kNumLanes) {
+    const auto numGroupSections = jmin(kNumLanes, cascade.numSections - first);
+    const auto b0 = _mm_load_ps(cascade.b0 + first);
+    const auto b1 = _mm_load_ps(cascade.b1 + first);
+    const auto b2 = _mm_load_ps(cascade.b2 + first);
+    const auto a1 = _mm_load_ps(cascade.a1 + first);
+    const auto a2 = _mm_load_ps(cascade.a2 + first);
+    auto s1 = _mm_load_ps(state.s1 + first);
+    auto s2 = _mm_load_ps(state.s2 + first);
+    auto output = _mm_setzero_ps();
+
+    const auto lastLane = numGroupSections - 1;
+    for (auto step = 0; step < numSamples + lastLane; ++step) {
+      const auto sample = step < numSamples ? samples[step] : 0.f;
+      auto input =
+          _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(output), 4));
+      input = _mm_move_ss(input, _mm_set_ss(sample));
+
+      output = _mm_add_ps(_mm_mul_ps(b0, input), s1);
+      const auto nextS1 = _mm_add_ps(
+          _mm_sub_ps(_mm_mul_ps(b1, input), _mm_mul_ps(a1, output)), s2);
+      const auto nextS2 =
+          _mm_sub_ps(_mm_mul_ps(b2, input), _mm_mul_ps(a2, output));
+      if (step >= lastLane && step < numSamples) {
+        s1 = nextS1;
+        s2 = nextS2;
+      } else {
+        const auto isActive = _mm_and_ps(
+            _mm_cmple_ps(laneIndices, _mm_set1_ps(static_cast<float>(step))),
+            _mm_cmpgt_ps(laneIndices,
+                         _mm_set1_ps(static_cast<float>(step - numSamples))));
+        s1 = _mm_or_ps(_mm_and_ps(isActive, nextS1), _mm_andnot_ps(isActive, s1));
+        s2 = _mm_or_ps(_mm_and_ps(isActive, nextS2), _mm_andnot_ps(isActive, s2));
+      }
+
+      if (step >= lastLane) {
+        _mm_store_ps(outputs, output);
+        samples[step - lastLane] = outputs[lastLane];
+      }
+    }
+    _mm_store_ps(state.s1 + first, s1);
+    _mm_store_ps(state.s2 + first, s2);
+  }
+}
+
+//==============================================================================
+PIANOMANN_TARGET("avx2,fma")
+float addToChannelsAvx2(const float *source, float *const *destinations,
+                        int numChannels, int destinationOffset,
+                        int numSamples) {
+  const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  auto peaks = _mm256_setzero_ps();
+  auto index = 0;
+  for (; index + 8 <= numSamples; index += 8) {
+    const auto samples = _mm256_loadu_ps(source + index);
+    peaks = _mm256_max_ps(peaks, _mm256_and_ps(samples, absMask));
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      auto *destination = destinations[channel] + destinationOffset + index;
+      _mm256_storeu_ps(destination,
+                       _mm256_add_ps(_mm256_loadu_ps(destination), samples));
+    }
+  }
+  auto halfPeaks = _mm_max_ps(_mm256_castps256_ps128(peaks),
+                              _mm256_extractf128_ps(peaks, 1));
+  halfPeaks = _mm_max_ps(halfPeaks, _mm_movehl_ps(halfPeaks, halfPeaks));
+  halfPeaks = _mm_max_ss(halfPeaks, _mm_shuffle_ps(halfPeaks, halfPeaks, 1));
+  auto peak = _mm_cvtss_f32(halfPeaks);
+  for (; index < numSamples; ++index) {
+    peak = jmax(peak, std::abs(source[index]));
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      destinations[channel][destinationOffset + index] += source[index];
+    }
+  }
+  return peak;
+}
+
+/**
+ * The string loop depends on the previous sample, so it cannot be spread across lanes. Fusing the
+ * multiplies and adds of the allpass and the filter still shortens that dependency.
+ */
+PIANOMANN_TARGET("avx2,fma")
+void renderStringFma(StringLoop &loop, float filterFactor, float decay,
+                     float *output, int numSamples) {
+  auto *delayLine = loop.delayLine;
+  const auto delayLineSize = loop.delayLineSize;
+  const auto allpassCoefficients = _mm_set_ss(loop.allpassCoefficient);
+  auto position = loop.position;
+  auto allpassInput = _mm_set_ss(loop.allpassInput);
+  auto allpassOutput = _mm_set_ss(loop.allpassOutput);
+  const auto filterFactors = _mm_set_ss(filterFactor);
+  const auto currentWeight = 1 - filterFactor;
+  for (auto index = 0; index < numSamples; ++index) {
+    const auto nextPosition = position + 1 == delayLineSize ? 0 : position + 1;
+    const auto delayed = _mm_set_ss(delayLine[nextPosition]);
+    allpassOutput = _mm_fmadd_ss(allpassCoefficients,
+                                 _mm_sub_ss(delayed, allpassOutput), allpassInput);
+    allpassInput = delayed;
+    const auto filtered =
+        _mm_fmadd_ss(filterFactors, allpassOutput,
+                     _mm_set_ss(currentWeight * delayLine[position]));
+    delayLine[nextPosition] = decay * _mm_cvtss_f32(filtered);
+    output[index] = delayLine[position];
+    position = nextPosition;
+  }
+  loop.position = position;
+  loop.allpassInput = _mm_cvtss_f32(allpassInput);
+  loop.allpassOutput = _mm_cvtss_f32(allpassOutput);
+}
+
+/**
+ * Reads and writes of the delay line are a period apart, so a vector of samples read ahead of the
+ * loop is never written before the loop has read it, and the samples written can be stored a
+ * vector at a time. Each sample is still rounded as it is computed, since the next one depends on
+ * it.
+ */
+PIANOMANN_TARGET("avx2,fma,f16c")
+void renderCompactStringF16c(CompactStringLoop &loop, float filterFactor,
+                             float decay, float *output, int numSamples) {
+  constexpr int kNumLanes = 8;
+  auto *delayLine = loop.delayLine;
+  const auto delayLineSize = loop.delayLineSize;
+  const auto allpassCoefficients = _mm_set_ss(loop.allpassCoefficient);
+  auto position = loop.position;
+  auto allpassInput = _mm_set_ss(loop.allpassInput);
+  auto allpassOutput = _mm_set_ss(loop.allpassOutput);
+  const auto filterFactors = _mm_set_ss(filterFactor);
+  const auto currentWeights = _mm_set_ss(1 - filterFactor);
+  const auto decays = _mm_set_ss(decay);
+  auto current = _mm_cvtph_ps(_mm_cvtsi32_si128(delayLine[position]));
+  auto stored = _mm_setzero_si128();
+
+  alignas(32) float delayedSamples[kNumLanes], storedSamples[kNumLanes];
+  for (auto index = 0; index < numSamples;) {
+    // Whole vectors up to the end of the line, then a sample over the wrap.
+    const auto isVector = index + kNumLanes <= numSamples &&
+                          position + kNumLanes < delayLineSize;
+    const auto numStepSamples = isVector ? kNumLanes : 1;
+    const auto nextPosition = position + 1 == delayLineSize ? 0 : position + 1;
+    auto *next = delayLine + nextPosition;
+    if (isVector) {
+      _mm256_store_ps(delayedSamples,
+                      _mm256_cvtph_ps(_mm_loadu_si128(
+                          reinterpret_cast<const __m128i *>(next))));
+    } else {
+      delayedSamples[0] = _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(*next)));
+    }
+    for (auto lane = 0; lane < numStepSamples; ++lane) {
+      const auto delayed = _mm_set_ss(delayedSamples[lane]);
+      allpassOutput = _mm_fmadd_ss(
+          allpassCoefficients, _mm_sub_ss(delayed, allpassOutput), allpassInput);
+      allpassInput = delayed;
+      const auto filtered = _mm_fmadd_ss(filterFactors, allpassOutput,
+                                         _mm_mul_ss(currentWeights, current));
+      stored = _mm_cvtps_ph(_mm_mul_ss(decays, filtered),
+                            _MM_FROUND_TO_NEAREST_INT);
+      output[index + lane] = _mm_cvtss_f32(current);
+      current = _mm_cvtph_ps(stored);
+      storedSamples[lane] = _mm_cvtss_f32(current);
+    }
+    if (isVector) {
+      // Already rounded, so converting them back is exact.
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(next),
+                       _mm256_cvtps_ph(_mm256_load_ps(storedSamples),
+                                       _MM_FROUND_TO_NEAREST_INT));
+    } else {
+      *next = static_cast<uint16>(_mm_extract_epi16(stored, 0));
+    }
+    position = nextPosition + numStepSamples - 1;
+    index += numStepSamples;
+  }
+  loop.position = position;
+  loop.allpassInput = _mm_cvtss_f32(allpassInput);
+  loop.allpassOutput = _mm_cvtss_f32(allpassOutput);
+}
+
+PIANOMANN_TARGET("avx2,fma,f16c")
+void floatsToHalvesF16c(const float *source, uint16 *destination,
+                        int numSamples) {
+  auto index = 0;
+  for (; index + 8 <= numSamples; index += 8) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + index),
+                     _mm256_cvtps_ph(_mm256_loadu_ps(source + index),
+                                     _MM_FROUND_TO_NEAREST_INT));
+  }
+  floatsToHalvesScalar(source + index, destination + index,
+                       numSamples - index);
+}
+
+PIANOMANN_TARGET("avx2,fma,f16c")
+void halvesToFloatsF16c(const uint16 *source, float *destination,
+                        int numSamples) {
+  auto index = 0;
+  for (; index + 8 <= numSamples; index += 8) {
+    _mm256_storeu_ps(destination + index,
+                     _mm256_cvtph_ps(_mm_loadu_si128(
+                         reinterpret_cast<const __m128i *>(source + index))));
+  }
+  halvesToFloatsScalar(source + index, destination + index,
+                       numSamples - index);
+}
+
+PIANOMANN_TARGET("avx2,fma")
+void generateNoiseAvx2(uint32 key, uint32 counter, float *output,
+                       int numSamples) {
+  const auto firstMultiplier = _mm256_set1_epi32(0x7feb352d);
+  const auto secondMultiplier = _mm256_set1_epi32(static_cast<int>(0x846ca68bu));
+  const auto scale = _mm256_set1_ps(1.f / 2147483648.f);
+  auto values = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(key + counter)),
+                                 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  auto index = 0;
+  for (; index + 8 <= numSamples; index += 8) {
+    auto hashed = _mm256_xor_si256(values, _mm256_srli_epi32(values, 16));
+    hashed = _mm256_mullo_epi32(hashed, firstMultiplier);
+    hashed = _mm256_xor_si256(hashed, _mm256_srli_epi32(hashed, 15));
+    hashed = _mm256_mullo_epi32(hashed, secondMultiplier);
+    hashed = _mm256_xor_si256(hashed, _mm256_srli_epi32(hashed, 16));
+    _mm256_storeu_ps(output + index,
+                     _mm256_mul_ps(_mm256_cvtepi32_ps(hashed), scale));
+    values = _mm256_add_epi32(values, _mm256_set1_epi32(8));
+  }
+  generateNoiseScalar(key, counter + static_cast<uint32>(index),
+                      output + index, numSamples - index);
+}
+
+PIANOMANN_TARGET("avx2,fma")
+void processBiquadCascadeAvx2(const BiquadCascade &cascade, BiquadState &state,
+                              float *samples, int numSamples) {
+  constexpr int kNumLanes = 8;
+  const auto laneIndices =
+      _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+  const auto shiftUp = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+  alignas(32) float outputs[kNumLanes];
+  for (auto first = 0; first < cascade.numSections; first += kNumLanes) {
+    const auto numGroupSections = jmin(kNumLanes, cascade.numSections - first);
+    const auto b0 = _mm256_load_ps(cascade.b0 + first);
+    const auto b1 = _mm256_load_ps(cascade.b1 + first);
+    const auto b2 = _mm256_load_ps(cascade.b2 + first);
+    const auto a1 = _mm256_load_ps(cascade.a1 + first);
+    const auto a2 = _mm256_load_ps(cascade.a2 + first);
+    auto s1 = _mm256_load_ps(state.s1 + first);
+    auto s2 = _mm256_load_ps(state.s2 + first);
+    auto output = _mm256_setzero_ps();
+
+    const auto lastLane = numGroupSections - 1;
+    for (auto step = 0; step < numSamples + lastLane; ++step) {
+      const auto sample = step < numSamples ? samples[step] : 0.f;
+      const auto input = _mm256_blend_ps(
+          _mm256_permutevar8x32_ps(output, shiftUp), _mm256_set1_ps(sample), 1);
+
+      output = _mm256_fmadd_ps(b0, input, s1);
+      const auto nextS1 =
+          _mm256_fmadd_ps(b1, input, _mm256_fnmadd_ps(a1, output, s2));
+      const auto nextS2 =
+          _mm256_fnmadd_ps(a2, output, _mm256_mul_ps(b2, input));
+      if (step >= lastLane && step < numSamples) {
+        s1 = nextS1;
+        s2 = nextS2;
+      } else {
+        const auto isActive = _mm256_and_ps(
+            _mm256_cmp_ps(laneIndices, _mm256_set1_ps(static_cast<float>(step)),
+                          _CMP_LE_OQ),
+            _mm256_cmp_ps(laneIndices,
+                          _mm256_set1_ps(static_cast<float>(step - numSamples)),
+                          _CMP_GT_OQ));
+        s1 = _mm256_blendv_ps(s1, nextS1, isActive);
+        s2 = _mm256_blendv_ps(s2, nextS2, isActive);
+      }
+
+      if (step >= lastLane) {
+        _mm256_store_ps(outputs, output);
+        samples[step - lastLane] = outputs[lastLane];
+      }
+    }
+    _mm256_store_ps(state.s1 + first, s1);
+    _mm256_store_ps(state.s2 + first, s2);
+  }
+}
+
+//==============================================================================
+PIANOMANN_TARGET("avx512f,avx2,fma")
+float addToChannelsAvx512(const float *source, float *const *destinations,
+                          int numChannels, int destinationOffset,
+                          int numSamples) {
+  auto peaks = _mm512_setzero_ps();
+  for (auto index = 0; index < numSamples; index += 16) {
+    // The last vector is masked rather than finished one sample at a time.
+    const auto numLanes = jmin(16, numSamples - index);
+    const auto mask = static_cast<__mmask16>((1u << numLanes) - 1);
+    const auto samples = _mm512_maskz_loadu_ps(mask, source + index);
+    peaks = _mm512_max_ps(peaks, _mm512_abs_ps(samples));
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      auto *destination = destinations[channel] + destinationOffset + index;
+      _mm512_mask_storeu_ps(
+          destination, mask,
+          _mm512_add_ps(_mm512_maskz_loadu_ps(mask, destination), samples));
+    }
+  }
+  return _mm512_reduce_max_ps(peaks);
+}
+
+PIANOMANN_TARGET("avx512f,avx2,fma")
+void generateNoiseAvx512(uint32 key, uint32 counter, float *output,
+                         int numSamples) {
+  const auto firstMultiplier = _mm512_set1_epi32(0x7feb352d);
+  const auto secondMultiplier = _mm512_set1_epi32(static_cast<int>(0x846ca68bu));
+  const auto scale = _mm512_set1_ps(1.f / 2147483648.f);
+  auto values = _mm512_add_epi32(
+      _mm512_set1_epi32(static_cast<int>(key + counter)),
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+  for (auto index = 0; index < numSamples; index += 16) {
+    const auto numLanes = jmin(16, numSamples - index);
+    const auto mask = static_cast<__mmask16>((1u << numLanes) - 1);
+    auto hashed = _mm512_xor_si512(values, _mm512_srli_epi32(values, 16));
+    hashed = _mm512_mullo_epi32(hashed, firstMultiplier);
+    hashed = _mm512_xor_si512(hashed, _mm512_srli_epi32(hashed, 15));
+    hashed = _mm512_mullo_epi32(hashed, secondMultiplier);
+    hashed = _mm512_xor_si512(hashed, _mm512_srli_epi32(hashed, 16));
+    _mm512_mask_storeu_ps(output + index, mask,
+                          _mm512_mul_ps(_mm512_cvtepi32_ps(hashed), scale));
+    values = _mm512_add_epi32(values, _mm512_set1_epi32(16));
+  }
+}
+
+PIANOMANN_TARGET("avx512f,avx2,fma")
+void processBiquadCascadeAvx512(const BiquadCascade &cascade,
+                                BiquadState &state, float *samples,
+                                int numSamples) {
+  constexpr int kNumLanes = 16;
+  static_assert(BiquadCascade::kMaxSections == kNumLanes,
+                "The whole cascade fits in one vector");
+  if (cascade.numSections == 0) {
+    return;
+  }
+  const auto shiftUp = _mm512_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                         11, 12, 13, 14);
+  alignas(64) float outputs[kNumLanes];
+  const auto b0 = _mm512_load_ps(cascade.b0);
+  const auto b1 = _mm512_load_ps(cascade.b1);
+  const auto b2 = _mm512_load_ps(cascade.b2);
+  const auto a1 = _mm512_load_ps(cascade.a1);
+  const auto a2 = _mm512_load_ps(cascade.a2);
+  auto s1 = _mm512_load_ps(state.s1);
+  auto s2 = _mm512_load_ps(state.s2);
+  auto output = _mm512_setzero_ps();
+
+  const auto lastLane = cascade.numSections - 1;
+  for (auto step = 0; step < numSamples + lastLane; ++step) {
+    const auto sample = step < numSamples ? samples[step] : 0.f;
+    const auto input = _mm512_mask_mov_ps(_mm512_permutexvar_ps(shiftUp, output),
+                                          1, _mm512_set1_ps(sample));
+
+    output = _mm512_fmadd_ps(b0, input, s1);
+    const auto nextS1 =
+        _mm512_fmadd_ps(b1, input, _mm512_fnmadd_ps(a1, output, s2));
+    const auto nextS2 = _mm512_fnmadd_ps(a2, output, _mm512_mul_ps(b2, input));
+    // Lanes `step - numSamples < k <= step` have a sample.
+    const auto upToStep = step >= kNumLanes - 1 ? 0xffffu : (2u << step) - 1;
+    const auto beforeEnd =
+        step < numSamples ? 0u : (2u << jmin(step - numSamples, kNumLanes - 1)) - 1;
+    const auto isActive = static_cast<__mmask16>(upToStep & ~beforeEnd);
+    s1 = _mm512_mask_mov_ps(s1, isActive, nextS1);
+    s2 = _mm512_mask_mov_ps(s2, isActive, nextS2);
+
+    if (step >= lastLane) {
+      _mm512_store_ps(outputs, output);
+      samples[step - lastLane] = outputs[lastLane];
+    }
+  }
+  _mm512_store_ps(state.s1, s1);
+  _mm512_store_ps(state.s2, s2);
+}
+
+//==============================================================================
+void getCpuid(int leaf, uint32 registers[4]) {
+#if JUCE_MSVC
+  int values[4];
+  __cpuidex(values, leaf, 0);
+  for (auto index = 0; index < 4; ++index) {
+    registers[index] = static_cast<uint32>(values[index]);
+  }
+#else
+  __cpuid_count(leaf, 0, registers[0], registers[1], registers[2],
+                registers[3]);
+#endif
+}
+
+/**
+ * Which register states the operating system saves on context switches. Only valid if the CPU
+ * reports OSXSAVE.
+ */
+uint64 getEnabledRegisterStates() {
+#if JUCE_MSVC
+  return _xgetbv(0);
+#else
+  uint32 low, high;
+  __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+  return (static_cast<uint64>(high) << 32) | low;
+#endif
+}
+#endif
+
+//==============================================================================
+const Kernels kScalarKernels{Isa::kScalar,
+                             addToChannelsScalar,
+                             renderStringScalar,
+                             renderCompactStringScalar,
+                             floatsToHalvesScalar,
+                             halvesToFloatsScalar,
+                             generateNoiseScalar,
+                             processBiquadCascadeScalar};
+#if JUCE_INTEL
+// Scalar code already runs on SSE2 on every x86 target we build for. SSE2
+// has no 32-bit multiply for the noise hash, nor half-precision conversions.
+const Kernels kSse2Kernels{Isa::kSse2,
+                           addToChannelsSse2,
+                           renderStringScalar,
+                           renderCompactStringScalar,
+                           floatsToHalvesScalar,
+                           halvesToFloatsScalar,
+                           generateNoiseScalar,
+                           processBiquadCascadeSse2};
+const Kernels kAvx2Kernels{Isa::kAvx2,
+                           addToChannelsAvx2,
+                           renderStringFma,
+                           renderCompactStringF16c,
+                           floatsToHalvesF16c,
+                           halvesToFloatsF16c,
+                           generateNoiseAvx2,
+                           processBiquadCascadeAvx2};
+// The half-precision conversions of AVX-512 need AVX-512BW for storing 16-bit
+// lanes with a mask, so AVX2 ones do.
+const Kernels kAvx512Kernels{Isa::kAvx512,
+                             addToChannelsAvx512,
+                             renderStringFma,
+                             renderCompactStringF16c,
+                             floatsToHalvesF16c,
+                             halvesToFloatsF16c,
+                             generateNoiseAvx512,
+                             processBiquadCascadeAvx512};
+#endif
+
+/**
+ * Reads `PIANOMANN_ISA`, defaulting to the best supported instruction set.
+ */
+Isa getRequestedIsa() {
+  const auto name =
+      SystemStats::getEnvironmentVariable("PIANOMANN_ISA", {}).trim();
+  for (auto isa : {Isa::kScalar, Isa::kSse2, Isa::kAvx2, Isa::kAvx512}) {
+    if (name.equalsIgnoreCase(getIsaName(isa))) {
+      return isa;
+    }
+  }
+  jassert(name.isEmpty());
+  return getBestSupportedIsa();
+}
+
+/**
+ * Constant-initialized, so the audio thread reads it without any guard.
+ */
+std::atomic<const Kernels *> selectedKernels{&kScalarKernels};
+} // namespace
+
+uint16 floatToHalf(float value) {
+  uint32 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const auto sign = static_cast<uint16>((bits >> 16) & 0x8000u);
+  auto magnitude = bits & 0x7fffffffu;
+  if (magnitude >= 0x7f800000u) {
+    // Infinity stays infinite and NaN stays a quiet NaN.
+    return static_cast<uint16>(
+        sign | 0x7c00u |
+        (magnitude > 0x7f800000u ? 0x200u | ((magnitude >> 13) & 0x3ffu) : 0u));
+  }
+  if (magnitude >= 0x477ff000u) {
+    // Rounds past 65504, the largest half.
+    return static_cast<uint16>(sign | 0x7c00u);
+  }
+  if (magnitude < 0x38800000u) {
+    // Below 2^-14 the result is subnormal, in steps of 2^-24. Adding 0.5
+    // leaves the float in steps of 2^-24 too, rounded the same way.
+    float magnitudeValue;
+    std::memcpy(&magnitudeValue, &magnitude, sizeof(magnitudeValue));
+    const auto shifted = magnitudeValue + 0.5f;
+    uint32 shiftedBits;
+    std::memcpy(&shiftedBits, &shifted, sizeof(shiftedBits));
+    return static_cast<uint16>(sign | (shiftedBits - 0x3f000000u));
+  }
+  // Rebias the exponent from 127 to 15 and round the 13 dropped bits to
+  // the nearest even.
+  const auto isOdd = (magnitude >> 13) & 1u;
+  magnitude += 0xc8000fffu + isOdd;
+  return static_cast<uint16>(sign | (magnitude >> 13));
+}
+
+float halfToFloat(uint16 half) {
+  const auto sign = static_cast<uint32>(half & 0x8000u) << 16;
+  const auto exponent = (half >> 10) & 0x1fu;
+  const auto mantissa = static_cast<uint32>(half & 0x3ffu);
+  if (exponent == 0) {
+    const auto magnitude = static_cast<float>(mantissa) * (1.f / 16777216.f);
+    return sign != 0 ? -magnitude : magnitude;
+  }
+  // NaN comes out quiet, as from the F16C instructions.
+  const auto bits =
+      exponent == 0x1fu
+          ? sign | 0x7f800000u | ((mantissa != 0 ? mantissa | 0x200u : 0u) << 13)
+          : sign | ((exponent + 112) << 23) | (mantissa << 13);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+const char *getIsaName(Isa isa) {
+  switch (isa) {
+  case Isa::kScalar:
+    return "scalar";
+  case Isa::kSse2:
+    return "sse2";
+  case Isa::kAvx2:
+    return "avx2";
+  case Isa::kAvx512:
+    return "avx512";
+  }
+  jassertfalse;
+  return "";
+}
+
+Isa getBestSupportedIsa() {
+#if JUCE_INTEL
+  uint32 registers[4];
+  getCpuid(0, registers);
+  const auto maxLeaf = registers[0];
+  getCpuid(1, registers);
+  const auto features1Ecx = registers[2], features1Edx = registers[3];
+  uint32 features7Ebx = 0;
+  if (maxLeaf >= 7) {
+    getCpuid(7, registers);
+    features7Ebx = registers[1];
+  }
+
+  const auto hasSse2 = (features1Edx & (1u << 26)) != 0;
+  const auto hasOsXsave = (features1Ecx & (1u << 27)) != 0;
+  const auto registerStates = hasOsXsave ? getEnabledRegisterStates() : 0;
+  // SSE and AVX state, then the AVX-512 mask and upper register state too.
+  const auto isAvxEnabled = (registerStates & 0x06) == 0x06;
+  const auto isAvx512Enabled = (registerStates & 0xe6) == 0xe6;
+  // Every CPU with AVX2 has had F16C, which the AVX2 variant uses too.
+  const auto hasAvx2 = isAvxEnabled && (features1Ecx & (1u << 28)) != 0 &&
+                       (features1Ecx & (1u << 12)) != 0 &&
+                       (features1Ecx & (1u << 29)) != 0 &&
+                       (features7Ebx & (1u << 5)) != 0;
+  const auto hasAvx512 =
+      hasAvx2 && isAvx512Enabled && (features7Ebx & (1u << 16)) != 0;
+
+  if (hasAvx512) {
+    return Isa::kAvx512;
+  }
+  if (hasAvx2) {
+    return Isa::kAvx2;
+  }
+  if (hasSse2) {
+    return Isa::kSse2;
+  }
+#endif
+  return Isa::kScalar;
+}
+
+const Kernels &getKernelsFor(Isa isa) {
+  const auto isaToUse = jmin(isa, getBestSupportedIsa());
+#if JUCE_INTEL
+  switch (isaToUse) {
+  case Isa::kAvx512:
+    return kAvx512Kernels;
+  case Isa::kAvx2:
+    return kAvx2Kernels;
+  case Isa::kSse2:
+    return kSse2Kernels;
+  case Isa::kScalar:
+    break;
+  }
+#endif
+  ignoreUnused(isaToUse);
+  return kScalarKernels;
+}
+
+void selectKernels() { selectedKernels = &getKernelsFor(getRequestedIsa()); }
+
+const Kernels &getKernels() {
+  return *selectedKernels.load(std::memory_order_relaxed);
+}
+} // namespace PianoMannDspKernels
@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    PianoMannDspKernels.h
+    Created: 19 Oct 2026 9:52:07pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * The hot inner loops of the synth, built for several instruction sets. The project itself is
+ * compiled for the baseline of its platform, so the variant to use is picked from the features of
+ * the CPU it runs on, by `selectKernels` before any audio is processed.
+ *
+ * Setting the environment variable `PIANOMANN_ISA` to `scalar`, `sse2`, `avx2` or `avx512` forces
+ * a variant for comparing them. A variant the CPU does not support falls back to the best one it
+ * does.
+ */
+namespace PianoMannDspKernels {
+enum class Isa { kScalar, kSse2, kAvx2, kAvx512 };
+
+const char *getIsaName(Isa isa);
+
+/**
+ * A cascade of second-order sections in transposed direct form II, with the coefficients of all
+ * sections side by side so that vector variants can run one section per lane. First-order
+ * sections have `b2` and `a2` set to zero. Unused sections must be all zero.
+ */
+struct BiquadCascade {
+  static constexpr int kMaxSections = 16;
+  alignas(64) float b0[kMaxSections] = {};
+  alignas(64) float b1[kMaxSections] = {};
+  alignas(64) float b2[kMaxSections] = {};
+  alignas(64) float a1[kMaxSections] = {};
+  alignas(64) float a2[kMaxSections] = {};
+  int numSections = 0;
+};
+
+/**
+ * The state of a `BiquadCascade` for one channel.
+ */
+struct BiquadState {
+  alignas(64) float s1[BiquadCascade::kMaxSections] = {};
+  alignas(64) float s2[BiquadCascade::kMaxSections] = {};
+};
+
+/**
+ * A Karplus-Strong string: a delay line going around `delayLineSize` samples of its buffer from
+ * `position`, and a first-order allpass delaying what is read back from it by a fraction of a
+ * sample so the string can be tuned between whole samples. The allpass keeps its last input and
+ * output.
+ */
+struct StringLoop {
+  float *delayLine = nullptr;
+  int delayLineSize = 0;
+  int position = 0;
+  float allpassCoefficient = 0.f;
+  float allpassInput = 0.f;
+  float allpassOutput = 0.f;
+};
+
+/**
+ * A `StringLoop` whose delay line holds IEEE half-precision floats, which halves the memory the
+ * string goes through each period. The loop computes in single precision, and only what it stores
+ * is rounded, see `floatToHalf`.
+ */
+struct CompactStringLoop {
+  uint16 *delayLine = nullptr;
+  int delayLineSize = 0;
+  int position = 0;
+  float allpassCoefficient = 0.f;
+  float allpassInput = 0.f;
+  float allpassOutput = 0.f;
+};
+
+/**
+ * Converts to half precision, rounding to the nearest even as the F16C instructions do, so every
+ * variant stores the same bits.
+ */
+uint16 floatToHalf(float value);
+float halfToFloat(uint16 half);
+
+/**
+ * A 32-bit integer hash where every input bit affects every output bit, the basis of
+ * `Kernels::generateNoise`.
+ */
+constexpr uint32 hash(uint32 value) {
+  value ^= value >> 16;
+  value *= 0x7feb352du;
+  value ^= value >> 15;
+  value *= 0x846ca68bu;
+  value ^= value >> 16;
+  return value;
+}
+
+/**
+ * Maps a hash to a sample in [-1, 1].
+ */
+inline float hashToSample(uint32 hashed) {
+  return static_cast<float>(static_cast<int32>(hashed)) * (1.f / 2147483648.f);
+}
+
+struct Kernels {
+  Isa isa;
+
+  /**
+   * Adds `source` into `numChannels` destinations starting at `destinationOffset`, and returns
+   * the peak magnitude of `source`.
+   */
+  float (*addToChannels)(const float *source, float *const *destinations,
+                         int numChannels, int destinationOffset,
+                         int numSamples);
+
+  /**
+   * Runs a string with settled loop coefficients, writing its output to `output` and advancing
+   * `loop`.
+   */
+  void (*renderString)(StringLoop &loop, float filterFactor, float decay,
+                       float *output, int numSamples);
+  void (*renderCompactString)(CompactStringLoop &loop, float filterFactor,
+                              float decay, float *output, int numSamples);
+
+  /**
+   * Convert between a single-precision delay line and a `CompactStringLoop` one.
+   */
+  void (*floatsToHalves)(const float *source, uint16 *destination,
+                         int numSamples);
+  void (*halvesToFloats)(const uint16 *source, float *destination,
+                         int numSamples);
+
+  /**
+   * Fills `output` with white noise, where sample `i` is `hashToSample(hash(key + counter + i))`.
+   * Every variant produces exactly the same noise, so it can be generated in any number of
+   * pieces.
+   */
+  void (*generateNoise)(uint32 key, uint32 counter, float *output,
+                        int numSamples);
+
+  /**
+   * Filters `samples` in place through every section of `cascade`.
+   */
+  void (*processBiquadCascade)(const BiquadCascade &cascade,
+                               BiquadState &state, float *samples,
+                               int numSamples);
+};
+
+/**
+ * Picks the kernels for this CPU, or those `PIANOMANN_ISA` asks for. Reading the environment is no
+ * job for the audio thread, so `PianoMannAudioProcessor` calls this when it is created, and
+ * reports the pick with `getIsaName`. Picking again picks the same kernels.
+ */
+void selectKernels();
+
+/**
+ * The kernels picked by `selectKernels`, or the scalar ones before it is called. Safe to call from
+ * any thread.
+ */
+const Kernels &getKernels();
+
+/**
+ * The kernels for `isa`, or for the best instruction set this CPU supports below it.
+ */
+const Kernels &getKernelsFor(Isa isa);
+
+/**
+ * The best instruction set this CPU and operating system support.
+ */
+Isa getBestSupportedIsa();
+} // namespace PianoMannDspKernels
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    PianoMannKeyboardBridge.h
+    Created: 20 Oct 2026 5:02:18pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/**
+ * Connects the on-screen keyboard's `MidiKeyboardState` to the audio thread. The state guards
+ * itself with a lock, so the audio thread never touches it. Keys played on screen are queued for
+ * the audio thread instead, and notes played by the host are queued for the message thread, which
+ * shows them on the state. Nothing is queued for the screen while no keyboard is shown.
+ */
+class PianoMannKeyboardBridge : private MidiKeyboardStateListener,
+                                private Timer {
+public:
+  explicit PianoMannKeyboardBridge(MidiKeyboardState &stateToBridge)
+      : state(stateToBridge), toAudioFifo(kFifoSize), toScreenFifo(kFifoSize) {
+    state.addListener(this);
+  }
+  ~PianoMannKeyboardBridge() override {
+    stopTimer();
+    state.removeListener(this);
+  }
+
+  /**
+   * Keyboards register themselves while shown. Called from the message thread.
+   */
+  void setKeyboardShown(bool isShown) {
+    numShownKeyboards += isShown ? 1 : -1;
+    jassert(numShownKeyboards >= 0);
+    isAnyKeyboardShown = numShownKeyboards > 0;
+    if (numShownKeyboards > 0) {
+      startTimerHz(kFramesPerSecond);
+    } else {
+      stopTimer();
+    }
+  }
+
+  /**
+   * Drops whatever is queued and releases every key. Called from the message thread while the
+   * audio thread is stopped.
+   */
+  void reset() {
+    toAudioFifo.reset();
+    toScreenFifo.reset();
+    state.reset();
+  }
+
+  /**
+   * Queues the host's notes in `midiMessages` for the screen, then adds the keys played on screen
+   * since the last callback at its start. Called from the audio thread.
+   */
+  void process(MidiBuffer &midiMessages) {
+    if (isAnyKeyboardShown.load(std::memory_order_relaxed)) {
+      MidiBuffer::Iterator midiIterator(midiMessages);
+      const uint8 *midiData;
+      int numBytes, samplePosition;
+      while (midiIterator.getNextEvent(midiData, numBytes, samplePosition)) {
+        if (numBytes == kEventSize && isShownOnKeyboard(midiData)) {
+          push(toScreenFifo, toScreenEvents, midiData);
+        }
+      }
+    }
+
+    popAll(toAudioFifo, toAudioEvents, [&midiMessages](const uint8 *midiData) {
+      midiMessages.addEvent(midiData, kEventSize, 0);
+    });
+  }
+
+private:
+  static constexpr int kFifoSize = 256;
+  static constexpr int kEventSize = 3;
+  static constexpr int kFramesPerSecond = 30;
+
+  struct Event {
+    uint8 data[kEventSize];
+  };
+  using Events = std::array<Event, kFifoSize>;
+
+  static bool isShownOnKeyboard(const uint8 *midiData) {
+    const auto status = midiData[0] & 0xf0;
+    constexpr auto kAllSoundOff = 120;
+    constexpr auto kAllNotesOff = 123;
+    return status == 0x80 || status == 0x90 ||
+           (status == 0xb0 &&
+            (midiData[1] == kAllSoundOff || midiData[1] == kAllNotesOff));
+  }
+
+  /**
+   * Events that do not fit are dropped: a key shown or played late is worse than one missed.
+   */
+  static void push(AbstractFifo &fifo, Events &events, const uint8 *midiData) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 == 0) {
+      return;
+    }
+    auto &event = events[static_cast<size_t>(start1)];
+    std::copy(midiData, midiData + kEventSize, event.data);
+    fifo.finishedWrite(1);
+  }
+
+  template <typename Callback>
+  static void popAll(AbstractFifo &fifo, const Events &events,
+                     Callback &&callback) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+    for (auto index = start1; index < start1 + size1; ++index) {
+      callback(events[static_cast<size_t>(index)].data);
+    }
+    for (auto index = start2; index < start2 + size2; ++index) {
+      callback(events[static_cast<size_t>(index)].data);
+    }
+    fifo.finishedRead(size1 + size2);
+  }
+
+  void handleNoteOn(MidiKeyboardState *, int midiChannel, int midiNoteNumber,
+                    float velocity) override {
+    if (!isShowingHostNotes) {
+      const auto message =
+          MidiMessage::noteOn(midiChannel, midiNoteNumber, velocity);
+      push(toAudioFifo, toAudioEvents, message.getRawData());
+    }
+  }
+
+  void handleNoteOff(MidiKeyboardState *, int midiChannel, int midiNoteNumber,
+                     float velocity) override {
+    if (!isShowingHostNotes) {
+      const auto message =
+          MidiMessage::noteOff(midiChannel, midiNoteNumber, velocity);
+      push(toAudioFifo, toAudioEvents, message.getRawData());
+    }
+  }
+
+  void timerCallback() override {
+    // The host's notes already reached the synth, so they are not queued
+    // back for the audio thread.
+    const ScopedValueSetter<bool> showingHostNotes(isShowingHostNotes, true);
+    popAll(toScreenFifo, toScreenEvents, [this](const uint8 *midiData) {
+      state.processNextMidiEvent(MidiMessage(midiData, kEventSize));
+    });
+  }
+
+  MidiKeyboardState &state;
+
+  AbstractFifo toAudioFifo;
+  Events toAudioEvents;
+  AbstractFifo toScreenFifo;
+  Events toScreenEvents;
+
+  /**
+   * Owned by the message thread, apart from the flag the audio thread reads.
+   */
+  int numShownKeyboards = 0;
+  std::atomic<bool> isAnyKeyboardShown{false};
+  bool isShowingHostNotes = false;
+
+  JUCE_DECLARE_NON_COPYABLE(PianoMannKeyboardBridge)
+};
@@ -0,0 +1,602 @@
+/*
+  ==============================================================================
+
+    PianoMannOfflineRenderer.cpp
+    Created: 19 Oct 2026 11:51:17pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannOfflineRenderer.h"
+#include "PianoMannPostFilter.h"
+#include "PianoMannQualityGovernor.h"
+#include "PianoMannVoice.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace {
+/**
+ * A bound on the output of a strike per unit of velocity. Strikes peak at a little under twice
+ * their velocity, quiet hammer strikes being the loudest for their velocity, so this is generous.
+ */
+constexpr double kStrikeBound = 4.0;
+/**
+ * Dampers are taken to be lifted for this long after anything changes, several time constants of
+ * their movement, and from then on to rest a little lighter than they do.
+ */
+constexpr double kDamperSettleSeconds = 0.01;
+constexpr double kDamperEngagementMargin = 0.99;
+/**
+ * Silence after the last string stops, for the post filter to ring out.
+ */
+constexpr double kTailSeconds = 0.1;
+/**
+ * A bound on how long strings ring after the last event, in case they never stop.
+ */
+constexpr double kMaxRingSeconds = 600.0;
+/**
+ * Chunks queued or rendered but not yet written, per thread. Each holds its audio until written.
+ */
+constexpr int kChunksInFlightPerThread = 2;
+
+int64 roundUpToBlock(int64 samplePosition, int blockSize) {
+  return (samplePosition + blockSize - 1) / blockSize * blockSize;
+}
+
+std::unique_ptr<PianoMannSynthesiser>
+createSynth(const PianoMannOfflineRenderer::Settings &settings) {
+  auto synth = std::make_unique<PianoMannSynthesiser>();
+  synth->addKeys();
+  synth->setExcitationSeed(settings.excitationSeed);
+  synth->setStrikeVariationEnabled(settings.isStrikeVariationEnabled);
+  synth->setVelocityShapingEnabled(settings.isVelocityShapingEnabled);
+  synth->setHammerModelEnabled(settings.isHammerModelEnabled);
+  const auto tierSpec = PianoMannQualityGovernor::getTierSpec(0);
+  synth->setMaxRingingVoices(tierSpec.maxRingingVoices);
+  synth->setSilenceThreshold(tierSpec.silenceThreshold);
+  synth->setCurrentPlaybackSampleRate(settings.sampleRate);
+  for (auto midiNote = PianoMannSound::kMinNote;
+       midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
+    synth->findVoiceForNote(midiNote)->prepareForCurrentSampleRate(
+        PianoMannVoice::tuneString(*settings.voicing, midiNote,
+                                   settings.tuning.getFrequency(midiNote),
+                                   settings.sampleRate));
+  }
+  return synth;
+}
+
+bool isAnyVoiceActive(const PianoMannSynthesiser &synth) {
+  for (auto index = 0; index < synth.getNumVoices(); ++index) {
+    if (synth.getVoice(index)->isVoiceActive()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Follows a bound on the level of every string through the MIDI, see
+ * `PianoMannOfflineRenderer::findCuts`. A string's output is bounded by the sum of its strikes,
+ * each decaying by at least the loop gain every period: the sustain of its voicing while its
+ * damper is lifted, and further while it is on. Things this does not follow, such as all-notes-off, only
+ * make strings stop sooner.
+ */
+class SilenceBound {
+public:
+  explicit SilenceBound(const PianoMannOfflineRenderer::Settings &settings)
+      : logSilenceThreshold(std::log(static_cast<double>(
+            PianoMannQualityGovernor::getTierSpec(0).silenceThreshold))),
+        damperSettleSamples(static_cast<int64>(
+            std::ceil(kDamperSettleSeconds * settings.sampleRate))) {
+    for (auto midiNote = PianoMannSound::kMinNote;
+         midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
+      const auto tuning = PianoMannVoice::tuneString(
+          *settings.voicing, midiNote, settings.tuning.getFrequency(midiNote),
+          settings.sampleRate);
+      auto &string = strings[static_cast<size_t>(midiNote)];
+      string.hasVoice = true;
+      string.hasDamper = tuning.hasDamper;
+      string.period = settings.sampleRate / tuning.frequency;
+      string.sustain = static_cast<double>(tuning.sustainLoopGain);
+      string.damperLoopGain = static_cast<double>(tuning.damperLoopGain);
+    }
+  }
+
+  /**
+   * Applies an event, once the strings have decayed up to it.
+   */
+  void handleEvent(const MidiMessage &message) {
+    constexpr auto kSustainPedalController = 0x40;
+    constexpr auto kSostenutoPedalController = 0x42;
+    if (message.isNoteOn()) {
+      auto &string = getString(message.getNoteNumber());
+      if (string.hasVoice) {
+        ++string.numKeysDown;
+        // Strikes add up, whether or not they restart the string.
+        const auto velocity = static_cast<double>(message.getFloatVelocity());
+        string.logLevel =
+            std::log(std::exp(string.logLevel) + kStrikeBound * velocity);
+      }
+    } else if (message.isNoteOff()) {
+      auto &string = getString(message.getNoteNumber());
+      string.numKeysDown = jmax(0, string.numKeysDown - 1);
+    } else if (message.isController() &&
+               message.getControllerNumber() == kSustainPedalController) {
+      pedalState.sustain =
+          static_cast<float>(message.getControllerValue()) / 127.f;
+    } else if (message.isController() &&
+               message.getControllerNumber() == kSostenutoPedalController) {
+      sostenutoChannels[static_cast<size_t>(message.getChannel())] =
+          message.getControllerValue() >= 64;
+    }
+    samplesSinceChange = 0;
+  }
+
+  /**
+   * Lets the strings decay for `numSamples` without any events.
+   */
+  void advance(int64 numSamples) {
+    for (auto &string : strings) {
+      if (string.logLevel > logSilenceThreshold) {
+        string.logLevel -= getLogDecay(string, numSamples);
+      }
+    }
+    samplesSinceChange += numSamples;
+  }
+
+  /**
+   * The sample from `samplePosition` by which every string will have stopped if nothing else
+   * happens, or `kNever`. A string stops at the end of the first period-long window it is
+   * silent throughout.
+   */
+  static constexpr int64 kNever = std::numeric_limits<int64>::max();
+  int64 getSilentPosition(int64 samplePosition) const {
+    auto silentPosition = samplePosition;
+    for (const auto &string : strings) {
+      if (string.logLevel <= logSilenceThreshold) {
+        continue;
+      }
+      const auto numSamples = getSamplesUntilSilent(string);
+      if (numSamples == kNever) {
+        return kNever;
+      }
+      silentPosition = jmax(
+          silentPosition,
+          samplePosition + numSamples +
+              static_cast<int64>(std::ceil(2.0 * string.period)) + 1);
+    }
+    return silentPosition;
+  }
+
+private:
+  struct StringBound {
+    bool hasVoice = false;
+    bool hasDamper = false;
+    double period = 1.0;
+    double sustain = 1.0;
+    double damperLoopGain = 1.0;
+    int numKeysDown = 0;
+    double logLevel = -std::numeric_limits<double>::infinity();
+  };
+
+  StringBound &getString(int midiNoteNumber) {
+    return strings[static_cast<size_t>(jlimit(0, 127, midiNoteNumber))];
+  }
+
+  /**
+   * How fast a string decays in log terms per sample, with its damper lifted and as things
+   * stand.
+   */
+  static double getUndampedDecayRate(const StringBound &string) {
+    return -std::log(string.sustain) / string.period;
+  }
+  double getDecayRate(const StringBound &string) const {
+    if (!string.hasDamper || string.numKeysDown > 0 ||
+        sostenutoChannels.any()) {
+      return getUndampedDecayRate(string);
+    }
+    const auto damping = kDamperEngagementMargin *
+                         static_cast<double>(pedalState.getDamperEngagement());
+    return -std::log(string.sustain *
+                     (1.0 - damping * (1.0 - string.damperLoopGain))) /
+           string.period;
+  }
+
+  int64 getNumUndampedSamples() const {
+    return jmax(int64(0), damperSettleSamples - samplesSinceChange);
+  }
+
+  double getLogDecay(const StringBound &string, int64 numSamples) const {
+    const auto numUndampedSamples = jmin(numSamples, getNumUndampedSamples());
+    return getUndampedDecayRate(string) *
+               static_cast<double>(numUndampedSamples) +
+           getDecayRate(string) *
+               static_cast<double>(numSamples - numUndampedSamples);
+  }
+
+  int64 getSamplesUntilSilent(const StringBound &string) const {
+    const auto logExcess = string.logLevel - logSilenceThreshold;
+    const auto undampedRate = getUndampedDecayRate(string);
+    const auto numUndampedSamples = getNumUndampedSamples();
+    const auto undampedDecay =
+        undampedRate * static_cast<double>(numUndampedSamples);
+    if (undampedDecay >= logExcess) {
+      return static_cast<int64>(std::ceil(logExcess / undampedRate));
+    }
+    const auto rate = getDecayRate(string);
+    if (!(rate > 0.0)) {
+      return kNever;
+    }
+    return numUndampedSamples +
+           static_cast<int64>(std::ceil((logExcess - undampedDecay) / rate));
+  }
+
+  double logSilenceThreshold;
+  int64 damperSettleSamples;
+  std::array<StringBound, 128> strings;
+  PianoMannPedalState pedalState;
+  std::bitset<17> sostenutoChannels;
+  int64 samplesSinceChange = 0;
+};
+} // namespace
+
+struct PianoMannOfflineRenderer::Chunk {
+  int64 startPosition = 0;
+  /**
+   * Where the chunk ends, or -1 for the last chunk, which goes on until every string has stopped.
+   */
+  int64 endPosition = -1;
+  size_t firstEvent = 0;
+  size_t endEvent = 0;
+
+  std::unique_ptr<PianoMannSynthesiser> synth;
+  /**
+   * The state the chunk was rendered from, and the state it ended in.
+   */
+  MemoryBlock startState, endState;
+  AudioBuffer<float> audio;
+  int numSamples = 0;
+  bool wasCompleted = false;
+  /**
+   * Signalled once the chunk has been rendered the first time.
+   */
+  WaitableEvent rendered{true};
+};
+
+PianoMannOfflineRenderer::Report PianoMannOfflineRenderer::render(
+    const MidiMessageSequence &midi, const Settings &settings,
+    const BlockWriter &writeBlock, const std::function<bool()> &shouldExit) {
+  jassert(settings.blockSize > 0 &&
+          settings.blockSize % PianoMannSynthesiser::kQuantumSize == 0);
+  const auto events = getEvents(midi, settings.sampleRate);
+  return renderChunks(events, findCuts(events, settings), settings, writeBlock,
+                      shouldExit);
+}
+
+bool PianoMannOfflineRenderer::readMidiFile(const File &midiFile,
+                                            MidiMessageSequence &result) {
+  FileInputStream input(midiFile);
+  MidiFile file;
+  if (!input.openedOk() || !file.readFrom(input)) {
+    return false;
+  }
+  file.convertTimestampTicksToSeconds();
+  result.clear();
+  for (auto track = 0; track < file.getNumTracks(); ++track) {
+    result.addSequence(*file.getTrack(track), 0.0);
+  }
+  result.updateMatchedPairs();
+  return true;
+}
+
+bool PianoMannOfflineRenderer::start(const File &midiFile,
+                                     const File &audioFile,
+                                     const Settings &settings) {
+  stop();
+  if (!readMidiFile(midiFile, midiToRender)) {
+    return false;
+  }
+  fileToWrite = audioFile;
+  settingsToRender = settings;
+  setOutcome(Result::ok(), {});
+  startThread(4);
+  return true;
+}
+
+void PianoMannOfflineRenderer::run() {
+  fileToWrite.deleteFile();
+  std::unique_ptr<FileOutputStream> output(fileToWrite.createOutputStream());
+  if (output == nullptr) {
+    setOutcome(Result::fail("Cannot write " + fileToWrite.getFullPathName()),
+               {});
+    return;
+  }
+  WavAudioFormat format;
+  constexpr auto kBitsPerSample = 24;
+  std::unique_ptr<AudioFormatWriter> writer(format.createWriterFor(
+      output.get(), settingsToRender.sampleRate,
+      static_cast<unsigned int>(settingsToRender.numChannels), kBitsPerSample,
+      {}, 0));
+  if (writer == nullptr) {
+    output.reset();
+    fileToWrite.deleteFile();
+    setOutcome(Result::fail("Cannot write a WAV file at " +
+                            String(settingsToRender.sampleRate) + " Hz"),
+               {});
+    return;
+  }
+  // The writer owns the stream now.
+  output.release();
+
+  // Chunks are rendered on other threads, which also check whether to exit.
+  std::atomic<bool> hasWriteFailed{false};
+  const auto report = render(
+      midiToRender, settingsToRender,
+      [&writer, &hasWriteFailed](const AudioBuffer<float> &block) {
+        if (!writer->writeFromAudioSampleBuffer(block, 0,
+                                                block.getNumSamples())) {
+          hasWriteFailed = true;
+        }
+      },
+      [this, &hasWriteFailed] {
+        return threadShouldExit() || hasWriteFailed.load();
+      });
+  writer.reset();
+  if (!report.wasCompleted) {
+    fileToWrite.deleteFile();
+    setOutcome(hasWriteFailed
+                   ? Result::fail("Cannot write " +
+                                  fileToWrite.getFullPathName() +
+                                  ", the disk may be full")
+                   : Result::fail("The render was stopped"),
+               report);
+    return;
+  }
+  setOutcome(Result::ok(), report);
+}
+
+void PianoMannOfflineRenderer::setOutcome(const Result &result,
+                                          const Report &report) {
+  const ScopedLock sl(outcomeLock);
+  lastResult = result;
+  lastReport = report;
+}
+
+std::vector<PianoMannOfflineRenderer::Event>
+PianoMannOfflineRenderer::getEvents(const MidiMessageSequence &midi,
+                                    double sampleRate) {
+  std::vector<Event> events;
+  for (const auto *holder : midi) {
+    const auto &message = holder->message;
+    // Only channel messages reach the synthesiser.
+    if (message.getChannel() == 0) {
+      continue;
+    }
+    events.push_back(
+        {jmax(int64(0), static_cast<int64>(
+                            std::llround(message.getTimeStamp() * sampleRate))),
+         message});
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event &a, const Event &b) {
+                     return a.samplePosition < b.samplePosition;
+                   });
+  return events;
+}
+
+std::vector<int64>
+PianoMannOfflineRenderer::findCuts(const std::vector<Event> &events,
+                                   const Settings &settings) {
+  const auto minChunkSamples =
+      jmax(static_cast<int64>(settings.blockSize),
+           static_cast<int64>(settings.minChunkSeconds * settings.sampleRate));
+  std::vector<int64> cuts;
+  SilenceBound bound(settings);
+  int64 position = 0;
+  int64 lastCut = 0;
+  for (size_t index = 0; index < events.size();) {
+    bound.advance(events[index].samplePosition - position);
+    position = events[index].samplePosition;
+    for (; index < events.size() && events[index].samplePosition == position;
+         ++index) {
+      bound.handleEvent(events[index].message);
+    }
+    // The last chunk goes on until the strings stop anyway.
+    if (index == events.size()) {
+      break;
+    }
+    const auto silentPosition = bound.getSilentPosition(position);
+    if (silentPosition == SilenceBound::kNever) {
+      continue;
+    }
+    const auto cut = roundUpToBlock(silentPosition, settings.blockSize);
+    if (cut > position && cut <= events[index].samplePosition &&
+        cut >= lastCut + minChunkSamples) {
+      cuts.push_back(cut);
+      lastCut = cut;
+    }
+  }
+  return cuts;
+}
+
+void PianoMannOfflineRenderer::startChunk(Chunk &chunk,
+                                          const std::vector<Event> &events,
+                                          const Settings &settings) {
+  chunk.synth = createSynth(settings);
+  for (auto index = size_t(0); index < chunk.firstEvent; ++index) {
+    chunk.synth->handleMidiWithoutRendering(events[index].message);
+  }
+  chunk.synth->silenceAllVoices();
+  chunk.startState.reset();
+  MemoryOutputStream output(chunk.startState, false);
+  chunk.synth->writeState(output);
+}
+
+void PianoMannOfflineRenderer::renderChunk(
+    Chunk &chunk, const std::vector<Event> &events, const Settings &settings,
+    const std::function<bool()> &shouldExit) {
+  const auto blockSize = settings.blockSize;
+  const auto isLastChunk = chunk.endPosition < 0;
+  const auto endPosition =
+      isLastChunk
+          ? roundUpToBlock(
+                (events.empty() ? 0 : events.back().samplePosition + 1) +
+                    static_cast<int64>(kMaxRingSeconds * settings.sampleRate),
+                blockSize)
+          : chunk.endPosition;
+
+  chunk.wasCompleted = false;
+  chunk.numSamples = 0;
+  chunk.audio.setSize(
+      settings.numChannels,
+      isLastChunk ? blockSize
+                  : static_cast<int>(endPosition - chunk.startPosition));
+  MidiBuffer blockMidi;
+  auto eventIndex = chunk.firstEvent;
+  for (auto position = chunk.startPosition; position < endPosition;
+       position += blockSize) {
+    if (isLastChunk && eventIndex == chunk.endEvent &&
+        !isAnyVoiceActive(*chunk.synth)) {
+      break;
+    }
+    if (shouldExit && shouldExit()) {
+      return;
+    }
+    blockMidi.clear();
+    for (; eventIndex < chunk.endEvent &&
+           events[eventIndex].samplePosition < position + blockSize;
+         ++eventIndex) {
+      blockMidi.addEvent(events[eventIndex].message,
+                         static_cast<int>(events[eventIndex].samplePosition -
+                                          chunk.startPosition));
+    }
+    if (chunk.numSamples + blockSize > chunk.audio.getNumSamples()) {
+      chunk.audio.setSize(settings.numChannels,
+                          2 * chunk.audio.getNumSamples(), true);
+    }
+    chunk.audio.clear(chunk.numSamples, blockSize);
+    chunk.synth->renderNextBlock(chunk.audio, blockMidi, chunk.numSamples,
+                                 blockSize);
+    chunk.numSamples += blockSize;
+  }
+
+  chunk.endState.reset();
+  MemoryOutputStream output(chunk.endState, false);
+  chunk.synth->writeState(output);
+  chunk.wasCompleted = true;
+}
+
+PianoMannOfflineRenderer::Report PianoMannOfflineRenderer::renderChunks(
+    const std::vector<Event> &events, const std::vector<int64> &cuts,
+    const Settings &settings, const BlockWriter &writeBlock,
+    const std::function<bool()> &shouldExit) {
+  Report report;
+  report.numChunks = static_cast<int>(cuts.size()) + 1;
+  const auto getFirstEventFrom = [&events](int64 samplePosition) {
+    return static_cast<size_t>(
+        std::lower_bound(events.begin(), events.end(), samplePosition,
+                         [](const Event &event, int64 position) {
+                           return event.samplePosition < position;
+                         }) -
+        events.begin());
+  };
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  for (auto index = size_t(0); index <= cuts.size(); ++index) {
+    auto chunk = std::make_unique<Chunk>();
+    chunk->startPosition = index == 0 ? 0 : cuts[index - 1];
+    chunk->endPosition = index < cuts.size() ? cuts[index] : -1;
+    chunk->firstEvent = getFirstEventFrom(chunk->startPosition);
+    chunk->endEvent = index < cuts.size() ? getFirstEventFrom(cuts[index])
+                                          : events.size();
+    chunks.push_back(std::move(chunk));
+  }
+
+  const auto numThreads = settings.numThreads > 0 ? settings.numThreads
+                                                  : SystemStats::getNumCpus();
+  ThreadPool pool(numThreads);
+  const auto queueChunk = [&](size_t index) {
+    pool.addJob([&events, &settings, &shouldExit, chunk = chunks[index].get()] {
+      startChunk(*chunk, events, settings);
+      renderChunk(*chunk, events, settings, shouldExit);
+      chunk->rendered.signal();
+    });
+  };
+  // Only a few chunks are rendered ahead of the writer, enough to keep every
+  // thread busy, so a long piece is not held in memory whole.
+  const auto maxChunksInFlight =
+      static_cast<size_t>(kChunksInFlightPerThread * numThreads);
+  for (auto index = size_t(0); index < jmin(maxChunksInFlight, chunks.size());
+       ++index) {
+    queueChunk(index);
+  }
+
+  PianoMannPostFilter postFilter;
+  postFilter.prepare({settings.sampleRate,
+                      static_cast<uint32>(settings.blockSize),
+                      static_cast<uint32>(settings.numChannels)},
+                     *settings.voicing);
+  postFilter.prepareFullOrder(*settings.voicing);
+  postFilter.setUseFullOrder(true);
+  const auto writeFiltered = [&](AudioBuffer<float> &audio, int numSamples) {
+    for (auto startSample = 0; startSample < numSamples;
+         startSample += settings.blockSize) {
+      const auto numBlockSamples =
+          jmin(settings.blockSize, numSamples - startSample);
+      AudioBuffer<float> block(audio.getArrayOfWritePointers(),
+                               audio.getNumChannels(), startSample,
+                               numBlockSamples);
+      postFilter.process(block);
+      writeBlock(block);
+    }
+    report.numSamples += numSamples;
+  };
+
+  // Chunks are checked and written in order. Each one started from silence,
+  // so if the one before did not end in silence after all, it is rendered
+  // again from where that one actually ended.
+  for (auto index = size_t(0); index < chunks.size(); ++index) {
+    auto &chunk = *chunks[index];
+    chunk.rendered.wait();
+    if (!chunk.wasCompleted) {
+      break;
+    }
+    if (index > 0 && chunk.startState != chunks[index - 1]->endState) {
+      ++report.numRepairedChunks;
+      startChunk(chunk, events, settings);
+      MemoryInputStream input(chunks[index - 1]->endState, false);
+      chunk.synth->readState(input);
+      renderChunk(chunk, events, settings, shouldExit);
+      if (!chunk.wasCompleted) {
+        break;
+      }
+    }
+    writeFiltered(chunk.audio, chunk.numSamples);
+    chunk.synth.reset();
+    chunk.audio.setSize(0, 0);
+    if (index > 0) {
+      chunks[index - 1]->endState.reset();
+    }
+    if (index + maxChunksInFlight < chunks.size()) {
+      queueChunk(index + maxChunksInFlight);
+    }
+    report.wasCompleted = index + 1 == chunks.size();
+  }
+  pool.removeAllJobs(true, -1);
+
+  if (report.wasCompleted) {
+    AudioBuffer<float> tail(
+        settings.numChannels,
+        static_cast<int>(roundUpToBlock(
+            static_cast<int64>(std::ceil(kTailSeconds * settings.sampleRate)),
+            settings.blockSize)));
+    tail.clear();
+    writeFiltered(tail, tail.getNumSamples());
+  }
+  return report;
+}
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    PianoMannOfflineRenderer.h
+    Created: 19 Oct 2026 11:51:17pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannSynthesiser.h"
+#include "PianoMannTuning.h"
+#include "PianoMannVoicing.h"
+#include <JuceHeader.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Renders a whole MIDI file at full quality on all cores, as fast as they allow.
+ *
+ * Strings carry their state through the whole piece, so one synthesiser can only render it in
+ * order. Instead, the MIDI is cut wherever every string is provably below the silence threshold,
+ * going by the decay of each note and the dampers, and each chunk is rendered by its own
+ * synthesiser. A chunk starts from the keys and pedals its MIDI leaves down, with every string
+ * silent. The state each chunk ends in is checked against the state the next one started from,
+ * and should they differ, the next chunk is rendered again from the actual state. The output is
+ * therefore the same as rendering in order, sample for sample.
+ *
+ * Hosts hand plugins one block at a time even when bouncing, so this renders MIDI files such as
+ * the ones `PianoMannRecorder` writes, from the standalone app.
+ */
+class PianoMannOfflineRenderer : private Thread {
+public:
+  PianoMannOfflineRenderer() : Thread("PianoMann offline renderer") {}
+  ~PianoMannOfflineRenderer() override { stop(); }
+
+  struct Settings {
+    double sampleRate = 48000.0;
+    int numChannels = 2;
+    /**
+     * The size of the blocks the synthesiser is rendered in. Output does not depend on it, but
+     * it must be a whole number of `PianoMannSynthesiser::kQuantumSize` for chunks to line up.
+     */
+    int blockSize = 512;
+    int64 excitationSeed = 0;
+    bool isStrikeVariationEnabled = true;
+    bool isVelocityShapingEnabled = true;
+    bool isHammerModelEnabled = true;
+    PianoMannTuning tuning = PianoMannTuning::equalTemperament();
+    std::shared_ptr<const PianoMannVoicing> voicing =
+        PianoMannVoicing::getBuiltIn();
+    /**
+     * The number of chunks rendered at once, or 0 for one per core. Only twice as many are kept
+     * in memory ahead of the one being written.
+     */
+    int numThreads = 0;
+    /**
+     * Chunks are at least this long, as every chunk replays the MIDI before it.
+     */
+    double minChunkSeconds = 5.0;
+  };
+
+  struct Report {
+    bool wasCompleted = false;
+    int numChunks = 0;
+    /**
+     * The chunks whose start turned out not to be silent, and were rendered again.
+     */
+    int numRepairedChunks = 0;
+    int64 numSamples = 0;
+  };
+
+  /**
+   * Renders `midi`, whose timestamps are in seconds, until every string has died away. The
+   * output is handed to `writeBlock` in order, a block at a time. Rendering stops early if
+   * `shouldExit` returns `true`.
+   */
+  using BlockWriter = std::function<void(const AudioBuffer<float> &)>;
+  static Report render(const MidiMessageSequence &midi,
+                       const Settings &settings, const BlockWriter &writeBlock,
+                       const std::function<bool()> &shouldExit = {});
+
+  /**
+   * Reads every track of a standard MIDI file into one sequence timed in seconds.
+   */
+  static bool readMidiFile(const File &midiFile, MidiMessageSequence &result);
+
+  /**
+   * A new file next to `midiFile` for its render.
+   */
+  static File getDefaultFile(const File &midiFile) {
+    return midiFile
+        .getSiblingFile(midiFile.getFileNameWithoutExtension() + " render.wav")
+        .getNonexistentSibling();
+  }
+
+  /**
+   * Renders `midiFile` to a 24-bit WAV `audioFile` on a background thread, stopping any render
+   * in progress. Returns whether the MIDI file could be read.
+   */
+  bool start(const File &midiFile, const File &audioFile,
+             const Settings &settings);
+  void stop() { stopThread(-1); }
+  bool isRendering() const { return isThreadRunning(); }
+
+  /**
+   * How the last render started with `start` ended: with its file fully written, along with its
+   * report, or failed with the reason, in which case the file is deleted. Read them once
+   * `isRendering` returns `false`.
+   */
+  Result getLastResult() const {
+    const ScopedLock sl(outcomeLock);
+    return lastResult;
+  }
+  Report getLastReport() const {
+    const ScopedLock sl(outcomeLock);
+    return lastReport;
+  }
+  const File &getLastFile() const { return fileToWrite; }
+
+private:
+  void run() override;
+
+  struct Event {
+    int64 samplePosition;
+    MidiMessage message;
+  };
+  /**
+   * The events of `midi` that reach the synthesiser, by sample.
+   */
+  static std::vector<Event> getEvents(const MidiMessageSequence &midi,
+                                      double sampleRate);
+  /**
+   * Where the piece can be cut, each a block boundary by which every string is silent and
+   * before any later event.
+   */
+  static std::vector<int64> findCuts(const std::vector<Event> &events,
+                                     const Settings &settings);
+  /**
+   * A stretch of the piece and the synthesiser rendering it, see `renderChunks`.
+   */
+  struct Chunk;
+  /**
+   * Sets up the synthesiser of `chunk` as the events before it leave things, with every string
+   * silent.
+   */
+  static void startChunk(Chunk &chunk, const std::vector<Event> &events,
+                         const Settings &settings);
+  static void renderChunk(Chunk &chunk, const std::vector<Event> &events,
+                          const Settings &settings,
+                          const std::function<bool()> &shouldExit);
+  static Report renderChunks(const std::vector<Event> &events,
+                             const std::vector<int64> &cuts,
+                             const Settings &settings,
+                             const BlockWriter &writeBlock,
+                             const std::function<bool()> &shouldExit);
+
+  MidiMessageSequence midiToRender;
+  File fileToWrite;
+  Settings settingsToRender;
+
+  void setOutcome(const Result &result, const Report &report);
+  CriticalSection outcomeLock;
+  Result lastResult = Result::ok();
+  Report lastReport;
+};
@@ -0,0 +1,263 @@
+/*
+  ==============================================================================
+
+    PianoMannPostFilter.h
+    Created: 19 Oct 2026 11:20:51am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannButterworthLowPassFilter.h"
+#include "PianoMannVoicing.h"
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/**
+ * The low-pass filter applied to the synth's output, as voiced by `PianoMannVoicing`. It has a
+ * full order and a cheaper economy order, and crossfades between the two when switching so the
+ * change is click-free. Once its input has been silent for longer than the filter's tail, it stops
+ * processing altogether.
+ *
+ * Designing the full order is left to `prepareFullOrder`, which may run on a background thread.
+ * Until it is done, the economy order stands in for it.
+ */
+class PianoMannPostFilter {
+  PianoMannButterworthLowPassFilter fullOrderFilter;
+  PianoMannButterworthLowPassFilter economyOrderFilter;
+
+public:
+  void prepare(const dsp::ProcessSpec &spec, const PianoMannVoicing &voicing) {
+    isFullOrderPrepared.store(false, std::memory_order_release);
+    fullOrderSpec = spec;
+    economyOrderFilter.prepare(spec);
+    economyOrderFilter.setCascade(
+        voicing.getPostFilterCascade(spec.sampleRate, false));
+    // Sections handed over for the last sample rate no longer apply.
+    sharedCascades.fetch_and(~kIsNewCascades, std::memory_order_relaxed);
+    hasNewFullOrderCascade = false;
+    isUsingFullOrder = false;
+    crossfadeBuffer.setSize(static_cast<int>(spec.numChannels),
+                            jmax(1, static_cast<int>(spec.maximumBlockSize)));
+    crossfadeLengthSamples = roundToInt(spec.sampleRate * kCrossfadeSeconds);
+    tailLengthSamples = roundToInt(spec.sampleRate * kTailSeconds);
+    reset();
+  }
+
+  /**
+   * Designs the full order of `voicing` for the spec last given to `prepare`. This is safe to call
+   * from a background thread while `process` runs.
+   */
+  void prepareFullOrder(const PianoMannVoicing &voicing) {
+    jassert(!isFullOrderPrepared.load(std::memory_order_acquire));
+    fullOrderFilter.prepare(fullOrderSpec);
+    fullOrderFilter.setCascade(
+        voicing.getPostFilterCascade(fullOrderSpec.sampleRate, true));
+    isFullOrderPrepared.store(true, std::memory_order_release);
+  }
+
+  /**
+   * Switches both orders to the post filter of `voicing` without preparing again. The sections are
+   * worked out here for the current sample rate and handed over to `process` without locking, the
+   * way `PianoMannSynthesiser::setTuning` hands over strings. Call from one thread at a time.
+   */
+  void setVoicing(const PianoMannVoicing &voicing) {
+    const auto sampleRate = fullOrderSpec.sampleRate;
+    if (sampleRate <= 0.0) {
+      return;
+    }
+    auto &cascades = cascadeTables[static_cast<size_t>(writtenCascades)];
+    cascades.fullOrder = voicing.getPostFilterCascade(sampleRate, true);
+    cascades.economyOrder = voicing.getPostFilterCascade(sampleRate, false);
+    writtenCascades =
+        sharedCascades.exchange(writtenCascades | kIsNewCascades,
+                                std::memory_order_acq_rel) &
+        ~kIsNewCascades;
+  }
+
+  void reset() {
+    resetFilters();
+    crossfadeSamplesRemaining = 0;
+    samplesSinceSignal = 0;
+    isIdle = false;
+  }
+
+  /**
+   * Switches between the full and economy order. The new filter fades in over the next
+   * `kCrossfadeSeconds`, or once the full order is prepared.
+   */
+  void setUseFullOrder(bool shouldUseFullOrder) {
+    useFullOrder = shouldUseFullOrder;
+  }
+
+  void process(AudioBuffer<float> &buffer) {
+    takeNewCascades();
+    const auto shouldUseFullOrder =
+        useFullOrder && isFullOrderPrepared.load(std::memory_order_acquire);
+    if (shouldUseFullOrder != isUsingFullOrder) {
+      isUsingFullOrder = shouldUseFullOrder;
+      // The incoming filter has been idle, so start it from silence rather
+      // than from stale state.
+      if (isUsingFullOrder) {
+        fullOrderFilter.reset();
+      } else {
+        economyOrderFilter.reset();
+      }
+      crossfadeSamplesRemaining = crossfadeLengthSamples;
+    }
+
+    const auto numSamples = buffer.getNumSamples();
+    if (buffer.getMagnitude(0, numSamples) > 0.f) {
+      samplesSinceSignal = 0;
+    } else {
+      samplesSinceSignal = jmin(samplesSinceSignal + numSamples,
+                                tailLengthSamples + 1);
+    }
+    if (samplesSinceSignal > tailLengthSamples) {
+      // Silence in, silence out. Clear the state once so the next signal
+      // does not start from a stale tail.
+      if (!isIdle) {
+        resetFilters();
+        crossfadeSamplesRemaining = 0;
+        isIdle = true;
+      }
+      return;
+    }
+    isIdle = false;
+
+    if (crossfadeSamplesRemaining <= 0) {
+      processWith(isUsingFullOrder, buffer);
+      return;
+    }
+
+    // The crossfade buffer holds no more than a prepared block, so the
+    // crossfade goes a part at a time. Past its end, only the incoming filter
+    // is left.
+    for (auto startSample = 0; startSample < numSamples;) {
+      const auto numPartSamples =
+          crossfadeSamplesRemaining > 0
+              ? jmin(numSamples - startSample, crossfadeSamplesRemaining,
+                     crossfadeBuffer.getNumSamples())
+              : numSamples - startSample;
+      AudioBuffer<float> part(buffer.getArrayOfWritePointers(),
+                              buffer.getNumChannels(), startSample,
+                              numPartSamples);
+      if (crossfadeSamplesRemaining > 0) {
+        crossfade(part);
+      } else {
+        processWith(isUsingFullOrder, part);
+      }
+      startSample += numPartSamples;
+    }
+  }
+
+private:
+  /**
+   * Switches to the sections of the latest `setVoicing`, if there was one since last time. Until
+   * the full order is prepared, it belongs to the thread designing it, so it switches later.
+   */
+  void takeNewCascades() {
+    if ((sharedCascades.load(std::memory_order_relaxed) & kIsNewCascades) != 0) {
+      readCascades = sharedCascades.exchange(readCascades,
+                                             std::memory_order_acq_rel) &
+                     ~kIsNewCascades;
+      economyOrderFilter.setCascade(
+          cascadeTables[static_cast<size_t>(readCascades)].economyOrder);
+      hasNewFullOrderCascade = true;
+    }
+    if (hasNewFullOrderCascade &&
+        isFullOrderPrepared.load(std::memory_order_acquire)) {
+      fullOrderFilter.setCascade(
+          cascadeTables[static_cast<size_t>(readCascades)].fullOrder);
+      hasNewFullOrderCascade = false;
+    }
+  }
+
+  void resetFilters() {
+    economyOrderFilter.reset();
+    // Until it is prepared, the full order belongs to the thread designing it.
+    if (isFullOrderPrepared.load(std::memory_order_acquire)) {
+      fullOrderFilter.reset();
+    }
+  }
+
+  /**
+   * Filters `buffer` through both orders and fades from the outgoing one to the incoming one. It
+   * must fit in `crossfadeBuffer` and end by the end of the crossfade.
+   */
+  void crossfade(AudioBuffer<float> &buffer) {
+    const auto numSamples = buffer.getNumSamples();
+    jassert(numSamples <= crossfadeBuffer.getNumSamples() &&
+            numSamples <= crossfadeSamplesRemaining);
+    const auto numChannels =
+        jmin(buffer.getNumChannels(), crossfadeBuffer.getNumChannels());
+    AudioBuffer<float> incoming(crossfadeBuffer.getArrayOfWritePointers(),
+                                numChannels, numSamples);
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      incoming.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+    }
+    processWith(!isUsingFullOrder, buffer);
+    processWith(isUsingFullOrder, incoming);
+
+    const auto startGain = 1.f - static_cast<float>(crossfadeSamplesRemaining) /
+                                     static_cast<float>(crossfadeLengthSamples);
+    crossfadeSamplesRemaining -= numSamples;
+    const auto endGain = 1.f - static_cast<float>(crossfadeSamplesRemaining) /
+                                   static_cast<float>(crossfadeLengthSamples);
+    buffer.applyGainRamp(0, numSamples, 1.f - startGain, 1.f - endGain);
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      buffer.addFromWithRamp(channel, 0, incoming.getReadPointer(channel),
+                             numSamples, startGain, endGain);
+    }
+  }
+
+  void processWith(bool fullOrder, AudioBuffer<float> &buffer) {
+    dsp::AudioBlock<float> block(buffer);
+    const dsp::ProcessContextReplacing<float> processContext(block);
+    if (fullOrder) {
+      fullOrderFilter.process(processContext);
+    } else {
+      economyOrderFilter.process(processContext);
+    }
+  }
+
+  static constexpr double kCrossfadeSeconds = 0.02;
+  /**
+   * How long the filters keep ringing after their input goes silent. This is generous for the
+   * built-in 5kHz cut-off.
+   */
+  static constexpr double kTailSeconds = 0.05;
+
+  /**
+   * The order asked for, and the order actually in use, which lags behind until the full order
+   * is prepared.
+   */
+  bool useFullOrder = true;
+  bool isUsingFullOrder = false;
+  dsp::ProcessSpec fullOrderSpec{};
+  std::atomic<bool> isFullOrderPrepared{false};
+  AudioBuffer<float> crossfadeBuffer;
+  int crossfadeLengthSamples = 0;
+  int crossfadeSamplesRemaining = 0;
+  int tailLengthSamples = 0;
+  int samplesSinceSignal = 0;
+  bool isIdle = false;
+
+  /**
+   * Sections pass from `setVoicing` to `process` through three tables, as strings do in
+   * `PianoMannSynthesiser`.
+   */
+  struct Cascades {
+    PianoMannDspKernels::BiquadCascade fullOrder;
+    PianoMannDspKernels::BiquadCascade economyOrder;
+  };
+  static constexpr int kIsNewCascades = 4;
+  std::array<Cascades, 3> cascadeTables;
+  std::atomic<int> sharedCascades{0};
+  int writtenCascades = 1;
+  int readCascades = 2;
+  bool hasNewFullOrderCascade = false;
+};
@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    PianoMannQualityGovernor.h
+    Created: 19 Oct 2026 11:02:15am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+
+/**
+ * Picks a quality tier from the measured cost of each rendered block relative to its real-time
+ * budget. Under pressure it steps down one tier at a time and only steps back up after a sustained
+ * period of headroom, so it does not thrash between tiers.
+ */
+class PianoMannQualityGovernor {
+public:
+  /**
+   * Tier 0 is full quality, higher tiers are progressively cheaper.
+   */
+  static constexpr int kNumTiers = 3;
+
+  struct TierSpec {
+    /**
+     * Whether the post filter runs at its full order.
+     */
+    bool useFullOrderPostFilter;
+    /**
+     * The maximum number of strings allowed to ring at once.
+     */
+    int maxRingingVoices;
+    /**
+     * The output level below which a string is retired.
+     */
+    float silenceThreshold;
+  };
+  static constexpr TierSpec getTierSpec(int tier) {
+    if (tier <= 0) {
+      return TierSpec{true, 32, 0.0005f};
+    }
+    if (tier == 1) {
+      return TierSpec{false, 24, 0.002f};
+    }
+    return TierSpec{false, 16, 0.005f};
+  }
+
+  void prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+    reset();
+  }
+
+  void reset() {
+    tier = 0;
+    smoothedLoad = 0.0;
+    secondsSinceTierChange = 0.0;
+    secondsWithHeadroom = 0.0;
+  }
+
+  int getTier() const { return tier; }
+
+  /**
+   * Feeds the time spent rendering a block of `numSamples`. Returns `true` if the tier changed.
+   */
+  bool blockRendered(int numSamples, double elapsedSeconds) {
+    if (numSamples <= 0 || sampleRate <= 0.0) {
+      return false;
+    }
+    const auto budgetSeconds = numSamples / sampleRate;
+    const auto load = elapsedSeconds / budgetSeconds;
+
+    // Smooth over a fixed amount of audio time so the response does not
+    // depend on the host's block size.
+    const auto smoothing = 1.0 - std::exp(-budgetSeconds / kLoadSmoothingSeconds);
+    smoothedLoad += smoothing * (load - smoothedLoad);
+    secondsSinceTierChange += budgetSeconds;
+
+    const auto isOverloaded = smoothedLoad > kStepDownLoad || load > 1.0;
+    if (isOverloaded) {
+      secondsWithHeadroom = 0.0;
+      if (tier < kNumTiers - 1 && secondsSinceTierChange >= kHoldOffSeconds) {
+        return setTier(tier + 1);
+      }
+      return false;
+    }
+
+    secondsWithHeadroom =
+        smoothedLoad < kStepUpLoad ? secondsWithHeadroom + budgetSeconds : 0.0;
+    if (tier > 0 && secondsWithHeadroom >= kStepUpSeconds) {
+      return setTier(tier - 1);
+    }
+    return false;
+  }
+
+private:
+  bool setTier(int newTier) {
+    tier = newTier;
+    secondsSinceTierChange = 0.0;
+    secondsWithHeadroom = 0.0;
+    return true;
+  }
+
+  /**
+   * Load is the fraction of the block's real-time budget spent rendering it.
+   */
+  static constexpr double kStepDownLoad = 0.75;
+  static constexpr double kStepUpLoad = 0.4;
+  static constexpr double kLoadSmoothingSeconds = 0.05;
+  /**
+   * The minimum time between two consecutive step-downs, giving the previous one a chance to
+   * show in the measured load.
+   */
+  static constexpr double kHoldOffSeconds = 0.25;
+  /**
+   * How long the load must stay below `kStepUpLoad` before stepping back up.
+   */
+  static constexpr double kStepUpSeconds = 2.0;
+
+  double sampleRate = 0.0;
+  int tier = 0;
+  double smoothedLoad = 0.0;
+  double secondsSinceTierChange = 0.0;
+  double secondsWithHeadroom = 0.0;
+};
@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    PianoMannQuantumBuffer.h
+    Created: 19 Oct 2026 11:04:26pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannSynthesiser.h"
+#include <JuceHeader.h>
+
+/**
+ * Adapts the blocks of the host to whole quanta of `PianoMannSynthesiser::kQuantumSize` samples,
+ * at the cost of one quantum of latency. Whatever renders the quanta, post filters included, then
+ * runs on full quanta however small or uneven the host's blocks are.
+ *
+ * MIDI is delayed along with the audio, keeping the sample it arrived at within its quantum.
+ */
+class PianoMannQuantumBuffer {
+public:
+  static constexpr int kQuantumSize = PianoMannSynthesiser::kQuantumSize;
+  static constexpr int kLatencySamples = kQuantumSize;
+
+  void prepare(int maximumBlockSize, int numChannels) {
+    maxBlockSize = maximumBlockSize;
+    // The ring holds at most the latency plus one block. AbstractFifo can
+    // hold one sample less than its size.
+    const auto capacity = kLatencySamples + maximumBlockSize + 1;
+    audioRing.setSize(numChannels, capacity);
+    audioRing.clear();
+    audioFifo.setTotalSize(capacity);
+    audioFifo.reset();
+    int start1, size1, start2, size2;
+    audioFifo.prepareToWrite(kLatencySamples, start1, size1, start2, size2);
+    audioFifo.finishedWrite(size1 + size2);
+
+    quantumBuffer.setSize(numChannels, kQuantumSize);
+    for (auto *midi : {&pendingMidi, &quantumMidi, &laterMidi}) {
+      midi->clear();
+      midi->ensureSize(kMidiBufferSize);
+    }
+    numPendingSamples = 0;
+  }
+
+  /**
+   * Queues the MIDI of `buffer`, renders every quantum whose MIDI is now complete, and replaces
+   * the contents of `buffer` with the audio from one quantum earlier. `renderQuantum` is called
+   * with a cleared buffer of `kQuantumSize` samples and the MIDI falling within it.
+   */
+  template <typename RenderQuantum>
+  void process(AudioBuffer<float> &buffer, const MidiBuffer &midiMessages,
+               RenderQuantum &&renderQuantum) {
+    const auto numSamples = buffer.getNumSamples();
+    // Hosts should not exceed the block size they prepared for, but some do.
+    // The ring only has room for that much at once.
+    for (auto offset = 0; offset < numSamples; offset += maxBlockSize) {
+      processPart(buffer, midiMessages, offset,
+                  jmin(maxBlockSize, numSamples - offset), renderQuantum);
+    }
+  }
+
+private:
+  template <typename RenderQuantum>
+  void processPart(AudioBuffer<float> &buffer, const MidiBuffer &midiMessages,
+                   int offset, int numSamples, RenderQuantum &renderQuantum) {
+    pendingMidi.addEvents(midiMessages, offset, numSamples,
+                          numPendingSamples - offset);
+    numPendingSamples += numSamples;
+
+    for (; numPendingSamples >= kQuantumSize;
+         numPendingSamples -= kQuantumSize) {
+      quantumMidi.clear();
+      quantumMidi.addEvents(pendingMidi, 0, kQuantumSize, 0);
+      laterMidi.clear();
+      laterMidi.addEvents(pendingMidi, kQuantumSize, -1, -kQuantumSize);
+      pendingMidi.swapWith(laterMidi);
+
+      quantumBuffer.clear();
+      renderQuantum(quantumBuffer, quantumMidi);
+
+      int start1, size1, start2, size2;
+      audioFifo.prepareToWrite(kQuantumSize, start1, size1, start2, size2);
+      jassert(size1 + size2 == kQuantumSize);
+      for (auto channel = 0; channel < audioRing.getNumChannels(); ++channel) {
+        audioRing.copyFrom(channel, start1, quantumBuffer, channel, 0, size1);
+        audioRing.copyFrom(channel, start2, quantumBuffer, channel, size1,
+                           size2);
+      }
+      audioFifo.finishedWrite(size1 + size2);
+    }
+
+    // What is left pending is always less than a quantum, so the latency
+    // covers it.
+    int start1, size1, start2, size2;
+    audioFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+    jassert(size1 + size2 == numSamples);
+    const auto numChannels =
+        jmin(buffer.getNumChannels(), audioRing.getNumChannels());
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      buffer.copyFrom(channel, offset, audioRing, channel, start1, size1);
+      buffer.copyFrom(channel, offset + size1, audioRing, channel, start2,
+                      size2);
+    }
+    audioFifo.finishedRead(size1 + size2);
+  }
+
+  static constexpr int kMidiBufferSize = 4096;
+
+  int maxBlockSize = 0;
+  AbstractFifo audioFifo{1};
+  AudioBuffer<float> audioRing;
+  AudioBuffer<float> quantumBuffer;
+
+  /**
+   * MIDI not yet rendered, timed from the start of the next quantum.
+   */
+  MidiBuffer pendingMidi;
+  MidiBuffer quantumMidi, laterMidi;
+  /**
+   * The number of samples received since the start of the next quantum.
+   */
+  int numPendingSamples = 0;
+};
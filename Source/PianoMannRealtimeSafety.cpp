@@ -0,0 +1,338 @@
+/*
+  ==============================================================================
+
+    PianoMannRealtimeSafety.cpp
+    Created: 19 Oct 2026 3:05:44pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannRealtimeSafety.h"
+
+#if PIANOMANN_CHECK_REALTIME_SAFETY
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_WINDOWS
+#include <malloc.h>
+#endif
+
+#if JUCE_LINUX
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace PianoMannRealtimeSafety {
+namespace {
+// The initial-exec model keeps the first access from allocating, which would
+// recurse into the malloc hook below.
+#if JUCE_LINUX
+__attribute__((tls_model("initial-exec")))
+#endif
+thread_local int audioCallbackDepth = 0;
+#if JUCE_LINUX
+__attribute__((tls_model("initial-exec")))
+#endif
+thread_local const ScopedAllowedLock *innermostAllowedLock = nullptr;
+} // namespace
+
+ScopedAudioCallback::ScopedAudioCallback() { ++audioCallbackDepth; }
+ScopedAudioCallback::~ScopedAudioCallback() { --audioCallbackDepth; }
+
+bool isInAudioCallback() { return audioCallbackDepth > 0; }
+
+ScopedAllowedLock::ScopedAllowedLock(const CriticalSection &lockToAllow)
+    : lock(lockToAllow), outer(innermostAllowedLock) {
+  innermostAllowedLock = this;
+}
+
+ScopedAllowedLock::~ScopedAllowedLock() { innermostAllowedLock = outer; }
+
+bool isAllowedLock(const void *mutex) {
+  // A `CriticalSection` holds its platform mutex within itself.
+  const auto address = reinterpret_cast<pointer_sized_uint>(mutex);
+  for (auto *allowed = innermostAllowedLock; allowed != nullptr;
+       allowed = allowed->outer) {
+    const auto lockAddress =
+        reinterpret_cast<pointer_sized_uint>(&allowed->lock);
+    if (address >= lockAddress &&
+        address < lockAddress + sizeof(CriticalSection)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void reportViolation(const char *operation) {
+  // Leave the callback first so that reporting cannot trip the checks again.
+  audioCallbackDepth = 0;
+  std::fprintf(stderr, "PianoMann: %s inside the audio callback\n", operation);
+  std::abort();
+}
+} // namespace PianoMannRealtimeSafety
+
+using PianoMannRealtimeSafety::isInAudioCallback;
+using PianoMannRealtimeSafety::reportViolation;
+
+//==============================================================================
+void *operator new(std::size_t size) {
+  if (isInAudioCallback()) {
+    reportViolation("operator new");
+  }
+  if (auto *memory = std::malloc(size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  if (isInAudioCallback()) {
+    reportViolation("operator new");
+  }
+  return std::malloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void *memory) noexcept {
+  if (memory != nullptr && isInAudioCallback()) {
+    reportViolation("operator delete");
+  }
+  std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept { operator delete(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept {
+  operator delete(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+  operator delete(memory);
+}
+
+//==============================================================================
+/**
+ * Over-aligned allocations need the platform's aligned allocator, and memory from it must go back
+ * through its matching free.
+ */
+static void *allocateAligned(std::size_t size, std::align_val_t alignment) {
+  // Even an empty allocation must return a unique pointer.
+  const auto numBytes = size > 0 ? size : 1;
+#if JUCE_WINDOWS
+  return _aligned_malloc(numBytes, static_cast<std::size_t>(alignment));
+#else
+  void *memory = nullptr;
+  return posix_memalign(&memory, static_cast<std::size_t>(alignment),
+                        numBytes) == 0
+             ? memory
+             : nullptr;
+#endif
+}
+
+static void freeAligned(void *memory) {
+#if JUCE_WINDOWS
+  _aligned_free(memory);
+#else
+  std::free(memory);
+#endif
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  if (isInAudioCallback()) {
+    reportViolation("aligned operator new");
+  }
+  if (auto *memory = allocateAligned(size, alignment)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  if (isInAudioCallback()) {
+    reportViolation("aligned operator new");
+  }
+  return allocateAligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &tag) noexcept {
+  return operator new(size, alignment, tag);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  if (memory != nullptr && isInAudioCallback()) {
+    reportViolation("aligned operator delete");
+  }
+  freeAligned(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t alignment) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete(void *memory, std::size_t,
+                     std::align_val_t alignment) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete[](void *memory, std::size_t,
+                       std::align_val_t alignment) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete(void *memory, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete[](void *memory, std::align_val_t alignment,
+                       const std::nothrow_t &) noexcept {
+  operator delete(memory, alignment);
+}
+
+//==============================================================================
+#if JUCE_LINUX
+/**
+ * Looks up the libc implementation of an intercepted function.
+ */
+template <typename Function> static Function getNextFunction(const char *name) {
+  return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *memory, size_t size);
+void __libc_free(void *memory);
+
+void *malloc(size_t size) {
+  if (isInAudioCallback()) {
+    reportViolation("malloc");
+  }
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  if (isInAudioCallback()) {
+    reportViolation("calloc");
+  }
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *memory, size_t size) {
+  if (isInAudioCallback()) {
+    reportViolation("realloc");
+  }
+  return __libc_realloc(memory, size);
+}
+
+void free(void *memory) {
+  if (memory != nullptr && isInAudioCallback()) {
+    reportViolation("free");
+  }
+  __libc_free(memory);
+}
+
+int posix_memalign(void **memory, size_t alignment, size_t size) {
+  static const auto nextPosixMemalign =
+      getNextFunction<int (*)(void **, size_t, size_t)>("posix_memalign");
+  if (isInAudioCallback()) {
+    reportViolation("posix_memalign");
+  }
+  return nextPosixMemalign(memory, alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  static const auto nextAlignedAlloc =
+      getNextFunction<void *(*)(size_t, size_t)>("aligned_alloc");
+  if (isInAudioCallback()) {
+    reportViolation("aligned_alloc");
+  }
+  return nextAlignedAlloc(alignment, size);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+  static const auto nextMutexLock =
+      getNextFunction<int (*)(pthread_mutex_t *)>("pthread_mutex_lock");
+  // Even a lock that happens to be free now can be held by another thread
+  // the next time, so every lock that was not explicitly allowed counts.
+  if (isInAudioCallback() && !PianoMannRealtimeSafety::isAllowedLock(mutex)) {
+    reportViolation("pthread_mutex_lock");
+  }
+  return nextMutexLock(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex) {
+  static const auto nextMutexTrylock =
+      getNextFunction<int (*)(pthread_mutex_t *)>("pthread_mutex_trylock");
+  // A try-lock never waits, but the mutex it takes is shared with a thread
+  // that does, so it is held to the same rule as a lock.
+  if (isInAudioCallback() && !PianoMannRealtimeSafety::isAllowedLock(mutex)) {
+    reportViolation("pthread_mutex_trylock");
+  }
+  return nextMutexTrylock(mutex);
+}
+
+int sem_wait(sem_t *semaphore) {
+  static const auto nextSemWait = getNextFunction<int (*)(sem_t *)>("sem_wait");
+  if (isInAudioCallback()) {
+    reportViolation("sem_wait");
+  }
+  return nextSemWait(semaphore);
+}
+
+ssize_t read(int fileDescriptor, void *data, size_t size) {
+  static const auto nextRead =
+      getNextFunction<ssize_t (*)(int, void *, size_t)>("read");
+  if (isInAudioCallback()) {
+    reportViolation("read");
+  }
+  return nextRead(fileDescriptor, data, size);
+}
+
+ssize_t write(int fileDescriptor, const void *data, size_t size) {
+  static const auto nextWrite =
+      getNextFunction<ssize_t (*)(int, const void *, size_t)>("write");
+  if (isInAudioCallback()) {
+    reportViolation("write");
+  }
+  return nextWrite(fileDescriptor, data, size);
+}
+
+int nanosleep(const struct timespec *duration, struct timespec *remaining) {
+  static const auto nextNanosleep =
+      getNextFunction<int (*)(const struct timespec *, struct timespec *)>(
+          "nanosleep");
+  if (isInAudioCallback()) {
+    reportViolation("nanosleep");
+  }
+  return nextNanosleep(duration, remaining);
+}
+
+int usleep(useconds_t microseconds) {
+  static const auto nextUsleep = getNextFunction<int (*)(useconds_t)>("usleep");
+  if (isInAudioCallback()) {
+    reportViolation("usleep");
+  }
+  return nextUsleep(microseconds);
+}
+} // extern "C"
+#endif
+
+#endif
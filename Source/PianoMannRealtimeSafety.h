@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    PianoMannRealtimeSafety.h
+    Created: 19 Oct 2026 3:05:44pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Debug builds can define `PIANOMANN_CHECK_REALTIME_SAFETY=1` to abort as soon as the audio
+ * callback allocates, locks a mutex, sleeps or does file I/O. Allocations are caught through the
+ * global `operator new`, aligned or not, everywhere, and additionally through `malloc` and friends,
+ * `posix_memalign` and `aligned_alloc` on Linux, where mutexes (locked or tried), `sem_wait` and
+ * the `read`, `write`, `nanosleep` and `usleep` system calls are intercepted too. The test runner
+ * is built with the checks on.
+ *
+ * The checks are not exhaustive. Elsewhere only `operator new` is caught, and even on Linux the
+ * obsolete `memalign` and `valloc`, condition variables, timed waits and any other system call,
+ * such as `open` or a raw futex, go through unnoticed.
+ */
+#ifndef PIANOMANN_CHECK_REALTIME_SAFETY
+#define PIANOMANN_CHECK_REALTIME_SAFETY 0
+#endif
+
+namespace PianoMannRealtimeSafety {
+#if PIANOMANN_CHECK_REALTIME_SAFETY
+/**
+ * Marks the current thread as running the audio callback for the lifetime of this object.
+ */
+class ScopedAudioCallback {
+public:
+  ScopedAudioCallback();
+  ~ScopedAudioCallback();
+
+private:
+  JUCE_DECLARE_NON_COPYABLE(ScopedAudioCallback)
+};
+
+bool isInAudioCallback();
+
+/**
+ * Allows the audio callback to lock `lock` for the lifetime of this object, and no other mutex.
+ * Any other lock is still a violation, however briefly it would be held.
+ */
+class ScopedAllowedLock {
+public:
+  explicit ScopedAllowedLock(const CriticalSection &lockToAllow);
+  ~ScopedAllowedLock();
+
+private:
+  const CriticalSection &lock;
+  const ScopedAllowedLock *const outer;
+  friend bool isAllowedLock(const void *mutex);
+  JUCE_DECLARE_NON_COPYABLE(ScopedAllowedLock)
+};
+
+/**
+ * Whether `mutex` lies within a lock the current thread was allowed by a `ScopedAllowedLock`.
+ */
+bool isAllowedLock(const void *mutex);
+
+/**
+ * Reports `operation` as unsafe for the audio callback and aborts.
+ */
+void reportViolation(const char *operation);
+#else
+class ScopedAudioCallback {
+public:
+  ScopedAudioCallback() {}
+};
+
+class ScopedAllowedLock {
+public:
+  explicit ScopedAllowedLock(const CriticalSection &) {}
+};
+#endif
+} // namespace PianoMannRealtimeSafety
@@ -0,0 +1,298 @@
+/*
+  ==============================================================================
+
+    PianoMannRecorder.h
+    Created: 19 Oct 2026 6:21:44pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * Records the plugin's output to disk along with the MIDI that played it, so a take can later be
+ * re-rendered through the offline path.
+ *
+ * The audio thread only copies into lock-free FIFOs. A background thread drains them, encoding
+ * the audio as WAV or FLAC and collecting the MIDI, which is written as a standard MIDI file next
+ * to the audio when recording stops. If the background thread falls behind, whole callbacks are
+ * dropped rather than blocking the audio thread.
+ */
+class PianoMannRecorder : private Thread {
+public:
+  PianoMannRecorder() : Thread("PianoMann recorder"), midiFifo(kMidiFifoSize) {
+    midiEvents.resize(kMidiFifoSize);
+  }
+  ~PianoMannRecorder() override { stop(); }
+
+  /**
+   * A new file for a take in the user's music folder, with an extension of ".wav" or ".flac".
+   */
+  static File getDefaultFile(const String &extension) {
+    return File::getSpecialLocation(File::userMusicDirectory)
+        .getChildFile("PianoMann")
+        .getChildFile("PianoMann " +
+                      Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") +
+                      extension)
+        .getNonexistentSibling();
+  }
+
+  /**
+   * Allocates the FIFOs, stopping any recording in progress.
+   */
+  void prepare(double newSampleRate, int newNumChannels) {
+    stop();
+    sampleRate = newSampleRate;
+    numChannels = newNumChannels;
+    // AbstractFifo can hold one sample less than its size.
+    const auto capacity = roundToInt(sampleRate * kFifoSeconds) + 1;
+    audioRing.setSize(numChannels, capacity);
+    audioFifo.setTotalSize(capacity);
+    audioFifo.reset();
+    midiFifo.reset();
+  }
+
+  /**
+   * Starts recording to `audioFile`, encoded as FLAC if it has a ".flac" extension and as WAV
+   * otherwise. The MIDI goes to a ".mid" file of the same name. Returns whether the audio file
+   * could be created.
+   */
+  bool start(const File &audioFile) {
+    stop();
+    if (sampleRate <= 0.0 || numChannels <= 0 ||
+        !audioFile.getParentDirectory().createDirectory()) {
+      return false;
+    }
+
+    std::unique_ptr<AudioFormat> format;
+    if (audioFile.hasFileExtension(".flac")) {
+      format = std::make_unique<FlacAudioFormat>();
+    } else {
+      format = std::make_unique<WavAudioFormat>();
+    }
+    audioFile.deleteFile();
+    std::unique_ptr<FileOutputStream> output(audioFile.createOutputStream());
+    if (output == nullptr) {
+      return false;
+    }
+    constexpr auto kBitsPerSample = 24;
+    writer.reset(format->createWriterFor(output.get(), sampleRate,
+                                         static_cast<unsigned int>(numChannels),
+                                         kBitsPerSample, {}, 0));
+    if (writer == nullptr) {
+      return false;
+    }
+    // The writer owns the stream now.
+    output.release();
+
+    midiFile = audioFile.withFileExtension(".mid");
+    recordedMidi.clear();
+    numDroppedSamples = 0;
+
+    // Anything left over from the last take was pushed after it stopped.
+    audioFifo.finishedRead(audioFifo.getNumReady());
+    midiFifo.finishedRead(midiFifo.getNumReady());
+    ++recordingGeneration;
+    isRecording.store(true, std::memory_order_release);
+    startThread(4);
+    return true;
+  }
+
+  /**
+   * Stops recording, finishing the audio file and writing the MIDI file.
+   */
+  void stop() {
+    isRecording.store(false, std::memory_order_release);
+    if (writer == nullptr) {
+      return;
+    }
+    // The background thread drains what is left before exiting.
+    stopThread(-1);
+    writer.reset();
+
+    MidiFile file;
+    // 25 frames of 40 ticks each per second, so one tick per millisecond.
+    file.setSmpteTimeFormat(25, 40);
+    recordedMidi.updateMatchedPairs();
+    file.addTrack(recordedMidi);
+    midiFile.deleteFile();
+    FileOutputStream output(midiFile);
+    if (output.openedOk()) {
+      file.writeTo(output);
+    }
+  }
+
+  bool isRecordingInProgress() const {
+    return isRecording.load(std::memory_order_acquire);
+  }
+
+  /**
+   * The number of samples dropped from the current take because the disk could not keep up.
+   */
+  int64 getNumDroppedSamples() const { return numDroppedSamples.load(); }
+
+  /**
+   * Records the first channels of `buffer` and the MIDI of the same callback. Called from the
+   * audio thread.
+   */
+  void process(const AudioBuffer<float> &buffer, const MidiBuffer &midiMessages) {
+    if (!isRecording.load(std::memory_order_acquire)) {
+      return;
+    }
+    const auto generation = recordingGeneration.load(std::memory_order_relaxed);
+    if (generation != processedGeneration) {
+      processedGeneration = generation;
+      recordedPosition = 0;
+    }
+
+    const auto numSamples = buffer.getNumSamples();
+    const auto numMidiEvents = countRecordedEvents(midiMessages);
+    int start1, size1, start2, size2;
+    audioFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    if (size1 + size2 < numSamples ||
+        midiFifo.getFreeSpace() < numMidiEvents) {
+      // The whole callback is dropped, so no note is recorded without the
+      // audio it played.
+      numDroppedSamples += numSamples;
+      return;
+    }
+
+    int midiStart1, midiSize1, midiStart2, midiSize2;
+    midiFifo.prepareToWrite(numMidiEvents, midiStart1, midiSize1, midiStart2,
+                            midiSize2);
+    auto midiIndex = midiStart1;
+    MidiBuffer::Iterator midiIterator(midiMessages);
+    const uint8 *midiData;
+    int numBytes, samplePosition;
+    while (midiIterator.getNextEvent(midiData, numBytes, samplePosition)) {
+      if (numBytes > kMaxMidiEventSize) {
+        continue;
+      }
+      if (midiIndex == midiStart1 + midiSize1) {
+        midiIndex = midiStart2;
+      }
+      auto &event = midiEvents[static_cast<size_t>(midiIndex++)];
+      event.time = recordedPosition + samplePosition;
+      event.size = numBytes;
+      std::copy(midiData, midiData + numBytes, event.data);
+    }
+    midiFifo.finishedWrite(numMidiEvents);
+
+    const auto numChannelsToRecord = jmin(numChannels, buffer.getNumChannels());
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      if (channel < numChannelsToRecord) {
+        audioRing.copyFrom(channel, start1, buffer, channel, 0, size1);
+        audioRing.copyFrom(channel, start2, buffer, channel, size1, size2);
+      } else {
+        audioRing.clear(channel, start1, size1);
+        audioRing.clear(channel, start2, size2);
+      }
+    }
+    audioFifo.finishedWrite(numSamples);
+    recordedPosition += numSamples;
+  }
+
+private:
+  /**
+   * Sysex does not affect the voices, so it is not recorded.
+   */
+  static int countRecordedEvents(const MidiBuffer &midiMessages) {
+    MidiBuffer::Iterator midiIterator(midiMessages);
+    const uint8 *midiData;
+    int numBytes, samplePosition;
+    auto numEvents = 0;
+    while (midiIterator.getNextEvent(midiData, numBytes, samplePosition)) {
+      numEvents += numBytes <= kMaxMidiEventSize ? 1 : 0;
+    }
+    return numEvents;
+  }
+
+  void run() override {
+    while (!threadShouldExit()) {
+      drain();
+      wait(kPollMilliseconds);
+    }
+    drain();
+  }
+
+  void drain() {
+    int start1, size1, start2, size2;
+    midiFifo.prepareToRead(midiFifo.getNumReady(), start1, size1, start2, size2);
+    addMidiFromFifo(start1, size1);
+    addMidiFromFifo(start2, size2);
+    midiFifo.finishedRead(size1 + size2);
+
+    audioFifo.prepareToRead(audioFifo.getNumReady(), start1, size1, start2,
+                            size2);
+    writeFromRing(start1, size1);
+    writeFromRing(start2, size2);
+    audioFifo.finishedRead(size1 + size2);
+  }
+
+  void addMidiFromFifo(int startIndex, int numEvents) {
+    // The MIDI file has one tick per millisecond.
+    constexpr auto kTicksPerSecond = 1000.0;
+    for (auto index = startIndex; index < startIndex + numEvents; ++index) {
+      const auto &event = midiEvents[static_cast<size_t>(index)];
+      recordedMidi.addEvent(MidiMessage(
+          event.data, event.size,
+          static_cast<double>(event.time) * kTicksPerSecond / sampleRate));
+    }
+  }
+
+  void writeFromRing(int startSample, int numSamples) {
+    if (numSamples == 0) {
+      return;
+    }
+    channelPointers.resize(static_cast<size_t>(numChannels));
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      channelPointers[static_cast<size_t>(channel)] =
+          audioRing.getReadPointer(channel, startSample);
+    }
+    writer->writeFromFloatArrays(channelPointers.data(), numChannels,
+                                 numSamples);
+  }
+
+  static constexpr double kFifoSeconds = 4.0;
+  static constexpr int kPollMilliseconds = 20;
+  static constexpr int kMidiFifoSize = 4096;
+  static constexpr int kMaxMidiEventSize = 3;
+
+  double sampleRate = 0.0;
+  int numChannels = 0;
+
+  AudioBuffer<float> audioRing;
+  AbstractFifo audioFifo{1};
+
+  struct RecordedMidiEvent {
+    int64 time;
+    int size;
+    uint8 data[kMaxMidiEventSize];
+  };
+  AbstractFifo midiFifo;
+  std::vector<RecordedMidiEvent> midiEvents;
+
+  std::atomic<bool> isRecording{false};
+  std::atomic<int> recordingGeneration{0};
+  std::atomic<int64> numDroppedSamples{0};
+
+  /**
+   * Owned by the audio thread: the take being recorded and the number of samples recorded of it.
+   */
+  int processedGeneration = 0;
+  int64 recordedPosition = 0;
+
+  /**
+   * Owned by the background thread while recording.
+   */
+  std::unique_ptr<AudioFormatWriter> writer;
+  std::vector<const float *> channelPointers;
+  MidiMessageSequence recordedMidi;
+  File midiFile;
+};
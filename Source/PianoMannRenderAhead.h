@@ -0,0 +1,242 @@
+/*
+  ==============================================================================
+
+    PianoMannRenderAhead.h
+    Created: 19 Oct 2026 1:34:08pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannSynthesiser.h"
+#include "PianoMannTrace.h"
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * Renders a synthesiser on a background thread ahead of the audio callback. The callback hands
+ * over its MIDI and copies out audio rendered `getLatencySamples()` earlier, so a dense passage
+ * can take longer than one callback to render as long as it averages out within the latency.
+ *
+ * Communication with the audio thread is through lock-free FIFOs only. The background thread polls
+ * instead of being notified, since waking it would take a lock on the audio thread.
+ */
+class PianoMannRenderAhead : private Thread {
+public:
+  explicit PianoMannRenderAhead(PianoMannSynthesiser &synthToRender)
+      : Thread("PianoMann render-ahead"), synth(synthToRender),
+        midiFifo(kMidiFifoSize), midiEvents(kMidiFifoSize), audioFifo(1) {}
+
+  ~PianoMannRenderAhead() override { stop(); }
+
+  /**
+   * The latency required for rendering ahead at a given sample rate and block size.
+   */
+  static int getLatencySamplesFor(double sampleRate, int maximumBlockSize) {
+    constexpr auto kLatencySeconds = 0.1;
+    return jmax(2 * maximumBlockSize, roundToInt(sampleRate * kLatencySeconds));
+  }
+
+  /**
+   * Starts rendering on the background thread. The synthesiser must already be prepared and
+   * must not be used elsewhere until `stop` is called. Returns the latency introduced.
+   */
+  int start(double sampleRate, int maximumBlockSize, int numChannels) {
+    stop();
+
+    latencySamples = getLatencySamplesFor(sampleRate, maximumBlockSize);
+    // AbstractFifo can hold one sample less than its size.
+    const auto capacity = latencySamples + maximumBlockSize + 1;
+    audioRing.setSize(numChannels, capacity);
+    audioRing.clear();
+    audioFifo.setTotalSize(capacity);
+    audioFifo.reset();
+    // Prime the output with silence so the first callbacks have audio to
+    // copy out while the background thread catches up.
+    int start1, size1, start2, size2;
+    audioFifo.prepareToWrite(latencySamples, start1, size1, start2, size2);
+    audioFifo.finishedWrite(size1 + size2);
+
+    midiFifo.reset();
+    renderBuffer.setSize(numChannels, kMaxRenderChunkSize);
+    renderMidi.ensureSize(kMidiFifoSize * 4);
+
+    inputEndPosition = 0;
+    renderedPosition = 0;
+    numUnderruns = 0;
+    numSamplesBehind = 0;
+
+    startThread(8);
+    return latencySamples;
+  }
+
+  void stop() { stopThread(1000); }
+
+  int getLatencySamples() const { return latencySamples; }
+
+  /**
+   * The number of callbacks which found less audio ready than they needed, since `start`.
+   */
+  int getNumUnderruns() const { return numUnderruns.load(); }
+
+  /**
+   * The longest MIDI message scheduled. Only short messages are, since sysex does not affect the
+   * voices.
+   */
+  static constexpr int kMaxMidiEventSize = 3;
+
+  /**
+   * Queues the MIDI event of `size` bytes at `data` at `samplePosition` within the current
+   * callback. Longer messages than `kMaxMidiEventSize` are ignored. Called from the audio thread
+   * before `processNextBlock`.
+   */
+  void pushMidiEvent(const uint8 *data, int size, int samplePosition) {
+    if (size > kMaxMidiEventSize) {
+      return;
+    }
+    int start1, size1, start2, size2;
+    midiFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 == 0) {
+      jassertfalse; // The background thread is too far behind.
+      return;
+    }
+    auto &event = midiEvents[static_cast<size_t>(start1)];
+    event.time = inputEndPosition.load(std::memory_order_relaxed) + samplePosition;
+    event.size = size;
+    std::copy(data, data + size, event.data);
+    midiFifo.finishedWrite(1);
+  }
+
+  /**
+   * Publishes the MIDI queued for this callback and copies the audio rendered for it into
+   * `outputBuffer`, replacing its contents. Called from the audio thread.
+   *
+   * A callback that finds too little audio ready plays silence for the rest, and the audio it
+   * missed is skipped once rendered so that the output keeps to the latency reported.
+   */
+  void processNextBlock(AudioBuffer<float> &outputBuffer, int numSamples) {
+    inputEndPosition.store(inputEndPosition.load(std::memory_order_relaxed) +
+                               numSamples,
+                           std::memory_order_release);
+
+    if (numSamplesBehind > 0) {
+      const auto numSamplesToSkip = jmin(
+          numSamplesBehind, jmax(0, audioFifo.getNumReady() - numSamples));
+      audioFifo.finishedRead(numSamplesToSkip);
+      numSamplesBehind -= numSamplesToSkip;
+    }
+
+    int start1, size1, start2, size2;
+    audioFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+    const auto numChannels =
+        jmin(outputBuffer.getNumChannels(), audioRing.getNumChannels());
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      outputBuffer.copyFrom(channel, 0, audioRing, channel, start1, size1);
+      outputBuffer.copyFrom(channel, size1, audioRing, channel, start2, size2);
+    }
+    audioFifo.finishedRead(size1 + size2);
+
+    if (size1 + size2 < numSamples) {
+      ++numUnderruns;
+      numSamplesBehind += numSamples - (size1 + size2);
+      outputBuffer.clear(size1 + size2, numSamples - (size1 + size2));
+    }
+  }
+
+private:
+  void run() override {
+    while (!threadShouldExit()) {
+      const auto numSamplesAvailable =
+          inputEndPosition.load(std::memory_order_acquire) - renderedPosition;
+      auto numSamples = static_cast<int>(jmin<int64>(
+          numSamplesAvailable, audioFifo.getFreeSpace(), kMaxRenderChunkSize));
+      // The latency leaves room to wait for whole quanta of the synthesiser.
+      numSamples -= numSamples % PianoMannSynthesiser::kQuantumSize;
+      if (numSamples <= 0) {
+        wait(1);
+        continue;
+      }
+      renderChunk(numSamples);
+    }
+  }
+
+  void renderChunk(int numSamples) {
+    const auto chunkEndPosition = renderedPosition + numSamples;
+
+    renderMidi.clear();
+    for (;;) {
+      int start1, size1, start2, size2;
+      midiFifo.prepareToRead(1, start1, size1, start2, size2);
+      if (size1 == 0) {
+        break;
+      }
+      const auto &event = midiEvents[static_cast<size_t>(start1)];
+      if (event.time >= chunkEndPosition) {
+        break;
+      }
+      renderMidi.addEvent(event.data, event.size,
+                          static_cast<int>(event.time - renderedPosition));
+      midiFifo.finishedRead(1);
+    }
+
+    AudioBuffer<float> chunk(renderBuffer.getArrayOfWritePointers(),
+                             renderBuffer.getNumChannels(), numSamples);
+    chunk.clear();
+    PIANOMANN_TRACE_SCOPE_ARG("renderAhead", "numSamples", numSamples);
+    synth.renderNextBlock(chunk, renderMidi, 0, numSamples);
+
+    int start1, size1, start2, size2;
+    audioFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    jassert(size1 + size2 == numSamples);
+    for (auto channel = 0; channel < chunk.getNumChannels(); ++channel) {
+      audioRing.copyFrom(channel, start1, chunk, channel, 0, size1);
+      audioRing.copyFrom(channel, start2, chunk, channel, size1, size2);
+    }
+    audioFifo.finishedWrite(size1 + size2);
+
+    renderedPosition = chunkEndPosition;
+  }
+
+  static constexpr int kMidiFifoSize = 4096;
+  static constexpr int kMaxRenderChunkSize = 512;
+
+  struct ScheduledMidiEvent {
+    /**
+     * The position of the event in the stream of samples handed to the audio callback.
+     */
+    int64 time;
+    int size;
+    uint8 data[kMaxMidiEventSize];
+  };
+
+  PianoMannSynthesiser &synth;
+
+  AbstractFifo midiFifo;
+  std::vector<ScheduledMidiEvent> midiEvents;
+  AbstractFifo audioFifo;
+  AudioBuffer<float> audioRing;
+
+  /**
+   * The number of samples the audio callback has asked for so far. Everything before this has
+   * had its MIDI queued.
+   */
+  std::atomic<int64> inputEndPosition{0};
+  /**
+   * The number of samples rendered so far. Only touched by the background thread.
+   */
+  int64 renderedPosition = 0;
+
+  AudioBuffer<float> renderBuffer;
+  MidiBuffer renderMidi;
+
+  int latencySamples = 0;
+  std::atomic<int> numUnderruns{0};
+  /**
+   * How far the output has fallen behind the latency through underruns. Only touched by the audio
+   * thread.
+   */
+  int numSamplesBehind = 0;
+};
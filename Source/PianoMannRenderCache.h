@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    PianoMannRenderCache.h
+    Created: 19 Oct 2026 4:12:51pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannVoice.h"
+#include <JuceHeader.h>
+#include <array>
+#include <cstring>
+
+/**
+ * Persists the render caches of a synthesiser's voices across sessions, so the first strike of
+ * each note after loading is already played back from the cache. Caches are restored one voice
+ * at a time through a `Reader` as the voices are prepared.
+ *
+ * A cache file is only valid for the sample rate and excitation seed it was recorded with, and
+ * each entry for the loop its string was tuned and voiced to. It is laid out as a header followed
+ * by one entry per note:
+ *
+ *   Header: magic "PMRC", int32 version, int32 number of entries, float64 sample rate, int64 seed
+ *   Entry:  int32 MIDI note number, int32 number of samples, float64 frequency,
+ *           float32 weighted average filter, float32 sustain, float32 samples...
+ *
+ * All values are little-endian, as written by `FileOutputStream`, and every entry stays 4-byte
+ * aligned so the samples can be read in place.
+ */
+class PianoMannRenderCache {
+public:
+  /**
+   * The file caching renders at a given sample rate and seed.
+   */
+  static File getDefaultFile(double sampleRate, int64 excitationSeed) {
+    return File::getSpecialLocation(File::userApplicationDataDirectory)
+        .getChildFile("PianoMann")
+        .getChildFile("RenderCache")
+        .getChildFile(String(roundToInt(sampleRate)) + "-" +
+                      String::toHexString(excitationSeed) + ".pmcache");
+  }
+
+  /**
+   * A read-only view of a cache file, indexed by note. The file is memory-mapped, and entries are
+   * copied into the voices' own caches as they are prepared, so the audio thread never touches
+   * the mapping.
+   */
+  class Reader {
+  public:
+    Reader(const File &file, double sampleRate, int64 excitationSeed)
+        : mappedFile(file, MemoryMappedFile::readOnly) {
+      const auto *data = static_cast<const char *>(mappedFile.getData());
+      const auto size = mappedFile.getSize();
+      if (data == nullptr || size < kHeaderSize ||
+          std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        return;
+      }
+
+      const auto version = read<int32>(data + 4);
+      const auto numEntries = read<int32>(data + 8);
+      const auto fileSampleRate = read<double>(data + 12);
+      const auto fileExcitationSeed = read<int64>(data + 20);
+      if (version != kVersion || fileSampleRate != sampleRate ||
+          fileExcitationSeed != excitationSeed) {
+        return;
+      }
+
+      auto offset = kHeaderSize;
+      for (auto entryIndex = 0; entryIndex < numEntries; ++entryIndex) {
+        if (offset + kEntryHeaderSize > size) {
+          return;
+        }
+        const auto midiNoteNumber = read<int32>(data + offset);
+        const auto numSamples = read<int32>(data + offset + 4);
+        const auto frequency = read<double>(data + offset + 8);
+        const auto weightedAverageFilter = read<float>(data + offset + 16);
+        const auto sustainLoopGain = read<float>(data + offset + 20);
+        offset += kEntryHeaderSize;
+        const auto numBytes = static_cast<size_t>(numSamples) * sizeof(float);
+        if (numSamples < 0 || offset + numBytes > size) {
+          return;
+        }
+
+        if (isPositiveAndBelow(midiNoteNumber, static_cast<int>(entries.size()))) {
+          entries[static_cast<size_t>(midiNoteNumber)] = {
+              reinterpret_cast<const float *>(data + offset), numSamples,
+              frequency, weightedAverageFilter, sustainLoopGain};
+        }
+        offset += numBytes;
+      }
+    }
+
+    struct Entry {
+      const float *samples = nullptr;
+      int numSamples = 0;
+      /**
+       * The loop the string was tuned to, see `PianoMannVoice::getStringTuning`.
+       */
+      double frequency = 0.0;
+      float weightedAverageFilter = 0.f;
+      float sustainLoopGain = 0.f;
+
+      bool isRecordedWith(const PianoMannStringTuning &tuning) const {
+        return frequency == tuning.frequency &&
+               weightedAverageFilter == tuning.weightedAverageFilter &&
+               sustainLoopGain == tuning.sustainLoopGain;
+      }
+    };
+
+    /**
+     * The cached samples of a note, which are empty if the file has none or is unusable.
+     */
+    Entry getEntry(int midiNoteNumber) const {
+      jassert(isPositiveAndBelow(midiNoteNumber, static_cast<int>(entries.size())));
+      return entries[static_cast<size_t>(midiNoteNumber)];
+    }
+
+  private:
+    MemoryMappedFile mappedFile;
+    std::array<Entry, 128> entries;
+
+    JUCE_DECLARE_NON_COPYABLE(Reader)
+  };
+
+  /**
+   * Writes the render caches of `synth` to `file`, replacing it only once fully written. A synth
+   * that recorded nothing, such as one whose strikes all varied, leaves the file as it was rather
+   * than emptying it. Must not be called while the synthesiser is rendering.
+   */
+  static bool save(Synthesiser &synth, const File &file, double sampleRate,
+                   int64 excitationSeed) {
+    auto numEntries = 0;
+    for (auto voiceIndex = 0; voiceIndex < synth.getNumVoices(); ++voiceIndex) {
+      if (asPianoMannVoice(synth, voiceIndex)->getRenderCacheValidLength() > 0) {
+        ++numEntries;
+      }
+    }
+    if (numEntries == 0) {
+      return true;
+    }
+    if (!file.getParentDirectory().createDirectory()) {
+      return false;
+    }
+
+    TemporaryFile temporaryFile(file);
+    {
+      FileOutputStream output(temporaryFile.getFile());
+      if (output.failedToOpen()) {
+        return false;
+      }
+
+      output.write(kMagic, sizeof(kMagic));
+      output.writeInt(kVersion);
+      output.writeInt(numEntries);
+      output.writeDouble(sampleRate);
+      output.writeInt64(excitationSeed);
+      for (auto voiceIndex = 0; voiceIndex < synth.getNumVoices(); ++voiceIndex) {
+        const auto *voice = asPianoMannVoice(synth, voiceIndex);
+        const auto numSamples = voice->getRenderCacheValidLength();
+        if (numSamples > 0) {
+          output.writeInt(voice->getMidiNoteNumber());
+          output.writeInt(numSamples);
+          const auto &tuning = voice->getStringTuning();
+          output.writeDouble(tuning.frequency);
+          output.writeFloat(tuning.weightedAverageFilter);
+          output.writeFloat(tuning.sustainLoopGain);
+          output.write(voice->getRenderCache().data(),
+                       static_cast<size_t>(numSamples) * sizeof(float));
+        }
+      }
+
+      output.flush();
+      if (output.getStatus().failed()) {
+        return false;
+      }
+    }
+    return temporaryFile.overwriteTargetFileWithTemporary();
+  }
+
+private:
+  static constexpr char kMagic[4] = {'P', 'M', 'R', 'C'};
+  static constexpr int32 kVersion = 3;
+  static constexpr size_t kHeaderSize = 28;
+  static constexpr size_t kEntryHeaderSize = 24;
+
+  /**
+   * Little-endian is native on every platform the plugin ships for.
+   */
+  template <typename T> static T read(const char *source) {
+    T value;
+    std::memcpy(&value, source, sizeof(T));
+    return value;
+  }
+
+  static PianoMannVoice *asPianoMannVoice(Synthesiser &synth, int voiceIndex) {
+    // Every voice of a PianoMann synthesiser is a PianoMannVoice.
+    return static_cast<PianoMannVoice *>(synth.getVoice(voiceIndex));
+  }
+};
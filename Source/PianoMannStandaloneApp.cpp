@@ -0,0 +1,410 @@
+/*
+  ==============================================================================
+
+    PianoMannStandaloneApp.cpp
+    Created: 19 Oct 2026 11:59:02pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#if JucePlugin_Build_Standalone && JUCE_USE_CUSTOM_PLUGIN_STANDALONE_APP
+
+#include "PianoMannBenchmarks.h"
+#include "PianoMannQualityGovernor.h"
+#include "PianoMannStressHarness.h"
+#include "PianoMannVoicing.h"
+#include "PluginProcessor.h"
+#include <functional>
+#include <iostream>
+#include <juce_audio_plugin_client/utility/juce_CreatePluginFilter.h>
+#include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+
+namespace {
+constexpr auto kUsage =
+    "Usage: PianoMann --stress-test [options]\n"
+    "\n"
+    "Finds how many instances run without missing a deadline, see\n"
+    "PianoMannStressHarness.\n"
+    "\n"
+    "  --sample-rate <hz>        default 48000\n"
+    "  --block-size <samples>    default 256\n"
+    "  --threads <count>         default one per core\n"
+    "  --max-instances <count>   default 512\n"
+    "  --deadline <fraction>     of each block period, default 0.8\n"
+    "  --seconds <seconds>       counted per trial, default 10\n"
+    "  --editor                  runs every instance as if its editor were\n"
+    "                            open, feeding the visualiser and keyboard\n"
+    "  --tier <tier>             pins every instance to a quality tier from\n"
+    "                            0 (best) to 2, or adaptive, default 0\n"
+    "  --compact-delay-line      keeps ringing strings in half precision\n"
+    "\n"
+    "Usage: PianoMann --benchmark <name> [options]\n"
+    "\n"
+    "Times a single instance, see PianoMannBenchmarks. <name> is one of:\n"
+    "\n"
+    "  pedal                     plays a pedal-heavy MIDI file at each quality\n"
+    "                            tier, reporting how many strings were retired\n"
+    "  editor                    plays a MIDI file with the editor closed and\n"
+    "                            open in turn, reporting what opening it costs\n"
+    "  attack                    plays a MIDI file striking with noise and with\n"
+    "                            the hammer in turn, reporting what the hammer's\n"
+    "                            attacks cost\n"
+    "  block-size                plays a MIDI file in blocks of 1 to 8192\n"
+    "                            samples, ignoring --block-size, reporting\n"
+    "                            the cost of a sample at each\n"
+    "  compact-delay-line        plays a MIDI file with the delay lines in\n"
+    "                            single and half precision in turn, reporting\n"
+    "                            cost, cache misses and the noise floor\n"
+    "\n"
+    "  --midi <file>             default Benchmarks/PedalHeavy.mid\n"
+    "  --sample-rate <hz>        default 48000\n"
+    "  --block-size <samples>    default 256\n"
+    "\n"
+    "Usage: PianoMann --write-voicing <file> [--from <file>]\n"
+    "\n"
+    "Writes a voicing, see PianoMannVoicing, as a .pmvoicing file to load in\n"
+    "the plugin, or as JSON to edit if <file> ends in .json.\n"
+    "\n"
+    "  --from <file>             a voicing as JSON or a .pmvoicing file,\n"
+    "                            default the built-in voicing\n";
+
+String getOption(const StringArray &arguments, const String &name,
+                 const String &defaultValue) {
+  const auto index = arguments.indexOf(name);
+  return index >= 0 && index + 1 < arguments.size() ? arguments[index + 1]
+                                                    : defaultValue;
+}
+
+String formatTrial(const PianoMannStressHarness::Trial &trial) {
+  const auto memory =
+      trial.memoryBytesPerInstance >= 0.0
+          ? String(trial.memoryBytesPerInstance / (1024.0 * 1024.0), 1) + " MB"
+          : String("unknown");
+  return String(trial.numInstances).paddedLeft(' ', 5) + " instances: " +
+         String(trial.numMissedDeadlines) + " of " + String(trial.numBlocks) +
+         " blocks late, load " + String(roundToInt(trial.meanLoad * 100.0)) +
+         "% mean " + String(roundToInt(trial.maxLoad * 100.0)) +
+         "% max, prepare " +
+         String(trial.prepareSecondsPerInstance * 1000.0, 2) +
+         " ms each, ready after " + String(trial.startupSeconds, 2) + " s, " +
+         memory + " each, worst tier " + String(trial.worstQualityTier) +
+         ", " + trial.isaName + " kernels";
+}
+
+/**
+ * Runs a command-line job such as `PianoMannStressHarness` off the message thread at the priority
+ * of an audio thread, then quits the app with a status of whether the job succeeded.
+ */
+class CommandLineJobThread : public Thread {
+public:
+  using Job = std::function<bool(const std::function<bool()> &shouldExit)>;
+
+  CommandLineJobThread(const String &threadName, Job jobToRun)
+      : Thread(threadName), job(std::move(jobToRun)) {}
+
+  ~CommandLineJobThread() override { stopThread(-1); }
+
+  void run() override {
+    const auto hasSucceeded = job([this] { return threadShouldExit(); });
+    MessageManager::callAsync([hasSucceeded] {
+      if (auto *app = JUCEApplicationBase::getInstance()) {
+        app->setApplicationReturnValue(hasSucceeded ? 0 : 1);
+        app->quit();
+      }
+    });
+  }
+
+private:
+  Job job;
+};
+
+bool runStressHarness(const PianoMannStressHarness::Settings &settings,
+                      const std::function<bool()> &shouldExit) {
+  const auto tiers =
+      settings.qualityTier == PianoMannAudioProcessor::kAdaptiveQualityTier
+          ? String("adaptive tiers")
+          : "tier " + String(settings.qualityTier);
+  std::cout << "Block size " << settings.blockSize << " at "
+            << settings.sampleRate << " Hz, deadline "
+            << roundToInt(settings.deadlineFraction * 100.0)
+            << "% of each block, " << tiers
+            << (settings.isEditorOpen ? ", editors open" : "")
+            << (settings.isCompactDelayLineEnabled ? ", compact delay lines"
+                                                   : "")
+            << std::endl;
+  const auto report = PianoMannStressHarness::run(
+      settings,
+      [](const PianoMannStressHarness::Trial &trial) {
+        std::cout << formatTrial(trial) << std::endl;
+      },
+      shouldExit);
+
+  if (report.wasCompleted) {
+    std::cout << "Max instances without a missed deadline: "
+              << report.maxInstances
+              << (report.isLimitedBySettings ? " (--max-instances)" : "")
+              << std::endl;
+    if (report.maxInstances > 0) {
+      std::cout << formatTrial(report.bestTrial) << std::endl;
+    }
+  }
+  return report.wasCompleted;
+}
+
+bool runBenchmark(const String &name,
+                  const PianoMannBenchmarks::Settings &settings,
+                  const std::function<bool()> &shouldExit) {
+  const auto printLine = [](const String &line) {
+    std::cout << line << std::endl;
+  };
+  auto result = Result::fail("Unknown benchmark: " + name);
+  if (name == "pedal") {
+    result = PianoMannBenchmarks::runPedalBenchmark(settings, printLine,
+                                                    shouldExit);
+  } else if (name == "editor") {
+    result = PianoMannBenchmarks::runEditorBenchmark(settings, printLine,
+                                                     shouldExit);
+  } else if (name == "attack") {
+    result = PianoMannBenchmarks::runAttackBenchmark(settings, printLine,
+                                                     shouldExit);
+  } else if (name == "block-size") {
+    result = PianoMannBenchmarks::runBlockSizeBenchmark(settings, printLine,
+                                                        shouldExit);
+  } else if (name == "compact-delay-line") {
+    result = PianoMannBenchmarks::runCompactDelayLineBenchmark(
+        settings, printLine, shouldExit);
+  }
+  if (result.failed()) {
+    std::cerr << result.getErrorMessage() << std::endl;
+  }
+  return result.wasOk();
+}
+
+/**
+ * Writes the voicing described by `--from`, or the built-in one, to the file after
+ * `--write-voicing`, as JSON or compiled to a voicing file.
+ */
+Result writeVoicing(const StringArray &arguments) {
+  const auto outputPath = getOption(arguments, "--write-voicing", {});
+  if (outputPath.isEmpty() || outputPath.startsWith("--")) {
+    return Result::fail("Missing the file to write");
+  }
+  const auto outputFile =
+      File::getCurrentWorkingDirectory().getChildFile(outputPath);
+
+  auto description = PianoMannVoicing::describeBuiltIn();
+  const auto inputPath = getOption(arguments, "--from", {});
+  if (inputPath.isNotEmpty()) {
+    const auto inputFile =
+        File::getCurrentWorkingDirectory().getChildFile(inputPath);
+    if (inputFile.hasFileExtension("json")) {
+      const auto result =
+          PianoMannVoicing::parseJson(inputFile.loadFileAsString(), description);
+      if (result.failed()) {
+        return Result::fail(inputFile.getFullPathName() + ": " +
+                            result.getErrorMessage());
+      }
+    } else {
+      std::shared_ptr<const PianoMannVoicing> voicing;
+      const auto result = PianoMannVoicing::load(inputFile, voicing);
+      if (result.failed()) {
+        return result;
+      }
+      description = voicing->describe();
+    }
+  }
+
+  if (outputFile.hasFileExtension("json")) {
+    return outputFile.replaceWithText(PianoMannVoicing::toJson(description))
+               ? Result::ok()
+               : Result::fail("Could not write " + outputFile.getFullPathName());
+  }
+  return PianoMannVoicing::write(description, outputFile);
+}
+} // namespace
+
+/**
+ * The standalone app as JUCE makes it, which can also run `PianoMannStressHarness` from the
+ * command line with `--stress-test`, `PianoMannBenchmarks` with `--benchmark`, or compile voicings
+ * with `--write-voicing`, instead of opening its window.
+ */
+class PianoMannStandaloneApp : public JUCEApplication {
+public:
+  PianoMannStandaloneApp() {
+    PropertiesFile::Options options;
+    options.applicationName = getApplicationName();
+    options.filenameSuffix = ".settings";
+    options.osxLibrarySubFolder = "Application Support";
+#if JUCE_LINUX
+    options.folderName = "~/.config";
+#else
+    options.folderName = "";
+#endif
+    appProperties.setStorageParameters(options);
+  }
+
+  const String getApplicationName() override { return JucePlugin_Name; }
+  const String getApplicationVersion() override {
+    return JucePlugin_VersionString;
+  }
+  bool moreThanOneInstanceAllowed() override { return true; }
+  void anotherInstanceStarted(const String &) override {}
+
+  void initialise(const String &commandLine) override {
+    const auto arguments = StringArray::fromTokens(commandLine, true);
+    // Instances are made as a host would make them, rather than as the plugin
+    // of the standalone app.
+    if (arguments.contains("--stress-test")) {
+      runStressTest(arguments);
+      return;
+    }
+    if (arguments.contains("--benchmark")) {
+      runBenchmarks(arguments);
+      return;
+    }
+    if (arguments.contains("--write-voicing")) {
+      const auto result = writeVoicing(arguments);
+      if (result.failed()) {
+        std::cerr << result.getErrorMessage() << std::endl << std::endl
+                  << kUsage;
+      }
+      setApplicationReturnValue(result.wasOk() ? 0 : 1);
+      quit();
+      return;
+    }
+
+    PluginHostType::jucePlugInClientCurrentWrapperType =
+        AudioProcessor::wrapperType_Standalone;
+    mainWindow = std::make_unique<StandaloneFilterWindow>(
+        getApplicationName(),
+        LookAndFeel::getDefaultLookAndFeel().findColour(
+            ResizableWindow::backgroundColourId),
+        appProperties.getUserSettings(), false);
+#if JUCE_STANDALONE_FILTER_WINDOW_USE_KIOSK_MODE
+    Desktop::getInstance().setKioskModeComponent(mainWindow.get(), false);
+#endif
+    mainWindow->setVisible(true);
+  }
+
+  void shutdown() override {
+    commandLineJobThread = nullptr;
+    mainWindow = nullptr;
+    appProperties.saveIfNeeded();
+  }
+
+  void systemRequestedQuit() override {
+    if (mainWindow != nullptr) {
+      mainWindow->pluginHolder->savePluginState();
+    }
+    if (ModalComponentManager::getInstance()->cancelAllModalComponents()) {
+      Timer::callAfterDelay(100, [] {
+        if (auto *app = JUCEApplicationBase::getInstance()) {
+          app->systemRequestedQuit();
+        }
+      });
+    } else {
+      quit();
+    }
+  }
+
+private:
+  void runStressTest(const StringArray &arguments) {
+    if (arguments.contains("--help")) {
+      std::cout << kUsage;
+      quit();
+      return;
+    }
+    PianoMannStressHarness::Settings settings;
+    settings.sampleRate =
+        getOption(arguments, "--sample-rate", String(settings.sampleRate))
+            .getDoubleValue();
+    settings.blockSize =
+        getOption(arguments, "--block-size", String(settings.blockSize))
+            .getIntValue();
+    settings.numThreads =
+        getOption(arguments, "--threads", String(settings.numThreads))
+            .getIntValue();
+    settings.maxInstances =
+        getOption(arguments, "--max-instances", String(settings.maxInstances))
+            .getIntValue();
+    settings.deadlineFraction =
+        getOption(arguments, "--deadline", String(settings.deadlineFraction))
+            .getDoubleValue();
+    settings.trialSeconds =
+        getOption(arguments, "--seconds", String(settings.trialSeconds))
+            .getDoubleValue();
+    settings.isEditorOpen = arguments.contains("--editor");
+    settings.isCompactDelayLineEnabled =
+        arguments.contains("--compact-delay-line");
+    const auto tier =
+        getOption(arguments, "--tier", String(settings.qualityTier));
+    const auto isAdaptive = tier == "adaptive";
+    settings.qualityTier = isAdaptive
+                               ? PianoMannAudioProcessor::kAdaptiveQualityTier
+                               : tier.getIntValue();
+    const auto isTierValid =
+        isAdaptive || (tier.containsOnly("0123456789") &&
+                       isPositiveAndBelow(settings.qualityTier,
+                                          PianoMannQualityGovernor::kNumTiers));
+    if (settings.sampleRate <= 0.0 || settings.blockSize <= 0 ||
+        settings.maxInstances <= 0 || settings.deadlineFraction <= 0.0 ||
+        settings.trialSeconds <= 0.0 || !isTierValid) {
+      std::cerr << kUsage;
+      setApplicationReturnValue(2);
+      quit();
+      return;
+    }
+    startCommandLineJob("PianoMann stress test",
+                        [settings](const std::function<bool()> &shouldExit) {
+                          return runStressHarness(settings, shouldExit);
+                        });
+  }
+
+  void runBenchmarks(const StringArray &arguments) {
+    const auto name = getOption(arguments, "--benchmark", {});
+    if (arguments.contains("--help") || name.isEmpty() ||
+        name.startsWith("--")) {
+      std::cout << kUsage;
+      setApplicationReturnValue(name.isEmpty() ? 2 : 0);
+      quit();
+      return;
+    }
+    PianoMannBenchmarks::Settings settings;
+    settings.sampleRate =
+        getOption(arguments, "--sample-rate", String(settings.sampleRate))
+            .getDoubleValue();
+    settings.blockSize =
+        getOption(arguments, "--block-size", String(settings.blockSize))
+            .getIntValue();
+    settings.midiFile = File::getCurrentWorkingDirectory().getChildFile(
+        getOption(arguments, "--midi", "Benchmarks/PedalHeavy.mid"));
+    if (settings.sampleRate <= 0.0 || settings.blockSize <= 0) {
+      std::cerr << kUsage;
+      setApplicationReturnValue(2);
+      quit();
+      return;
+    }
+    startCommandLineJob("PianoMann benchmark",
+                        [name, settings](const std::function<bool()> &shouldExit) {
+                          return runBenchmark(name, settings, shouldExit);
+                        });
+  }
+
+  void startCommandLineJob(const String &threadName,
+                           CommandLineJobThread::Job job) {
+    commandLineJobThread =
+        std::make_unique<CommandLineJobThread>(threadName, std::move(job));
+    commandLineJobThread->startThread(10);
+  }
+
+  ApplicationProperties appProperties;
+  std::unique_ptr<StandaloneFilterWindow> mainWindow;
+  std::unique_ptr<CommandLineJobThread> commandLineJobThread;
+};
+
+JUCE_CREATE_APPLICATION_DEFINE(PianoMannStandaloneApp)
+
+#endif
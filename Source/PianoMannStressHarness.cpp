@@ -0,0 +1,382 @@
+/*
+  ==============================================================================
+
+    PianoMannStressHarness.cpp
+    Created: 19 Oct 2026 11:58:40pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannStressHarness.h"
+#include "PluginProcessor.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+#if JUCE_LINUX
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+namespace {
+/**
+ * The resident memory of the process, or -1 where that cannot be measured.
+ */
+int64 getResidentBytes() {
+#if JUCE_LINUX
+  // The second field of statm is the number of resident pages.
+  const auto fields = StringArray::fromTokens(
+      File("/proc/self/statm").loadFileAsString(), false);
+  if (fields.size() < 2) {
+    return -1;
+  }
+  return fields[1].getLargeIntValue() * sysconf(_SC_PAGESIZE);
+#else
+  return -1;
+#endif
+}
+
+/**
+ * Hands memory freed by the last trial back to the system, so the next trial is measured from
+ * scratch rather than reusing it.
+ */
+void releaseFreedMemory() {
+#if JUCE_LINUX
+  malloc_trim(0);
+#endif
+}
+
+struct TimedMessage {
+  int64 samplePosition;
+  MidiMessage message;
+};
+
+/**
+ * A part for one instance: phrases of two to five seconds under the sustain pedal, striking a note
+ * or a chord every eighth of a second or so across five octaves, with the pedal changed now and
+ * then and a longer rest between some phrases.
+ */
+std::vector<TimedMessage> perform(Random &random, double sampleRate,
+                                  int64 numSamples) {
+  constexpr auto kSustainPedalController = 0x40;
+  constexpr auto kLowestNote = 36;
+  constexpr auto kNumNotes = 60;
+  std::vector<TimedMessage> part;
+  const auto add = [&](double seconds, const MidiMessage &message) {
+    const auto samplePosition = static_cast<int64>(seconds * sampleRate);
+    if (samplePosition < numSamples) {
+      part.push_back({samplePosition, message});
+    }
+  };
+  const auto between = [&random](double low, double high) {
+    return low + (high - low) * random.nextDouble();
+  };
+
+  const auto endSeconds = static_cast<double>(numSamples) / sampleRate;
+  for (auto seconds = between(0.0, 0.5); seconds < endSeconds;) {
+    const auto phraseSeconds = between(2.0, 5.0);
+    add(seconds, MidiMessage::controllerEvent(1, kSustainPedalController, 127));
+    for (auto strike = seconds; strike < seconds + phraseSeconds;
+         strike += between(0.125, 0.325)) {
+      const auto numChordNotes = random.nextInt(4) == 0 ? 3 : 1;
+      for (auto chordNote = 0; chordNote < numChordNotes; ++chordNote) {
+        const auto note = kLowestNote + random.nextInt(kNumNotes);
+        add(strike, MidiMessage::noteOn(
+                        1, note, static_cast<float>(between(0.2, 1.0))));
+        add(strike + between(0.1, 0.6), MidiMessage::noteOff(1, note));
+      }
+      if (random.nextInt(4) == 0) {
+        add(strike + 0.05, MidiMessage::controllerEvent(
+                               1, kSustainPedalController, random.nextInt(128)));
+      }
+    }
+    add(seconds + phraseSeconds + 0.5,
+        MidiMessage::controllerEvent(1, kSustainPedalController, 0));
+    seconds += phraseSeconds + 0.6 + (random.nextInt(4) == 0 ? 1.5 : 0.0);
+  }
+  std::stable_sort(part.begin(), part.end(),
+                   [](const TimedMessage &a, const TimedMessage &b) {
+                     return a.samplePosition < b.samplePosition;
+                   });
+  return part;
+}
+
+struct Instance {
+  std::unique_ptr<PianoMannAudioProcessor> processor;
+  AudioBuffer<float> buffer;
+  MidiBuffer midi;
+  std::vector<TimedMessage> part;
+  size_t nextMessage = 0;
+  int64 samplePosition = 0;
+
+  void processBlock() {
+    const auto numSamples = buffer.getNumSamples();
+    midi.clear();
+    for (; nextMessage < part.size() &&
+           part[nextMessage].samplePosition < samplePosition + numSamples;
+         ++nextMessage) {
+      midi.addEvent(part[nextMessage].message,
+                    static_cast<int>(part[nextMessage].samplePosition -
+                                     samplePosition));
+    }
+    processor->processBlock(buffer, midi);
+    samplePosition += numSamples;
+  }
+};
+
+/**
+ * Processes every instance once per cycle on a pool of threads, the way hosts run parallel tracks,
+ * and mixes them to a master bus. The thread calling `processCycle` takes part.
+ */
+class HostGraph {
+public:
+  HostGraph(std::vector<std::unique_ptr<Instance>> &instancesToProcess,
+            int numThreads, int blockSize)
+      : instances(instancesToProcess), master(2, blockSize) {
+    for (auto index = 1; index < numThreads; ++index) {
+      workers.push_back(std::make_unique<Worker>(*this));
+      workers.back()->startThread(10);
+    }
+  }
+
+  ~HostGraph() {
+    for (auto &worker : workers) {
+      worker->signalThreadShouldExit();
+      worker->start.signal();
+    }
+    for (auto &worker : workers) {
+      worker->stopThread(-1);
+    }
+  }
+
+  void processCycle() {
+    // Counted from zero before any instance can be claimed, since a worker
+    // still waking from the last cycle may claim one as soon as it can.
+    numProcessed = 0;
+    nextInstance = 0;
+    for (auto &worker : workers) {
+      worker->start.signal();
+    }
+    processInstances();
+    while (numProcessed.load() < static_cast<int>(instances.size())) {
+      Thread::yield();
+    }
+
+    master.clear();
+    for (auto &instance : instances) {
+      for (auto channel = 0; channel < master.getNumChannels(); ++channel) {
+        master.addFrom(channel, 0, instance->buffer,
+                       channel % instance->buffer.getNumChannels(), 0,
+                       master.getNumSamples());
+      }
+    }
+  }
+
+private:
+  void processInstances() {
+    const auto numInstances = static_cast<int>(instances.size());
+    for (auto index = nextInstance++; index < numInstances;
+         index = nextInstance++) {
+      instances[static_cast<size_t>(index)]->processBlock();
+      ++numProcessed;
+    }
+  }
+
+  struct Worker : public Thread {
+    explicit Worker(HostGraph &graphToServe)
+        : Thread("PianoMann stress worker"), graph(graphToServe) {}
+    void run() override {
+      while (!threadShouldExit()) {
+        if (start.wait(100) && !threadShouldExit()) {
+          graph.processInstances();
+        }
+      }
+    }
+    HostGraph &graph;
+    WaitableEvent start;
+  };
+
+  std::vector<std::unique_ptr<Instance>> &instances;
+  AudioBuffer<float> master;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<int> nextInstance{0};
+  std::atomic<int> numProcessed{0};
+};
+
+/**
+ * Sleeps most of the way to `ticks`, then spins the rest for precision.
+ */
+void waitUntil(int64 ticks) {
+  const auto ticksPerMillisecond =
+      Time::getHighResolutionTicksPerSecond() / 1000;
+  for (;;) {
+    const auto remaining = ticks - Time::getHighResolutionTicks();
+    if (remaining <= 0) {
+      return;
+    }
+    if (remaining > 2 * ticksPerMillisecond) {
+      Thread::sleep(1);
+    } else {
+      Thread::yield();
+    }
+  }
+}
+} // namespace
+
+PianoMannStressHarness::Report
+PianoMannStressHarness::run(const Settings &settings,
+                            const std::function<void(const Trial &)> &onTrialFinished,
+                            const std::function<bool()> &shouldExit) {
+  Report report;
+  auto lastPassed = 0, firstFailed = settings.maxInstances + 1;
+  for (auto numInstances = jmin(1, settings.maxInstances); numInstances > 0;) {
+    const auto trial = runTrial(numInstances, settings, shouldExit);
+    if (shouldExit && shouldExit()) {
+      return report;
+    }
+    report.trials.push_back(trial);
+    if (onTrialFinished) {
+      onTrialFinished(trial);
+    }
+    if (trial.hasPassed()) {
+      lastPassed = numInstances;
+      report.bestTrial = trial;
+    } else {
+      firstFailed = numInstances;
+    }
+    if (firstFailed == lastPassed + 1 || lastPassed == settings.maxInstances) {
+      break;
+    }
+    // Double until a trial fails, then halve the gap.
+    numInstances = firstFailed > settings.maxInstances
+                       ? jmin(2 * numInstances, settings.maxInstances)
+                       : (lastPassed + firstFailed) / 2;
+  }
+  report.wasCompleted = true;
+  report.maxInstances = lastPassed;
+  report.isLimitedBySettings = lastPassed == settings.maxInstances;
+  return report;
+}
+
+PianoMannStressHarness::Trial
+PianoMannStressHarness::runTrial(int numInstances, const Settings &settings,
+                                 const std::function<bool()> &shouldExit) {
+  Trial trial;
+  trial.numInstances = numInstances;
+  const auto blockSize = settings.blockSize;
+  const auto ticksPerSecond =
+      static_cast<double>(Time::getHighResolutionTicksPerSecond());
+  const auto warmUpBlocks = static_cast<int>(
+      std::ceil(settings.warmUpSeconds * settings.sampleRate / blockSize));
+  const auto trialBlocks = static_cast<int>(
+      std::ceil(settings.trialSeconds * settings.sampleRate / blockSize));
+  const auto partSamples =
+      static_cast<int64>(warmUpBlocks + trialBlocks) * blockSize;
+
+  releaseFreedMemory();
+  const auto residentBytesBefore = getResidentBytes();
+  const auto startupTicks = Time::getHighResolutionTicks();
+  int64 prepareTicks = 0;
+  std::vector<std::unique_ptr<Instance>> instances;
+  for (auto index = 0; index < numInstances; ++index) {
+    auto instance = std::make_unique<Instance>();
+    instance->processor = std::make_unique<PianoMannAudioProcessor>();
+    auto &processor = *instance->processor;
+    processor.setPinnedQualityTier(settings.qualityTier);
+    processor.setCompactDelayLineEnabled(settings.isCompactDelayLineEnabled);
+    processor.setRateAndBufferSizeDetails(settings.sampleRate, blockSize);
+    const auto prepareStartTicks = Time::getHighResolutionTicks();
+    processor.prepareToPlay(settings.sampleRate, blockSize);
+    prepareTicks += Time::getHighResolutionTicks() - prepareStartTicks;
+    if (settings.isEditorOpen) {
+      processor.setVisualiserOpen(true);
+      processor.setKeyboardShown(true);
+    }
+
+    instance->buffer.setSize(jmax(processor.getTotalNumInputChannels(),
+                                  processor.getTotalNumOutputChannels()),
+                             blockSize);
+    instance->midi.ensureSize(4096);
+    Random random(settings.seed);
+    random.combineSeed(index);
+    instance->part = perform(random, settings.sampleRate, partSamples);
+    instances.push_back(std::move(instance));
+  }
+  for (auto &instance : instances) {
+    while (!instance->processor->isBackgroundPreparationFinished()) {
+      if (shouldExit && shouldExit()) {
+        return trial;
+      }
+      Thread::sleep(1);
+    }
+  }
+  trial.startupSeconds = static_cast<double>(Time::getHighResolutionTicks() -
+                                             startupTicks) /
+                         ticksPerSecond;
+  trial.prepareSecondsPerInstance =
+      static_cast<double>(prepareTicks) / ticksPerSecond / numInstances;
+  const auto residentBytesAfter = getResidentBytes();
+  if (residentBytesBefore >= 0 && residentBytesAfter >= 0) {
+    trial.memoryBytesPerInstance =
+        static_cast<double>(residentBytesAfter - residentBytesBefore) /
+        numInstances;
+  }
+
+  {
+    const auto numThreads = settings.numThreads > 0 ? settings.numThreads
+                                                    : SystemStats::getNumCpus();
+    HostGraph graph(instances, jmin(numThreads, numInstances), blockSize);
+    const auto periodTicks = static_cast<int64>(
+        std::round(blockSize / settings.sampleRate * ticksPerSecond));
+    const auto deadlineTicks =
+        static_cast<int64>(std::round(periodTicks * settings.deadlineFraction));
+    auto cycleStartTicks = Time::getHighResolutionTicks();
+    auto totalLoad = 0.0;
+    for (auto block = 0; block < warmUpBlocks + trialBlocks; ++block) {
+      if (shouldExit && shouldExit()) {
+        break;
+      }
+      waitUntil(cycleStartTicks);
+      graph.processCycle();
+      const auto endTicks = Time::getHighResolutionTicks();
+      if (block >= warmUpBlocks) {
+        // Governors recover once the load drops, so the worst tier is only
+        // seen while it lasts.
+        for (const auto &instance : instances) {
+          trial.worstQualityTier = jmax(trial.worstQualityTier,
+                                        instance->processor->getQualityTier());
+        }
+        const auto load = static_cast<double>(endTicks - cycleStartTicks) /
+                          static_cast<double>(periodTicks);
+        totalLoad += load;
+        trial.maxLoad = jmax(trial.maxLoad, load);
+        ++trial.numBlocks;
+        if (endTicks - cycleStartTicks > deadlineTicks) {
+          ++trial.numMissedDeadlines;
+        }
+      }
+      // A late cycle delays the next one. Once a whole period behind, the
+      // driver drops it and carries on from now, as audio interfaces do.
+      cycleStartTicks += periodTicks;
+      if (endTicks > cycleStartTicks + periodTicks) {
+        cycleStartTicks = endTicks;
+      }
+    }
+    trial.meanLoad = trial.numBlocks > 0 ? totalLoad / trial.numBlocks : 0.0;
+  }
+
+  trial.isaName = instances.front()->processor->getIsaName();
+  for (auto &instance : instances) {
+    if (settings.isEditorOpen) {
+      instance->processor->setKeyboardShown(false);
+      instance->processor->setVisualiserOpen(false);
+    }
+    instance->processor->releaseResources();
+  }
+  instances.clear();
+  releaseFreedMemory();
+  return trial;
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    PianoMannStressHarness.h
+    Created: 19 Oct 2026 11:58:40pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <vector>
+
+/**
+ * Finds how many instances of the plugin this machine can run, the way a host session with many
+ * pianos would run them. Each trial creates and prepares a number of instances in-process and
+ * plays each its own part, generated to sound like a pianist: phrases of chords and melody under
+ * the sustain pedal. A simulated host graph processes every instance once per block, spread over
+ * its threads, and mixes them to a master bus. The whole graph has to finish within a deadline in
+ * each block period, paced in real time.
+ *
+ * The number of instances doubles until a trial misses a deadline, then the limit is narrowed
+ * down between the last trial that passed and the first that failed. Run from the command line
+ * of the standalone app, see `PianoMannStandaloneApp.cpp`.
+ */
+class PianoMannStressHarness {
+public:
+  struct Settings {
+    double sampleRate = 48000.0;
+    int blockSize = 256;
+    /**
+     * The threads the host graph runs on, or 0 for one per core.
+     */
+    int numThreads = 0;
+    int maxInstances = 512;
+    /**
+     * The fraction of each block period the graph may take. Hosts and drivers need the rest.
+     */
+    double deadlineFraction = 0.8;
+    /**
+     * Each trial plays for this long before it starts counting, then counts for `trialSeconds`.
+     */
+    double warmUpSeconds = 2.0;
+    double trialSeconds = 10.0;
+    int64 seed = 1;
+    /**
+     * Whether every instance runs as if its editor were open, feeding the visualiser and the
+     * on-screen keyboard, to compare against a session with every editor closed.
+     */
+    bool isEditorOpen = false;
+    /**
+     * Whether every instance keeps its ringing strings in half precision, see
+     * `PianoMannAudioProcessor::setCompactDelayLineEnabled`.
+     */
+    bool isCompactDelayLineEnabled = false;
+    /**
+     * The quality tier every instance is pinned to, or
+     * `PianoMannAudioProcessor::kAdaptiveQualityTier` to let each governor drop tiers under load,
+     * see `PianoMannQualityGovernor`. Pinned by default, so that a trial finds the capacity at
+     * one quality rather than how far the instances can fall back.
+     */
+    int qualityTier = 0;
+  };
+
+  struct Trial {
+    int numInstances = 0;
+    int numBlocks = 0;
+    int numMissedDeadlines = 0;
+    /**
+     * The time the graph took as a fraction of the block period.
+     */
+    double meanLoad = 0.0;
+    double maxLoad = 0.0;
+    /**
+     * How long `prepareToPlay` held up the host for each instance on average, and how long it took
+     * from creating the first instance until every one had finished preparing in the background.
+     */
+    double prepareSecondsPerInstance = 0.0;
+    double startupSeconds = 0.0;
+    /**
+     * How much resident memory each instance took, or -1 where that cannot be measured.
+     */
+    double memoryBytesPerInstance = -1.0;
+    /**
+     * The lowest quality any instance ran at during the trial, see `PianoMannQualityGovernor`.
+     */
+    int worstQualityTier = 0;
+    /**
+     * The instruction set of the DSP kernels the instances ran, see `PianoMannDspKernels`.
+     */
+    String isaName;
+
+    bool hasPassed() const { return numMissedDeadlines == 0; }
+  };
+
+  struct Report {
+    bool wasCompleted = false;
+    /**
+     * The most instances that ran without missing a deadline, and whether that is only because
+     * `Settings::maxInstances` stopped the search.
+     */
+    int maxInstances = 0;
+    bool isLimitedBySettings = false;
+    /**
+     * The trial at `maxInstances`, if any passed.
+     */
+    Trial bestTrial;
+    std::vector<Trial> trials;
+  };
+
+  /**
+   * Runs trials until the limit is found, handing each to `onTrialFinished` as it ends. The
+   * calling thread drives the host graph, so it should have a high priority. Stops early if
+   * `shouldExit` returns `true`.
+   */
+  static Report run(const Settings &settings,
+                    const std::function<void(const Trial &)> &onTrialFinished,
+                    const std::function<bool()> &shouldExit);
+
+  static Trial runTrial(int numInstances, const Settings &settings,
+                        const std::function<bool()> &shouldExit);
+};
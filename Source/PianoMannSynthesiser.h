@@ -0,0 +1,667 @@
+/*
+  ==============================================================================
+
+    PianoMannSynthesiser.h
+    Created: 19 Oct 2026 10:12:40am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannTuning.h"
+#include "PianoMannVoice.h"
+#include "PianoMannVoicing.h"
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <bitset>
+
+/**
+ * The synthesiser driving one `PianoMannVoice` per key. On top of `Synthesiser` it tracks the
+ * continuous pedal positions the voices' dampers follow, bounds the number of strings ringing at
+ * once so that pedal-down glissandi have a bounded CPU cost, and renders in fixed quanta rather
+ * than in slices between MIDI events.
+ */
+class PianoMannSynthesiser : public Synthesiser {
+public:
+  /**
+   * The keyboard registers, each of which can be routed to its own output.
+   */
+  enum Register { kBassRegister, kMidRegister, kTrebleRegister, kNumRegisters };
+
+  static constexpr Register getRegisterForNote(int midiNoteNumber) {
+    if (midiNoteNumber < MidiOctaves::kOctave_3) {
+      return kBassRegister;
+    }
+    if (midiNoteNumber < MidiOctaves::kOctave_5) {
+      return kMidRegister;
+    }
+    return kTrebleRegister;
+  }
+
+  /**
+   * Adds the voice and sound of every key of the piano.
+   */
+  void addKeys() {
+    for (auto midiNote = PianoMannSound::kMinNote;
+         midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
+      addVoice(new PianoMannVoice({midiNote, &pedalState}));
+      addSound(new PianoMannSound(midiNote));
+    }
+  }
+
+  /**
+   * Routes the voices of a register to `numChannels` channels starting at `firstChannel` of the
+   * rendered buffer. By default, every register is rendered to all channels.
+   */
+  void setRegisterChannels(Register registerToRoute, int firstChannel,
+                           int numChannels) {
+    jassert(firstChannel >= 0 && numChannels > 0);
+    const ScopedLock sl(lock);
+    registerRoutings[registerToRoute] = {firstChannel, numChannels};
+  }
+
+  const PianoMannPedalState &getPedalState() const { return pedalState; }
+
+  /**
+   * Sets the maximum number of strings allowed to ring at once. Beyond this, the quietest strings
+   * are retired to make room for new notes.
+   */
+  void setMaxRingingVoices(int newMaxRingingVoices) {
+    jassert(newMaxRingingVoices > 0);
+    maxRingingVoices = newMaxRingingVoices;
+    retireExcessVoices();
+  }
+
+  /**
+   * How many notes were struck, how many strings were retired to make room for them, and the most
+   * strings found ringing at once before retiring any, since the sample rate was last set. Read it
+   * from the thread rendering, or once rendering has stopped.
+   */
+  struct RetirementStats {
+    int64 numStrikes = 0;
+    int64 numRetiredVoices = 0;
+    int maxRingingVoices = 0;
+  };
+  RetirementStats getRetirementStats() const { return retirementStats; }
+
+  /**
+   * How many strikes were hammered and how many samples their attacks took, across every voice,
+   * see `PianoMannVoice::getNumAttackSamples`. Read it as `getRetirementStats`.
+   */
+  struct AttackStats {
+    int64 numHammeredStrikes = 0;
+    int64 numAttackSamples = 0;
+  };
+  AttackStats getAttackStats() const {
+    AttackStats stats;
+    for (auto *voice : voices) {
+      const auto *pianoMannVoice = asPianoMannVoice(voice);
+      stats.numHammeredStrikes += pianoMannVoice->getNumHammeredStrikes();
+      stats.numAttackSamples += pianoMannVoice->getNumAttackSamples();
+    }
+    return stats;
+  }
+
+  /**
+   * Seeds the excitation noise of every voice. This takes effect the next time the sample rate is
+   * set.
+   *
+   * This and the other voice settings below only store atomics of each voice, and voices are only
+   * added before rendering starts, so they are set without taking the rendering lock.
+   */
+  void setExcitationSeed(int64 newExcitationSeed) {
+    for (auto *voice : voices) {
+      asPianoMannVoice(voice)->setExcitationSeed(newExcitationSeed);
+    }
+  }
+
+  /**
+   * See `PianoMannVoice::setStrikeVariationEnabled`, `PianoMannVoice::setVelocityShapingEnabled`
+   * and `PianoMannVoice::setHammerModelEnabled`. These take effect from the next strike.
+   */
+  void setStrikeVariationEnabled(bool shouldVary) {
+    for (auto *voice : voices) {
+      asPianoMannVoice(voice)->setStrikeVariationEnabled(shouldVary);
+    }
+  }
+  void setVelocityShapingEnabled(bool shouldShape) {
+    for (auto *voice : voices) {
+      asPianoMannVoice(voice)->setVelocityShapingEnabled(shouldShape);
+    }
+  }
+  void setHammerModelEnabled(bool shouldStrike) {
+    for (auto *voice : voices) {
+      asPianoMannVoice(voice)->setHammerModelEnabled(shouldStrike);
+    }
+  }
+
+  /**
+   * Enables caching the waveform of unmodulated strikes per note, see
+   * `PianoMannVoice::setRenderCacheEnabled`. This takes effect the next time the sample rate is
+   * set.
+   */
+  void setRenderCacheEnabled(bool shouldCache) {
+    for (auto *voice : voices) {
+      asPianoMannVoice(voice)->setRenderCacheEnabled(shouldCache);
+    }
+  }
+
+  /**
+   * Keeps ringing strings in half precision, see `PianoMannVoice::setCompactDelayLineEnabled`.
+   * This takes effect the next time the sample rate is set.
+   */
+  void setCompactDelayLineEnabled(bool shouldCompact) {
+    for (auto *voice : voices) {
+      asPianoMannVoice(voice)->setCompactDelayLineEnabled(shouldCompact);
+    }
+  }
+
+  /**
+   * Retunes and revoices every string from its next strike, see
+   * `PianoMannVoice::setNextStringTuning`. The strings are worked out here for the current sample
+   * rate and handed over to the rendering thread without locking. Call from one thread at a time.
+   */
+  void setTuning(const PianoMannTuning &tuning,
+                 const PianoMannVoicing &voicing) {
+    const auto sampleRate = getSampleRate();
+    if (sampleRate <= 0.0) {
+      return;
+    }
+    auto &table = tuningTables[static_cast<size_t>(writtenTuningTable)];
+    for (auto midiNoteNumber = PianoMannSound::kMinNote;
+         midiNoteNumber <= PianoMannSound::kMaxNote; ++midiNoteNumber) {
+      table[static_cast<size_t>(midiNoteNumber)] = PianoMannVoice::tuneString(
+          voicing, midiNoteNumber, tuning.getFrequency(midiNoteNumber),
+          sampleRate);
+    }
+    writtenTuningTable =
+        sharedTuningTable.exchange(writtenTuningTable | kIsNewTuningTable,
+                                   std::memory_order_acq_rel) &
+        ~kIsNewTuningTable;
+  }
+
+  /**
+   * Publishes the level of every string after each render for `getStringLevel` to read.
+   */
+  void setPublishingStringLevels(bool shouldPublish) {
+    isPublishingStringLevels = shouldPublish;
+  }
+
+  /**
+   * The peak level of a string over its last period, or 0 if it is silent. Safe to call from any
+   * thread while string levels are published.
+   */
+  float getStringLevel(int midiNoteNumber) const {
+    return stringLevels[static_cast<size_t>(midiNoteNumber)].load(
+        std::memory_order_relaxed);
+  }
+
+  /**
+   * Sets the output level below which strings are retired.
+   */
+  void setSilenceThreshold(float newSilenceThreshold) {
+    for (auto *voice : voices) {
+      asPianoMannVoice(voice)->setSilenceThreshold(newSilenceThreshold);
+    }
+  }
+
+  /**
+   * The voice playing `midiNoteNumber`, if any.
+   */
+  PianoMannVoice *findVoiceForNote(int midiNoteNumber) const {
+    for (auto *voice : voices) {
+      auto *pianoMannVoice = asPianoMannVoice(voice);
+      if (pianoMannVoice->getMidiNoteNumber() == midiNoteNumber) {
+        return pianoMannVoice;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * A note whose string is still being prepared starts as soon as it is ready, provided its key
+   * is still down by then.
+   */
+  void noteOn(int midiChannel, int midiNoteNumber, float velocity) override {
+    auto *voice = findVoiceForNote(midiNoteNumber);
+    if (voice != nullptr && !voice->isPrepared()) {
+      deferredNoteOns[static_cast<size_t>(midiNoteNumber)] = {midiChannel,
+                                                              velocity};
+      hasDeferredNoteOns = true;
+      return;
+    }
+    Synthesiser::noteOn(midiChannel, midiNoteNumber, velocity);
+    ++retirementStats.numStrikes;
+    // Which strings are quietest depends on how far each has been rendered,
+    // so they are only compared where all of them meet, see `renderNextBlock`.
+    isRetirementPending = true;
+  }
+
+  void noteOff(int midiChannel, int midiNoteNumber, float velocity,
+               bool allowTailOff) override {
+    deferredNoteOns[static_cast<size_t>(midiNoteNumber)].midiChannel = 0;
+    Synthesiser::noteOff(midiChannel, midiNoteNumber, velocity, allowTailOff);
+  }
+
+  void allNotesOff(int midiChannel, bool allowTailOff) override {
+    pedalState.sustain = 0.f;
+    for (auto &deferredNoteOn : deferredNoteOns) {
+      if (midiChannel <= 0 || deferredNoteOn.midiChannel == midiChannel) {
+        deferredNoteOn.midiChannel = 0;
+      }
+    }
+    // As `Synthesiser` forgets which sustain pedals are down.
+    sustainPedalChannels.reset();
+    Synthesiser::allNotesOff(midiChannel, allowTailOff);
+  }
+
+  void handleSustainPedal(int midiChannel, bool isDown) override {
+    if (isPositiveAndBelow(midiChannel,
+                           static_cast<int>(sustainPedalChannels.size()))) {
+      sustainPedalChannels[static_cast<size_t>(midiChannel)] = isDown;
+    }
+    Synthesiser::handleSustainPedal(midiChannel, isDown);
+  }
+
+  void handleController(int midiChannel, int controllerNumber,
+                        int controllerValue) override {
+    constexpr auto kSustainPedalController = 0x40;
+    if (controllerNumber == kSustainPedalController) {
+      pedalState.sustain = static_cast<float>(controllerValue) / 127.f;
+    }
+    Synthesiser::handleController(midiChannel, controllerNumber,
+                                  controllerValue);
+  }
+
+  /**
+   * Applies `message` without rendering anything, as if it arrived at the end of the last block.
+   * Together with `silenceAllVoices`, this brings a synthesiser to where another one stands once
+   * all its strings have died away, without rendering what led there.
+   */
+  void handleMidiWithoutRendering(const MidiMessage &message) {
+    const ScopedLock sl(lock);
+    handleMidiEvent(message);
+  }
+
+  /**
+   * Stops every string at once, leaving the keys and pedals as they are.
+   */
+  void silenceAllVoices() {
+    const ScopedLock sl(lock);
+    for (auto *voice : voices) {
+      if (voice->isVoiceActive()) {
+        voice->stopNote(0.f, false);
+      }
+    }
+  }
+
+  /**
+   * Writes the state of the synthesiser and every string, see `PianoMannVoice::writeState`. A
+   * synthesiser set up the same way carries on from `readState` exactly where this one left off,
+   * which lets a render be split across synthesisers.
+   */
+  void writeState(OutputStream &output) {
+    const ScopedLock sl(lock);
+    output.writeFloat(pedalState.sustain);
+    output.writeInt(static_cast<int>(sustainPedalChannels.to_ulong()));
+    output.writeInt(quantumPhase);
+    output.writeInt(isRetirementPending ? 1 : 0);
+    for (const auto &deferredNoteOn : deferredNoteOns) {
+      output.writeInt(deferredNoteOn.midiChannel);
+      output.writeFloat(deferredNoteOn.velocity);
+    }
+    for (auto *voice : voices) {
+      output.writeInt(getPlayingChannel(*voice));
+      asPianoMannVoice(voice)->writeState(output);
+    }
+  }
+
+  void readState(InputStream &input) {
+    const ScopedLock sl(lock);
+    silenceAllVoices();
+    pedalState.sustain = input.readFloat();
+    const std::bitset<17> sustainedChannels(
+        static_cast<unsigned long>(input.readInt()));
+    for (auto midiChannel = 1; midiChannel <= 16; ++midiChannel) {
+      handleSustainPedal(midiChannel,
+                         sustainedChannels[static_cast<size_t>(midiChannel)]);
+    }
+    quantumPhase = input.readInt();
+    isRetirementPending = input.readInt() != 0;
+    hasDeferredNoteOns = false;
+    for (auto &deferredNoteOn : deferredNoteOns) {
+      deferredNoteOn.midiChannel = input.readInt();
+      deferredNoteOn.velocity = input.readFloat();
+      hasDeferredNoteOns =
+          hasDeferredNoteOns || deferredNoteOn.midiChannel != 0;
+    }
+    for (auto *voice : voices) {
+      auto *pianoMannVoice = asPianoMannVoice(voice);
+      const auto midiChannel = input.readInt();
+      if (midiChannel != 0) {
+        const auto midiNoteNumber = pianoMannVoice->getMidiNoteNumber();
+        for (auto *sound : sounds) {
+          if (sound->appliesToNote(midiNoteNumber)) {
+            startVoice(voice, sound, midiChannel, midiNoteNumber, 0.f);
+            break;
+          }
+        }
+      }
+      pianoMannVoice->readState(input);
+    }
+  }
+
+  /**
+   * The number of samples the voices are rendered in at a time, counted from when the sample rate
+   * was last set. A block only ends a quantum early where the block itself ends.
+   */
+  static constexpr int kQuantumSize = 32;
+
+  /**
+   * Stops every string and leaves it to be prepared again, even at the rate already set.
+   * `Synthesiser` only does so when the rate changes, but strings are rebuilt every time the host
+   * prepares, and must not be rebuilt while they ring.
+   */
+  void setCurrentPlaybackSampleRate(double newRate) override {
+    Synthesiser::setCurrentPlaybackSampleRate(newRate);
+    const ScopedLock sl(lock);
+    allNotesOff(0, false);
+    for (auto *voice : voices) {
+      voice->setCurrentPlaybackSampleRate(newRate);
+    }
+    quantumPhase = 0;
+    isRetirementPending = false;
+    retirementStats = {};
+  }
+
+  /**
+   * Renders in quanta of `kQuantumSize` samples instead of splitting the block at every MIDI event
+   * as `Synthesiser::renderNextBlock` does. Events still apply at their exact sample: only the
+   * voice an event concerns is rendered up to it first, so a chord does not chop every ringing
+   * string into slices. Pedals and other controllers concern every voice. Strings retired to make
+   * room for a new note start fading at the next whole quantum, where every string has been
+   * rendered up to the same sample however the host splits blocks.
+   *
+   * This hides `Synthesiser::renderNextBlock`, so call it through this class.
+   */
+  void renderNextBlock(AudioBuffer<float> &outputAudio,
+                       const MidiBuffer &inputMidi, int startSample,
+                       int numSamples) {
+    const ScopedLock sl(lock);
+    takeNewTuningTable();
+    routeRegisterBuffers(outputAudio);
+
+    MidiBuffer::Iterator midiIterator(inputMidi);
+    midiIterator.setNextSamplePosition(startSample);
+    MidiMessage message;
+    int eventPosition;
+    auto hasEvent = midiIterator.getNextEvent(message, eventPosition);
+
+    const auto endSample = startSample + numSamples;
+    while (startSample < endSample) {
+      const auto quantumEnd =
+          jmin(endSample, startSample + kQuantumSize - quantumPhase);
+      PIANOMANN_TRACE_SCOPE_ARG("renderQuantum", "numSamples",
+                                quantumEnd - startSample);
+      if (hasDeferredNoteOns) {
+        startDeferredNoteOns();
+      }
+      if (isRetirementPending && quantumPhase == 0) {
+        retireExcessVoices();
+      }
+      voiceRenderPositions.fill(startSample);
+
+      for (; hasEvent && eventPosition < quantumEnd;
+           hasEvent = midiIterator.getNextEvent(message, eventPosition)) {
+        if (message.isNoteOnOrOff() || message.isAftertouch()) {
+          if (auto *voice = findVoiceForNote(message.getNoteNumber())) {
+            renderVoiceUpTo(*voice, eventPosition);
+          }
+        } else {
+          renderAllVoicesUpTo(eventPosition);
+        }
+        handleMidiEvent(message);
+      }
+      renderAllVoicesUpTo(quantumEnd);
+
+      quantumPhase = (quantumPhase + quantumEnd - startSample) % kQuantumSize;
+      startSample = quantumEnd;
+    }
+
+    publishStringLevels();
+  }
+
+protected:
+  void handleMidiEvent(const MidiMessage &message) override {
+    PIANOMANN_TRACE_SCOPE("handleMidiEvent");
+    Synthesiser::handleMidiEvent(message);
+  }
+
+  /**
+   * Only reached through `Synthesiser::renderNextBlock`, which the processor does not use. See
+   * `renderNextBlock` above.
+   */
+  void renderVoices(AudioBuffer<float> &outputAudio, int startSample,
+                    int numSamples) override {
+    takeNewTuningTable();
+    if (hasDeferredNoteOns) {
+      startDeferredNoteOns();
+    }
+    if (isRetirementPending) {
+      retireExcessVoices();
+    }
+    routeRegisterBuffers(outputAudio);
+    voiceRenderPositions.fill(startSample);
+    renderAllVoicesUpTo(startSample + numSamples);
+    publishStringLevels();
+  }
+
+  using Synthesiser::renderVoices;
+
+private:
+  /**
+   * Voices accumulate straight into the channels of their register, so routing registers to
+   * separate outputs needs no intermediate buffer.
+   */
+  void routeRegisterBuffers(AudioBuffer<float> &outputAudio) {
+    for (auto registerIndex = 0; registerIndex < kNumRegisters;
+         ++registerIndex) {
+      const auto &routing = registerRoutings[registerIndex];
+      const auto isRoutable =
+          routing.numChannels > 0 &&
+          routing.firstChannel + routing.numChannels <=
+              outputAudio.getNumChannels();
+      registerBuffers[registerIndex].setDataToReferTo(
+          outputAudio.getArrayOfWritePointers() +
+              (isRoutable ? routing.firstChannel : 0),
+          isRoutable ? routing.numChannels : outputAudio.getNumChannels(),
+          outputAudio.getNumSamples());
+    }
+  }
+
+  void renderVoiceUpTo(PianoMannVoice &voice, int position) {
+    const auto midiNoteNumber = voice.getMidiNoteNumber();
+    auto &renderPosition =
+        voiceRenderPositions[static_cast<size_t>(midiNoteNumber)];
+    if (position > renderPosition) {
+      voice.renderNextBlock(registerBuffers[getRegisterForNote(midiNoteNumber)],
+                            renderPosition, position - renderPosition);
+      renderPosition = position;
+    }
+  }
+
+  void renderAllVoicesUpTo(int position) {
+    for (auto *voice : voices) {
+      renderVoiceUpTo(*asPianoMannVoice(voice), position);
+    }
+  }
+
+  /**
+   * Hands the strings of the latest `setTuning` to the voices, if there was one since last time.
+   */
+  void takeNewTuningTable() {
+    if ((sharedTuningTable.load(std::memory_order_relaxed) & kIsNewTuningTable) == 0) {
+      return;
+    }
+    readTuningTable = sharedTuningTable.exchange(readTuningTable,
+                                                 std::memory_order_acq_rel) &
+                      ~kIsNewTuningTable;
+    const auto &table = tuningTables[static_cast<size_t>(readTuningTable)];
+    for (auto *voice : voices) {
+      auto *pianoMannVoice = asPianoMannVoice(voice);
+      pianoMannVoice->setNextStringTuning(
+          table[static_cast<size_t>(pianoMannVoice->getMidiNoteNumber())]);
+    }
+  }
+
+  void publishStringLevels() {
+    if (!isPublishingStringLevels.load(std::memory_order_relaxed)) {
+      return;
+    }
+    for (auto *voice : voices) {
+      auto *pianoMannVoice = asPianoMannVoice(voice);
+      stringLevels[static_cast<size_t>(pianoMannVoice->getMidiNoteNumber())]
+          .store(voice->isVoiceActive() ? pianoMannVoice->getPeakLevel() : 0.f,
+                 std::memory_order_relaxed);
+    }
+  }
+
+  void startDeferredNoteOns() {
+    hasDeferredNoteOns = false;
+    for (auto midiNoteNumber = 0;
+         midiNoteNumber < static_cast<int>(deferredNoteOns.size());
+         ++midiNoteNumber) {
+      auto &deferredNoteOn = deferredNoteOns[static_cast<size_t>(midiNoteNumber)];
+      if (deferredNoteOn.midiChannel == 0) {
+        continue;
+      }
+      if (!findVoiceForNote(midiNoteNumber)->isPrepared()) {
+        hasDeferredNoteOns = true;
+        continue;
+      }
+      const auto midiChannel = deferredNoteOn.midiChannel;
+      deferredNoteOn.midiChannel = 0;
+      noteOn(midiChannel, midiNoteNumber, deferredNoteOn.velocity);
+    }
+  }
+
+  /**
+   * Retires the quietest strings until at most `maxRingingVoices` are left. Strings whose key is
+   * no longer down are retired first since those are the ones only kept alive by the pedal.
+   */
+  void retireExcessVoices() {
+    const ScopedLock sl(lock);
+    isRetirementPending = false;
+
+    auto numRingingVoices = 0;
+    for (auto *voice : voices) {
+      if (voice->isVoiceActive() && !asPianoMannVoice(voice)->isBeingRetired()) {
+        ++numRingingVoices;
+      }
+    }
+    retirementStats.maxRingingVoices =
+        jmax(retirementStats.maxRingingVoices, numRingingVoices);
+
+    while (numRingingVoices > maxRingingVoices) {
+      PianoMannVoice *quietestVoice = nullptr;
+      for (auto *voice : voices) {
+        auto *pianoMannVoice = asPianoMannVoice(voice);
+        if (!voice->isVoiceActive() || pianoMannVoice->isBeingRetired()) {
+          continue;
+        }
+        if (quietestVoice == nullptr ||
+            isBetterToRetire(*pianoMannVoice, *quietestVoice)) {
+          quietestVoice = pianoMannVoice;
+        }
+      }
+      jassert(quietestVoice != nullptr);
+      quietestVoice->retire();
+      ++retirementStats.numRetiredVoices;
+      --numRingingVoices;
+    }
+  }
+
+  static bool isBetterToRetire(const PianoMannVoice &candidate,
+                               const PianoMannVoice &current) {
+    if (candidate.isKeyDown() != current.isKeyDown()) {
+      return !candidate.isKeyDown();
+    }
+    return candidate.getPeakLevel() < current.getPeakLevel();
+  }
+
+  /**
+   * The MIDI channel a voice is playing on, or 0 if it is silent.
+   */
+  static int getPlayingChannel(const SynthesiserVoice &voice) {
+    if (!voice.isVoiceActive()) {
+      return 0;
+    }
+    for (auto midiChannel = 1; midiChannel <= 16; ++midiChannel) {
+      if (voice.isPlayingChannel(midiChannel)) {
+        return midiChannel;
+      }
+    }
+    return 0;
+  }
+
+  static PianoMannVoice *asPianoMannVoice(SynthesiserVoice *voice) {
+    // Every voice of this synthesiser is a PianoMannVoice.
+    return static_cast<PianoMannVoice *>(voice);
+  }
+
+  PianoMannPedalState pedalState;
+  int maxRingingVoices = 32;
+  RetirementStats retirementStats;
+  bool isRetirementPending = false;
+
+  struct DeferredNoteOn {
+    /**
+     * The channel of the note-on, or 0 if there is none. MIDI channels start at 1.
+     */
+    int midiChannel = 0;
+    float velocity = 0.f;
+  };
+  std::array<DeferredNoteOn, 128> deferredNoteOns;
+  bool hasDeferredNoteOns = false;
+  /**
+   * The channels whose sustain pedal `Synthesiser` holds down, by MIDI channel.
+   */
+  std::bitset<17> sustainPedalChannels;
+
+  std::atomic<bool> isPublishingStringLevels{false};
+  std::array<std::atomic<float>, 128> stringLevels{};
+
+  struct RegisterRouting {
+    int firstChannel = 0;
+    /**
+     * The number of channels to render to, or 0 for all of them.
+     */
+    int numChannels = 0;
+  };
+  std::array<RegisterRouting, kNumRegisters> registerRoutings;
+  std::array<AudioBuffer<float>, kNumRegisters> registerBuffers;
+
+  /**
+   * Tunings pass from `setTuning` to the rendering thread through three tables: one being written,
+   * one being read, and the latest written, which either side swaps its own for. The flag in
+   * `sharedTuningTable` marks a table the rendering thread has not taken yet.
+   */
+  using TuningTable = std::array<PianoMannStringTuning, PianoMannTuning::kNumNotes>;
+  static constexpr int kIsNewTuningTable = 4;
+  std::array<TuningTable, 3> tuningTables;
+  std::atomic<int> sharedTuningTable{0};
+  int writtenTuningTable = 1;
+  int readTuningTable = 2;
+
+  /**
+   * How far into the current quantum the last block ended.
+   */
+  int quantumPhase = 0;
+  /**
+   * How far each voice has been rendered into the current quantum, by note number.
+   */
+  std::array<int, 128> voiceRenderPositions{};
+};
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    PianoMannTrace.cpp
+    Created: 19 Oct 2026 9:14:26pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTrace.h"
+
+namespace PianoMannTrace {
+File getDefaultFile() {
+  return File::getSpecialLocation(File::userDocumentsDirectory)
+      .getChildFile("PianoMann")
+      .getChildFile("Traces")
+      .getChildFile("PianoMann " +
+                    Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") +
+                    ".json")
+      .getNonexistentSibling();
+}
+
+#if PIANOMANN_ENABLE_TRACING
+namespace {
+constexpr int kMaxThreads = 8;
+std::array<ThreadEvents, kMaxThreads> threadEventsPool;
+std::atomic<uint32> numDroppedEvents{0};
+
+/**
+ * A reading of the tick counter against wall-clock time, to convert ticks to microseconds at
+ * export.
+ */
+std::atomic<uint64> calibrationTicks{0};
+std::atomic<double> calibrationMilliseconds{0.0};
+} // namespace
+
+ThreadEvents *claimThreadEvents() noexcept {
+  for (auto &events : threadEventsPool) {
+    auto isClaimed = false;
+    if (events.isClaimed.compare_exchange_strong(isClaimed, true,
+                                                 std::memory_order_acquire)) {
+      events.wasEverClaimed.store(true, std::memory_order_release);
+      return &events;
+    }
+  }
+  return nullptr;
+}
+
+void releaseThreadEvents(ThreadEvents &events) noexcept {
+  events.isClaimed.store(false, std::memory_order_release);
+}
+
+void countDroppedEvent() noexcept {
+  numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
+void prepare() {
+  static bool isPrepared = false;
+  if (isPrepared) {
+    return;
+  }
+  isPrepared = true;
+
+  for (auto &events : threadEventsPool) {
+    zeromem(events.events.data(), sizeof(events.events));
+  }
+  calibrationMilliseconds = Time::getMillisecondCounterHiRes();
+  calibrationTicks = getTicks();
+}
+
+bool exportChromeTrace(const File &file) {
+  prepare();
+  const auto ticks = getTicks() - calibrationTicks.load();
+  const auto milliseconds =
+      Time::getMillisecondCounterHiRes() - calibrationMilliseconds.load();
+  if (ticks == 0 || milliseconds <= 0.0) {
+    return false;
+  }
+  const auto microsecondsPerTick =
+      milliseconds * 1000.0 / static_cast<double>(ticks);
+
+  if (!file.getParentDirectory().createDirectory()) {
+    return false;
+  }
+  file.deleteFile();
+  FileOutputStream output(file);
+  if (!output.openedOk()) {
+    return false;
+  }
+
+  const auto originTicks = calibrationTicks.load();
+  // Events lost to full rings, and to threads that found no ring.
+  int64 numOverwrittenEvents = 0;
+  output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  auto isFirstEvent = true;
+  for (auto thread = 0; thread < kMaxThreads; ++thread) {
+    const auto &events = threadEventsPool[static_cast<size_t>(thread)];
+    if (!events.wasEverClaimed.load(std::memory_order_acquire)) {
+      continue;
+    }
+    output << (isFirstEvent ? "" : ",")
+           << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+           << thread << ",\"args\":{\"name\":\"PianoMann thread " << thread
+           << "\"}}";
+    isFirstEvent = false;
+
+    const auto numRecorded = events.numRecorded.load(std::memory_order_acquire);
+    const auto firstPosition =
+        numRecorded > ThreadEvents::kCapacity ? numRecorded - ThreadEvents::kCapacity
+                                              : 0u;
+    numOverwrittenEvents += firstPosition;
+    for (auto position = firstPosition; position != numRecorded; ++position) {
+      const auto &event =
+          events.events[position & (ThreadEvents::kCapacity - 1)];
+      // Events from before calibration would have negative timestamps.
+      if (event.startTicks < originTicks) {
+        continue;
+      }
+      output << ",\n{\"name\":\"" << event.name
+             << "\",\"cat\":\"PianoMann\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+             << thread << ",\"ts\":"
+             << String(static_cast<double>(event.startTicks - originTicks) *
+                           microsecondsPerTick,
+                       3)
+             << ",\"dur\":"
+             << String(static_cast<double>(event.endTicks - event.startTicks) *
+                           microsecondsPerTick,
+                       3);
+      if (event.argName != nullptr) {
+        output << ",\"args\":{\"" << event.argName << "\":" << event.argValue
+               << "}";
+      }
+      output << "}";
+    }
+  }
+  output << "\n],\"otherData\":{\"overwrittenEvents\":"
+         << String(numOverwrittenEvents) << ",\"droppedEvents\":"
+         << String(static_cast<int64>(numDroppedEvents.load())) << "}}\n";
+  output.flush();
+  return !output.getStatus().failed();
+}
+#else
+void prepare() {}
+
+bool exportChromeTrace(const File &file) {
+  ignoreUnused(file);
+  return false;
+}
+#endif
+} // namespace PianoMannTrace
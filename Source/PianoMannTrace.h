@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    PianoMannTrace.h
+    Created: 19 Oct 2026 9:14:26pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Profiling builds can define `PIANOMANN_ENABLE_TRACING=1` to record the time spent in the
+ * stages marked with `PIANOMANN_TRACE_SCOPE`, and export them as a Chrome trace which Perfetto
+ * and chrome://tracing open. Otherwise the scopes compile to nothing.
+ *
+ * Each thread records into its own ring buffer, claimed from a fixed pool the first time it
+ * records, so recording never locks. Timestamps are read from the CPU's time-stamp counter where
+ * there is one. Once a ring is full, its oldest events are overwritten. A thread gives its ring
+ * back when it exits, keeping its events for export until another thread claims the ring and
+ * carries on recording into it. The only allocation is the runtime's, once per thread, to give
+ * the ring back. Threads that find the pool exhausted record nothing until a ring is given back,
+ * and the exported trace counts what they dropped.
+ */
+#ifndef PIANOMANN_ENABLE_TRACING
+#define PIANOMANN_ENABLE_TRACING 0
+#endif
+
+#if PIANOMANN_ENABLE_TRACING && JUCE_INTEL
+#if JUCE_MSVC
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#if PIANOMANN_ENABLE_TRACING
+#include <array>
+#include <atomic>
+#endif
+
+namespace PianoMannTrace {
+constexpr bool kIsEnabled = PIANOMANN_ENABLE_TRACING != 0;
+
+/**
+ * Writes the events recorded so far to `file` as a Chrome trace. Returns false if tracing is
+ * compiled out or the file could not be written. Events recorded while exporting may be missed.
+ */
+bool exportChromeTrace(const File &file);
+
+/**
+ * A new file for a trace in the user's documents folder.
+ */
+File getDefaultFile();
+
+/**
+ * Faults in the ring buffers ahead of time so recording does not, and calibrates timestamps.
+ * Called from the message thread; does nothing if tracing is compiled out.
+ */
+void prepare();
+
+#if PIANOMANN_ENABLE_TRACING
+inline uint64 getTicks() noexcept {
+#if JUCE_INTEL
+  return __rdtsc();
+#else
+  return static_cast<uint64>(Time::getHighResolutionTicks());
+#endif
+}
+
+struct Event {
+  const char *name;
+  const char *argName;
+  int argValue;
+  uint64 startTicks;
+  uint64 endTicks;
+};
+
+/**
+ * The events recorded by the threads that claimed it, written only by the one that has it now.
+ */
+struct ThreadEvents {
+  static constexpr uint32 kCapacity = 1 << 17;
+  std::array<Event, kCapacity> events;
+  std::atomic<uint32> numRecorded{0};
+  std::atomic<bool> isClaimed{false};
+  std::atomic<bool> wasEverClaimed{false};
+
+  void record(const Event &event) noexcept {
+    const auto position = numRecorded.load(std::memory_order_relaxed);
+    events[position & (kCapacity - 1)] = event;
+    numRecorded.store(position + 1, std::memory_order_release);
+  }
+};
+
+/**
+ * Claims a ring for the calling thread. Returns nullptr while every ring is claimed.
+ */
+ThreadEvents *claimThreadEvents() noexcept;
+void releaseThreadEvents(ThreadEvents &events) noexcept;
+/**
+ * Counts an event that a thread without a ring could not record.
+ */
+void countDroppedEvent() noexcept;
+
+/**
+ * The ring of the calling thread, given back to the pool as the thread exits.
+ */
+struct ThreadEventsOwner {
+  ThreadEvents *events = nullptr;
+
+  ~ThreadEventsOwner() {
+    if (events != nullptr) {
+      releaseThreadEvents(*events);
+    }
+  }
+};
+inline thread_local ThreadEventsOwner threadEventsOwner;
+
+/**
+ * Records the time from its construction to its destruction.
+ */
+class Scope {
+public:
+  explicit Scope(const char *name, const char *argName = nullptr,
+                 int argValue = 0) noexcept
+      : name(name), argName(argName), argValue(argValue),
+        startTicks(getTicks()) {}
+
+  ~Scope() noexcept {
+    const auto endTicks = getTicks();
+    auto &owner = threadEventsOwner;
+    if (owner.events == nullptr) {
+      owner.events = claimThreadEvents();
+    }
+    if (owner.events != nullptr) {
+      owner.events->record({name, argName, argValue, startTicks, endTicks});
+    } else {
+      countDroppedEvent();
+    }
+  }
+
+private:
+  const char *name;
+  const char *argName;
+  int argValue;
+  uint64 startTicks;
+
+  JUCE_DECLARE_NON_COPYABLE(Scope)
+};
+
+#define PIANOMANN_TRACE_CONCATENATE_(a, b) a##b
+#define PIANOMANN_TRACE_CONCATENATE(a, b) PIANOMANN_TRACE_CONCATENATE_(a, b)
+/**
+ * Traces the rest of the enclosing block as `name`, a string literal.
+ */
+#define PIANOMANN_TRACE_SCOPE(name)                                            \
+  const PianoMannTrace::Scope PIANOMANN_TRACE_CONCATENATE(pianoMannTraceScope, \
+                                                          __LINE__)(name)
+/**
+ * Traces the rest of the enclosing block as `name`, annotated with an integer argument.
+ */
+#define PIANOMANN_TRACE_SCOPE_ARG(name, argName, argValue)                     \
+  const PianoMannTrace::Scope PIANOMANN_TRACE_CONCATENATE(pianoMannTraceScope, \
+                                                          __LINE__)(           \
+      name, argName, argValue)
+#else
+#define PIANOMANN_TRACE_SCOPE(name)
+#define PIANOMANN_TRACE_SCOPE_ARG(name, argName, argValue)
+#endif
+} // namespace PianoMannTrace
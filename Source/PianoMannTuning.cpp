@@ -0,0 +1,304 @@
+/*
+  ==============================================================================
+
+    PianoMannTuning.cpp
+    Created: 19 Oct 2026 11:38:52pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTuning.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+constexpr int kNoteA4 = 69;
+constexpr int kMiddleC = 60;
+/**
+ * Far more keys than any keyboard has, to reject corrupt mappings.
+ */
+constexpr int kMaxMapSize = 1024;
+
+double getEqualTemperedFrequency(int midiNoteNumber,
+                                 double referenceFrequency) {
+  return referenceFrequency *
+         std::pow(2.0, static_cast<double>(midiNoteNumber - kNoteA4) / 12.0);
+}
+
+/**
+ * The inharmonicity coefficient of a typical piano's strings. It is least around F3 and rises
+ * towards both ends of the keyboard, more steeply in the treble where the strings are short.
+ */
+double getInharmonicity(int midiNoteNumber) {
+  const auto fromF3 = static_cast<double>(midiNoteNumber - 53);
+  return 1.1e-4 * std::exp(0.094 * fromF3) + 1.0e-4 * std::exp(-0.045 * fromF3);
+}
+
+/**
+ * The frequency of a partial of a stiff string relative to its fundamental.
+ */
+double getPartialRatio(int partial, double inharmonicity) {
+  const auto partialSquared = static_cast<double>(partial * partial);
+  return partial * std::sqrt((1.0 + inharmonicity * partialSquared) /
+                             (1.0 + inharmonicity));
+}
+
+/**
+ * The lines of a Scala file that are not comments.
+ */
+StringArray getScalaLines(const String &text) {
+  StringArray lines;
+  for (const auto &line : StringArray::fromLines(text)) {
+    if (!line.startsWithChar('!')) {
+      lines.add(line);
+    }
+  }
+  return lines;
+}
+
+/**
+ * The value on a line of a Scala file, which may be followed by anything.
+ */
+String getScalaValue(const String &line) {
+  return line.trim().initialSectionNotContaining(" \t");
+}
+
+bool isScalaInteger(const String &value) {
+  return value.isNotEmpty() &&
+         value.trimCharactersAtStart("-").containsOnly("0123456789");
+}
+
+/**
+ * Parses a pitch of a scale, either in cents if it has a decimal point or as a ratio, to cents.
+ */
+bool parseScalaPitch(const String &value, double &cents) {
+  if (value.containsChar('.')) {
+    cents = value.getDoubleValue();
+    return value.trimCharactersAtStart("-").containsOnly("0123456789.");
+  }
+  const auto numerator = value.upToFirstOccurrenceOf("/", false, false);
+  const auto denominator = value.fromFirstOccurrenceOf("/", false, false);
+  if (!isScalaInteger(numerator) ||
+      (value.containsChar('/') && !isScalaInteger(denominator))) {
+    return false;
+  }
+  const auto ratio =
+      numerator.getDoubleValue() /
+      (value.containsChar('/') ? denominator.getDoubleValue() : 1.0);
+  if (!(ratio > 0.0) || !std::isfinite(ratio)) {
+    return false;
+  }
+  cents = 1200.0 * std::log2(ratio);
+  return true;
+}
+
+int floorDivide(int dividend, int divisor) {
+  return dividend / divisor - (dividend % divisor < 0 ? 1 : 0);
+}
+} // namespace
+
+PianoMannTuning PianoMannTuning::equalTemperament(double referenceFrequency) {
+  PianoMannTuning tuning;
+  tuning.name = "Equal temperament";
+  for (auto note = 0; note < kNumNotes; ++note) {
+    tuning.frequencies[static_cast<size_t>(note)] =
+        getEqualTemperedFrequency(note, referenceFrequency);
+  }
+  return tuning;
+}
+
+PianoMannTuning PianoMannTuning::stretched(double stretch,
+                                           double referenceFrequency) {
+  auto tuning = equalTemperament(referenceFrequency);
+  tuning.name = "Stretched";
+  auto &frequencies = tuning.frequencies;
+  const auto getScaledInharmonicity = [stretch](int note) {
+    return stretch * getInharmonicity(note);
+  };
+
+  constexpr auto kTemperamentStart = kNoteA4 - 12;
+  for (auto note = kNoteA4 + 1; note < kNumNotes; ++note) {
+    const auto lower = note - 12;
+    frequencies[static_cast<size_t>(note)] =
+        frequencies[static_cast<size_t>(lower)] *
+        getPartialRatio(2, getScaledInharmonicity(lower));
+  }
+  for (auto note = kTemperamentStart - 1; note >= 0; --note) {
+    const auto upper = note + 12;
+    frequencies[static_cast<size_t>(note)] =
+        frequencies[static_cast<size_t>(upper)] *
+        getPartialRatio(2, getScaledInharmonicity(upper)) /
+        getPartialRatio(4, getScaledInharmonicity(note));
+  }
+  return tuning;
+}
+
+Result PianoMannTuning::parseScala(const String &scale,
+                                   const String &keyboardMapping,
+                                   PianoMannTuning &result) {
+  // A scale is a description, the number of pitches, then the pitches above
+  // degree 0. The last pitch is the period the scale repeats at.
+  const auto scaleLines = getScalaLines(scale);
+  if (scaleLines.size() < 2 || !isScalaInteger(getScalaValue(scaleLines[1]))) {
+    return Result::fail("The scale has no number of pitches");
+  }
+  const auto numPitches = getScalaValue(scaleLines[1]).getIntValue();
+  std::vector<double> pitchCents{0.0};
+  for (auto lineIndex = 2; lineIndex < scaleLines.size() &&
+                           static_cast<int>(pitchCents.size()) <= numPitches;
+       ++lineIndex) {
+    const auto value = getScalaValue(scaleLines[lineIndex]);
+    if (value.isEmpty()) {
+      continue;
+    }
+    double cents;
+    if (!parseScalaPitch(value, cents)) {
+      return Result::fail("Unreadable pitch \"" + value + "\" in the scale");
+    }
+    pitchCents.push_back(cents);
+  }
+  if (numPitches < 1 || static_cast<int>(pitchCents.size()) != numPitches + 1) {
+    return Result::fail("The scale does not have as many pitches as it says");
+  }
+
+  // A keyboard mapping is seven values then one scale degree, or "x" for
+  // none, per key of the repeating pattern. A pattern of size 0 maps keys to
+  // consecutive degrees.
+  auto mapSize = 0, firstNote = 0, lastNote = kNumNotes - 1;
+  auto middleNote = kMiddleC, referenceNote = kMiddleC;
+  auto referenceFrequency = getEqualTemperedFrequency(kMiddleC, 440.0);
+  auto octaveDegree = numPitches;
+  std::vector<int> mapping;
+  if (keyboardMapping.isNotEmpty()) {
+    StringArray values;
+    for (const auto &line : getScalaLines(keyboardMapping)) {
+      const auto value = getScalaValue(line);
+      if (value.isNotEmpty()) {
+        values.add(value);
+      }
+    }
+    if (values.size() < 7) {
+      return Result::fail("The keyboard mapping is incomplete");
+    }
+    for (auto index = 0; index < 7; ++index) {
+      const auto isValid = index == 5 ? values[index].getDoubleValue() > 0.0
+                                      : isScalaInteger(values[index]);
+      if (!isValid) {
+        return Result::fail("Unreadable value \"" + values[index] +
+                            "\" in the keyboard mapping");
+      }
+    }
+    mapSize = values[0].getIntValue();
+    firstNote = jlimit(0, kNumNotes - 1, values[1].getIntValue());
+    lastNote = jlimit(0, kNumNotes - 1, values[2].getIntValue());
+    middleNote = values[3].getIntValue();
+    referenceNote = values[4].getIntValue();
+    referenceFrequency = values[5].getDoubleValue();
+    octaveDegree = values[6].getIntValue() > 0 ? values[6].getIntValue()
+                                               : numPitches;
+    if (mapSize < 0 || mapSize > kMaxMapSize) {
+      return Result::fail("The keyboard mapping has an unusable size");
+    }
+    for (auto index = 0; index < mapSize; ++index) {
+      const auto value = 7 + index < values.size() ? values[7 + index] : "x";
+      if (value.equalsIgnoreCase("x")) {
+        mapping.push_back(-1);
+      } else if (isScalaInteger(value) && value.getIntValue() >= 0) {
+        mapping.push_back(value.getIntValue());
+      } else {
+        return Result::fail("Unreadable degree \"" + value +
+                            "\" in the keyboard mapping");
+      }
+    }
+  }
+
+  // The scale degree of a key. Degrees below the middle note are negative, so
+  // whether the key is mapped at all is returned separately.
+  const auto getDegree = [&](int note, bool &isMapped) {
+    const auto offset = note - middleNote;
+    isMapped = true;
+    if (mapSize == 0) {
+      return offset;
+    }
+    const auto repeat = floorDivide(offset, mapSize);
+    const auto mappedDegree = mapping[static_cast<size_t>(offset - repeat * mapSize)];
+    isMapped = mappedDegree >= 0;
+    return repeat * octaveDegree + mappedDegree;
+  };
+  const auto getDegreeCents = [&](int degree) {
+    const auto period = floorDivide(degree, numPitches);
+    return period * pitchCents.back() +
+           pitchCents[static_cast<size_t>(degree - period * numPitches)];
+  };
+
+  bool isReferenceMapped;
+  const auto referenceDegree = getDegree(referenceNote, isReferenceMapped);
+  if (!isReferenceMapped) {
+    return Result::fail("The reference key of the keyboard mapping is unmapped");
+  }
+  const auto referenceCents = getDegreeCents(referenceDegree);
+
+  auto tuning = equalTemperament();
+  tuning.name = getScalaLines(scale)[0].trim();
+  for (auto note = firstNote; note <= lastNote; ++note) {
+    bool isMapped;
+    const auto degree = getDegree(note, isMapped);
+    if (isMapped) {
+      tuning.frequencies[static_cast<size_t>(note)] =
+          referenceFrequency *
+          std::pow(2.0, (getDegreeCents(degree) - referenceCents) / 1200.0);
+    }
+  }
+  result = tuning;
+  return Result::ok();
+}
+
+Result PianoMannTuning::loadScala(const File &scaleFile,
+                                  const File &keyboardMappingFile,
+                                  PianoMannTuning &result) {
+  if (!scaleFile.existsAsFile()) {
+    return Result::fail("Cannot read " + scaleFile.getFullPathName());
+  }
+  String keyboardMapping;
+  if (keyboardMappingFile != File()) {
+    if (!keyboardMappingFile.existsAsFile()) {
+      return Result::fail("Cannot read " +
+                          keyboardMappingFile.getFullPathName());
+    }
+    keyboardMapping = keyboardMappingFile.loadFileAsString();
+  }
+  const auto parsed =
+      parseScala(scaleFile.loadFileAsString(), keyboardMapping, result);
+  if (parsed.wasOk() && result.name.isEmpty()) {
+    result.name = scaleFile.getFileNameWithoutExtension();
+  }
+  return parsed;
+}
+
+String PianoMannTuning::toString() const {
+  StringArray values;
+  for (const auto frequency : frequencies) {
+    values.add(String(frequency, 6));
+  }
+  return name.replaceCharacter('\n', ' ') + "\n" + values.joinIntoString(" ");
+}
+
+PianoMannTuning PianoMannTuning::fromString(const String &text) {
+  auto tuning = equalTemperament();
+  StringArray values;
+  values.addTokens(text.fromFirstOccurrenceOf("\n", false, false), " ", "");
+  values.removeEmptyStrings();
+  if (values.size() != kNumNotes) {
+    return tuning;
+  }
+  for (auto note = 0; note < kNumNotes; ++note) {
+    const auto frequency = values[note].getDoubleValue();
+    if (!(frequency > 0.0)) {
+      return equalTemperament();
+    }
+    tuning.frequencies[static_cast<size_t>(note)] = frequency;
+  }
+  tuning.name = text.upToFirstOccurrenceOf("\n", false, false);
+  return tuning;
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    PianoMannTuning.h
+    Created: 19 Oct 2026 11:38:52pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * The pitch of every MIDI note. Tunings are plain values built on the message thread, and are
+ * turned into string lengths for a sample rate by `PianoMannVoice::tuneString`.
+ */
+class PianoMannTuning {
+public:
+  static constexpr int kNumNotes = 128;
+
+  /**
+   * Twelve-tone equal temperament with A4 at `referenceFrequency`.
+   */
+  static PianoMannTuning equalTemperament(double referenceFrequency = 440.0);
+
+  /**
+   * Equal temperament stretched the way tuners stretch a real piano. The octave A3 to A4 is
+   * tempered equally, and every other note is tuned beatless against the note an octave towards
+   * it: 2:1 going up, and 4:2 going down as bass octaves are judged by their upper partials. With
+   * the inharmonicity of real strings this gives the Railsback curve, about 30 cents sharp at the
+   * top and 10 flat at the bottom. `stretch` scales the inharmonicity, 0 being equal temperament.
+   */
+  static PianoMannTuning stretched(double stretch = 1.0,
+                                   double referenceFrequency = 440.0);
+
+  /**
+   * Parses the contents of a Scala scale file, and of a keyboard mapping file unless
+   * `keyboardMapping` is empty. Without a mapping, degree 0 of the scale is on middle C at its
+   * equal-tempered pitch. Keys the mapping leaves out keep their equal-tempered pitch.
+   */
+  static Result parseScala(const String &scale, const String &keyboardMapping,
+                           PianoMannTuning &result);
+  /**
+   * Loads `.scl` and optionally `.kbm` files, see `parseScala`. `keyboardMappingFile` may be a
+   * default-constructed `File`.
+   */
+  static Result loadScala(const File &scaleFile,
+                          const File &keyboardMappingFile,
+                          PianoMannTuning &result);
+
+  /**
+   * Saves and restores a tuning along with the plugin's state. An unusable string gives equal
+   * temperament.
+   */
+  String toString() const;
+  static PianoMannTuning fromString(const String &text);
+
+  double getFrequency(int midiNoteNumber) const {
+    jassert(isPositiveAndBelow(midiNoteNumber, kNumNotes));
+    return frequencies[static_cast<size_t>(midiNoteNumber)];
+  }
+  const String &getName() const { return name; }
+
+  bool operator==(const PianoMannTuning &other) const {
+    return frequencies == other.frequencies;
+  }
+  bool operator!=(const PianoMannTuning &other) const {
+    return !(*this == other);
+  }
+
+private:
+  String name;
+  std::array<double, kNumNotes> frequencies{};
+};
@@ -0,0 +1,269 @@
+/*
+  ==============================================================================
+
+    PianoMannVisualiser.cpp
+    Created: 19 Oct 2026 7:58:36pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannVisualiser.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Refreshes every open visualiser from a single timer, so dozens of open editors wake the message
+ * thread no more often than one.
+ */
+class PianoMannVisualiser::Ticker : private Timer {
+public:
+  ~Ticker() override { stopTimer(); }
+
+  void add(PianoMannVisualiser *visualiser) {
+    visualisers.add(visualiser);
+    if (!isTimerRunning()) {
+      startTimerHz(kFramesPerSecond);
+    }
+  }
+
+  void remove(PianoMannVisualiser *visualiser) {
+    visualisers.removeFirstMatchingValue(visualiser);
+    if (visualisers.isEmpty()) {
+      stopTimer();
+    }
+  }
+
+private:
+  /**
+   * The refresh rate of most displays.
+   */
+  static constexpr int kFramesPerSecond = 60;
+
+  void timerCallback() override {
+    for (auto *visualiser : visualisers) {
+      visualiser->refresh();
+    }
+  }
+
+  Array<PianoMannVisualiser *> visualisers;
+};
+
+namespace {
+constexpr auto kMinDecibels = -100.f;
+constexpr auto kMinFrequency = 20.f;
+/**
+ * How fast spectrum peaks fall back, which keeps the display from flickering.
+ */
+constexpr auto kSpectrumDecayDecibelsPerFrame = 1.5f;
+/**
+ * The range of string levels shown, down to about the silence threshold of the voices.
+ */
+constexpr auto kMinStringLevelDecibels = -66.f;
+} // namespace
+
+PianoMannVisualiser::PianoMannVisualiser(PianoMannAudioProcessor &p)
+    : processor(p) {
+  setOpaque(true);
+  std::fill(spectrumDecibels.begin(), spectrumDecibels.end(), kMinDecibels);
+  processor.setVisualiserOpen(true);
+
+  // The component paints everything; OpenGL only accelerates it.
+  openGLContext.setRenderer(this);
+  openGLContext.setComponentPaintingEnabled(true);
+  openGLContext.setContinuousRepainting(false);
+  openGLContext.attachTo(*this);
+
+  ticker->add(this);
+}
+
+PianoMannVisualiser::~PianoMannVisualiser() {
+  ticker->remove(this);
+  openGLContext.detach();
+  processor.setVisualiserOpen(false);
+}
+
+void PianoMannVisualiser::newOpenGLContextCreated() {
+  isOpenGLContextCreated = true;
+}
+
+void PianoMannVisualiser::renderOpenGL() {}
+
+void PianoMannVisualiser::checkOpenGL() {
+  if (isOpenGLContextCreated.load()) {
+    hasCheckedOpenGL = true;
+    return;
+  }
+  const auto nowSeconds = Time::getMillisecondCounterHiRes() * 0.001;
+  if (firstShownSeconds == 0.0) {
+    firstShownSeconds = nowSeconds;
+  } else if (nowSeconds - firstShownSeconds > kOpenGLTimeoutSeconds) {
+    // Detaching hands painting back to the software renderer.
+    openGLContext.detach();
+    hasCheckedOpenGL = true;
+    repaint();
+  }
+}
+
+void PianoMannVisualiser::refresh() {
+  if (!isShowing()) {
+    return;
+  }
+  if (!hasCheckedOpenGL) {
+    checkOpenGL();
+  }
+
+  auto hasRingingStrings = false;
+  for (auto midiNote = PianoMannSound::kMinNote;
+       midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
+    const auto level = processor.getStringLevel(midiNote);
+    stringLevels[static_cast<size_t>(midiNote)] = level;
+    hasRingingStrings = hasRingingStrings || level > 0.f;
+  }
+
+  const auto &feed = processor.getVisualiserFeed();
+  const auto writePosition = feed.getWritePosition();
+  if (writePosition != lastWritePosition &&
+      feed.readLatest(latestSamples.data(), kFftSize)) {
+    lastWritePosition = writePosition;
+    const auto range =
+        FloatVectorOperations::findMinAndMax(latestSamples.data(), kFftSize);
+    isSilent = range.getStart() == 0.f && range.getEnd() == 0.f;
+    // Keep updating through silence until the spectrum has fallen back.
+    if (!isSilent || !isSpectrumEmpty) {
+      updateScope();
+      updateSpectrum();
+    }
+  }
+
+  // Once everything is silent, the last frame stays up without repainting.
+  const auto isIdle = isSilent && isSpectrumEmpty && !hasRingingStrings &&
+                      !hadRingingStrings;
+  hadRingingStrings = hasRingingStrings;
+  if (!isIdle) {
+    repaint();
+  }
+}
+
+void PianoMannVisualiser::updateScope() {
+  // Look back up to one scope's width for a rising zero crossing.
+  scopeStart = kFftSize - kScopeSize;
+  for (auto index = kFftSize - kScopeSize; index > kFftSize - 2 * kScopeSize;
+       --index) {
+    if (latestSamples[static_cast<size_t>(index - 1)] < 0.f &&
+        latestSamples[static_cast<size_t>(index)] >= 0.f) {
+      scopeStart = index;
+      break;
+    }
+  }
+}
+
+void PianoMannVisualiser::updateSpectrum() {
+  std::copy(latestSamples.begin(), latestSamples.end(), fftData.begin());
+  window.multiplyWithWindowingTable(fftData.data(), kFftSize);
+  fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+  // A full-scale sine peaks at a quarter of the FFT size after the Hann window.
+  constexpr auto kNormalisation = 4.f / static_cast<float>(kFftSize);
+  isSpectrumEmpty = true;
+  for (size_t bin = 0; bin < spectrumDecibels.size(); ++bin) {
+    const auto decibels =
+        Decibels::gainToDecibels(kNormalisation * fftData[bin], kMinDecibels);
+    spectrumDecibels[bin] = jmax(
+        decibels, spectrumDecibels[bin] - kSpectrumDecayDecibelsPerFrame);
+    isSpectrumEmpty = isSpectrumEmpty && spectrumDecibels[bin] <= kMinDecibels;
+  }
+}
+
+void PianoMannVisualiser::paint(Graphics &g) {
+  g.fillAll(Colours::black);
+
+  auto bounds = getLocalBounds().toFloat().reduced(4.f);
+  paintStringLevels(g, bounds.removeFromBottom(24.f));
+  bounds.removeFromBottom(4.f);
+  paintScope(g, bounds.removeFromLeft(bounds.getWidth() / 2.f).reduced(2.f, 0.f));
+  paintSpectrum(g, bounds.reduced(2.f, 0.f));
+}
+
+void PianoMannVisualiser::paintScope(Graphics &g,
+                                     Rectangle<float> bounds) const {
+  g.setColour(Colours::darkgrey);
+  g.drawRect(bounds);
+
+  Path path;
+  const auto xScale = bounds.getWidth() / static_cast<float>(kScopeSize - 1);
+  const auto yScale = bounds.getHeight() / 2.f;
+  for (auto index = 0; index < kScopeSize; ++index) {
+    const auto sample = jlimit(
+        -1.f, 1.f, latestSamples[static_cast<size_t>(scopeStart + index)]);
+    const auto x = bounds.getX() + xScale * static_cast<float>(index);
+    const auto y = bounds.getCentreY() - yScale * sample;
+    if (index == 0) {
+      path.startNewSubPath(x, y);
+    } else {
+      path.lineTo(x, y);
+    }
+  }
+  g.setColour(Colours::lightgreen);
+  g.strokePath(path, PathStrokeType(1.f));
+}
+
+void PianoMannVisualiser::paintSpectrum(Graphics &g,
+                                        Rectangle<float> bounds) const {
+  g.setColour(Colours::darkgrey);
+  g.drawRect(bounds);
+
+  const auto sampleRate =
+      static_cast<float>(processor.getVisualiserFeed().getDecimatedSampleRate());
+  if (sampleRate <= 0.f) {
+    return;
+  }
+  const auto maxFrequency = sampleRate / 2.f;
+  const auto logFrequencyRange = std::log(maxFrequency / kMinFrequency);
+
+  Path path;
+  auto hasStarted = false;
+  for (size_t bin = 1; bin < spectrumDecibels.size(); ++bin) {
+    const auto frequency =
+        static_cast<float>(bin) * sampleRate / static_cast<float>(kFftSize);
+    if (frequency < kMinFrequency) {
+      continue;
+    }
+    const auto x = bounds.getX() + bounds.getWidth() *
+                                       std::log(frequency / kMinFrequency) /
+                                       logFrequencyRange;
+    const auto y = jmap(spectrumDecibels[bin], kMinDecibels, 0.f,
+                        bounds.getBottom(), bounds.getY());
+    if (!hasStarted) {
+      path.startNewSubPath(x, y);
+      hasStarted = true;
+    } else {
+      path.lineTo(x, y);
+    }
+  }
+  g.setColour(Colours::orange);
+  g.strokePath(path, PathStrokeType(1.f));
+}
+
+void PianoMannVisualiser::paintStringLevels(Graphics &g,
+                                            Rectangle<float> bounds) const {
+  constexpr auto kNumStrings =
+      PianoMannSound::kMaxNote - PianoMannSound::kMinNote + 1;
+  const auto barWidth = bounds.getWidth() / static_cast<float>(kNumStrings);
+
+  g.setColour(Colours::skyblue);
+  for (auto midiNote = PianoMannSound::kMinNote;
+       midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
+    const auto level = stringLevels[static_cast<size_t>(midiNote)];
+    if (level <= 0.f) {
+      continue;
+    }
+    const auto decibels =
+        Decibels::gainToDecibels(level, kMinStringLevelDecibels);
+    const auto height = bounds.getHeight() *
+                        jmap(decibels, kMinStringLevelDecibels, 0.f, 0.f, 1.f);
+    g.fillRect(bounds.getX() + barWidth * static_cast<float>(midiNote -
+                                                             PianoMannSound::kMinNote),
+               bounds.getBottom() - height, jmax(1.f, barWidth - 1.f), height);
+  }
+}
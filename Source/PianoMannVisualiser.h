@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    PianoMannVisualiser.h
+    Created: 19 Oct 2026 7:58:36pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PluginProcessor.h"
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/**
+ * Shows an oscilloscope and a spectrum of the output, and the level of every string.
+ *
+ * It is drawn through OpenGL where the system provides it and in software otherwise. Every open
+ * visualiser is refreshed from one shared timer at the display rate, and only repaints when there
+ * is new audio or a string is ringing, so many open instances stay cheap.
+ */
+class PianoMannVisualiser : public Component, private OpenGLRenderer {
+public:
+  explicit PianoMannVisualiser(PianoMannAudioProcessor &processor);
+  ~PianoMannVisualiser() override;
+
+  void paint(Graphics &g) override;
+
+private:
+  class Ticker;
+  SharedResourcePointer<Ticker> ticker;
+  /**
+   * Reads the latest audio and string levels, repainting if anything changed.
+   */
+  void refresh();
+
+  void updateScope();
+  void updateSpectrum();
+  void paintScope(Graphics &g, Rectangle<float> bounds) const;
+  void paintSpectrum(Graphics &g, Rectangle<float> bounds) const;
+  void paintStringLevels(Graphics &g, Rectangle<float> bounds) const;
+
+  PianoMannAudioProcessor &processor;
+  uint32 lastWritePosition = 0;
+  bool isSilent = true;
+  bool isSpectrumEmpty = true;
+  bool hadRingingStrings = false;
+
+  static constexpr int kFftOrder = 11;
+  static constexpr int kFftSize = 1 << kFftOrder;
+  static constexpr int kScopeSize = 512;
+  dsp::FFT fft{kFftOrder};
+  dsp::WindowingFunction<float> window{static_cast<size_t>(kFftSize),
+                                       dsp::WindowingFunction<float>::hann};
+  std::array<float, kFftSize> latestSamples{};
+  std::array<float, 2 * kFftSize> fftData{};
+  /**
+   * The spectrum in decibels, from DC up to half the decimated sample rate.
+   */
+  std::array<float, kFftSize / 2> spectrumDecibels{};
+  /**
+   * Where the scope starts in `latestSamples`, on a rising zero crossing so it holds still.
+   */
+  int scopeStart = kFftSize - kScopeSize;
+  std::array<float, 128> stringLevels{};
+
+  void newOpenGLContextCreated() override;
+  void renderOpenGL() override;
+  void openGLContextClosing() override {}
+
+  OpenGLContext openGLContext;
+  /**
+   * Set once the render thread has a context. Without one by `kOpenGLTimeoutSeconds` after first
+   * being shown, the visualiser falls back to painting in software.
+   */
+  std::atomic<bool> isOpenGLContextCreated{false};
+  bool hasCheckedOpenGL = false;
+  double firstShownSeconds = 0.0;
+  static constexpr double kOpenGLTimeoutSeconds = 1.0;
+  void checkOpenGL();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoMannVisualiser)
+};
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    PianoMannVisualiserFeed.h
+    Created: 19 Oct 2026 7:40:03pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannButterworthLowPassFilter.h"
+#include "PianoMannDspKernels.h"
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/**
+ * Hands the output from the audio thread to the visualiser. The audio thread low-passes a mono mix
+ * and writes it decimated into a ring buffer, which the GUI reads the latest samples of at its own
+ * pace. Nothing is written while no visualiser is open, so a closed editor costs one atomic load
+ * per callback.
+ */
+class PianoMannVisualiserFeed {
+public:
+  static constexpr int kDecimation = 4;
+  static constexpr int kRingSize = 4096;
+  /**
+   * The voicing can open the post filter up to 20kHz, so the mix is low-passed on its own before it
+   * is decimated. The filter cuts off below the decimated Nyquist frequency, and the spectrum
+   * above the cut-off rolls away rather than showing what folded back.
+   */
+  static constexpr int kAntiAliasOrder = 12;
+  static constexpr double kAntiAliasCutoff = 0.8;
+
+  void prepare(double sampleRate) {
+    decimatedSampleRate = sampleRate / kDecimation;
+    antiAliasCascade = PianoMannButterworthLowPassFilter::design(
+        static_cast<float>(kAntiAliasCutoff * sampleRate / kDecimation / 2.0),
+        sampleRate, kAntiAliasOrder);
+    antiAliasState = {};
+    decimationPhase = 0;
+    wasActive = false;
+  }
+
+  /**
+   * The rate of the samples read by `readLatest`.
+   */
+  double getDecimatedSampleRate() const { return decimatedSampleRate.load(); }
+
+  void setActive(bool shouldBeActive) { isActive = shouldBeActive; }
+
+  /**
+   * Called from the audio thread with the final output.
+   */
+  void push(const AudioBuffer<float> &buffer, int numChannels) {
+    if (!isActive.load(std::memory_order_relaxed)) {
+      wasActive = false;
+      return;
+    }
+    numChannels = jmin(numChannels, buffer.getNumChannels());
+    if (numChannels <= 0) {
+      return;
+    }
+    // Whatever the filter held from before the visualiser closed is stale.
+    if (!wasActive) {
+      antiAliasState = {};
+      wasActive = true;
+    }
+
+    const auto &kernels = PianoMannDspKernels::getKernels();
+    const auto gain = 1.f / static_cast<float>(numChannels);
+    auto position = writePosition.load(std::memory_order_relaxed);
+    for (auto startSample = 0; startSample < buffer.getNumSamples();
+         startSample += kChunkSize) {
+      const auto numSamples =
+          jmin(kChunkSize, buffer.getNumSamples() - startSample);
+      FloatVectorOperations::copyWithMultiply(
+          mix.data(), buffer.getReadPointer(0, startSample), gain, numSamples);
+      for (auto channel = 1; channel < numChannels; ++channel) {
+        FloatVectorOperations::addWithMultiply(
+            mix.data(), buffer.getReadPointer(channel, startSample), gain,
+            numSamples);
+      }
+      kernels.processBiquadCascade(antiAliasCascade, antiAliasState,
+                                   mix.data(), numSamples);
+
+      auto sampleIndex = decimationPhase;
+      for (; sampleIndex < numSamples; sampleIndex += kDecimation) {
+        ring[position & kRingMask].store(
+            mix[static_cast<size_t>(sampleIndex)], std::memory_order_relaxed);
+        ++position;
+      }
+      decimationPhase = sampleIndex - numSamples;
+    }
+    writePosition.store(position, std::memory_order_release);
+  }
+
+  /**
+   * Counts the samples written so far, so readers can tell whether anything new arrived.
+   */
+  uint32 getWritePosition() const {
+    return writePosition.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Copies the latest `numSamples` samples, oldest first. Returns false if the audio thread
+   * overwrote them while they were being read.
+   */
+  bool readLatest(float *destination, int numSamples) const {
+    jassert(numSamples <= kRingSize);
+    const auto endPosition = getWritePosition();
+    const auto startPosition = endPosition - static_cast<uint32>(numSamples);
+    for (auto index = 0; index < numSamples; ++index) {
+      destination[index] =
+          ring[(startPosition + static_cast<uint32>(index)) & kRingMask].load(
+              std::memory_order_relaxed);
+    }
+    return getWritePosition() - startPosition <= static_cast<uint32>(kRingSize);
+  }
+
+private:
+  static constexpr uint32 kRingMask = kRingSize - 1;
+  static_assert((kRingSize & kRingMask) == 0, "The ring size must be a power of two");
+  /**
+   * The mix is filtered this many samples at a time, so callbacks of any size need no allocation.
+   */
+  static constexpr int kChunkSize = 256;
+
+  std::array<std::atomic<float>, kRingSize> ring{};
+  std::atomic<uint32> writePosition{0};
+  std::atomic<double> decimatedSampleRate{0.0};
+  std::atomic<bool> isActive{false};
+  /**
+   * Owned by the audio thread: the anti-aliasing filter, the mix being filtered, the offset into
+   * the next chunk of its first decimated sample, and whether the last callback was written.
+   */
+  PianoMannDspKernels::BiquadCascade antiAliasCascade;
+  PianoMannDspKernels::BiquadState antiAliasState;
+  std::array<float, kChunkSize> mix{};
+  int decimationPhase = 0;
+  bool wasActive = false;
+};
@@ -10,8 +10,15 @@
 
 #pragma once
 
+#include "PianoMannDspKernels.h"
+#include "PianoMannTrace.h"
+#include "PianoMannVoicing.h"
 #include <JuceHeader.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <type_traits>
 #include <vector>
 
 /**
@@ -57,11 +64,68 @@ private:
   int midiNoteNumber;
 };
 
+/**
+ * Pedal positions shared by every voice of the synthesiser. Pedals are treated as omni since the
+ * whole instrument is one piano regardless of the channel a controller arrives on.
+ */
+struct PianoMannPedalState {
+  /**
+   * The sustain pedal position from CC64, in [0, 1]. Intermediate values are half-pedalling where
+   * the dampers only lightly touch the strings.
+   */
+  float sustain = 0.f;
+
+  /**
+   * The pedal travel over which the dampers go from resting fully on the strings to fully lifted.
+   */
+  static constexpr float kHalfPedalStart = 0.2f;
+  static constexpr float kHalfPedalEnd = 0.7f;
+
+  /**
+   * How firmly the dampers rest on released strings given the current sustain pedal position.
+   * A value of 1 is fully damped and 0 is fully lifted.
+   */
+  float getDamperEngagement() const {
+    return 1.f - jlimit(0.f, 1.f,
+                        (sustain - kHalfPedalStart) /
+                            (kHalfPedalEnd - kHalfPedalStart));
+  }
+};
+
 struct PianoMannVoiceParams {
   /**
    * The midi note number being played. This maps to one single piano key.
    */
   int midiNoteNumber;
+  /**
+   * The pedal state of the owning synthesiser.
+   */
+  const PianoMannPedalState *pedalState;
+};
+
+/**
+ * The loop of a string tuned to a frequency at a sample rate and voiced, see
+ * `PianoMannVoice::tuneString`.
+ */
+struct PianoMannStringTuning {
+  double frequency = 0.0;
+  double sampleRate = 0.0;
+  int delayLineSize = 0;
+  float allpassCoefficient = 0.f;
+  /**
+   * The loop filter and loop gain of the note's voicing, see `PianoMannVoicing::Note`.
+   */
+  float weightedAverageFilter = 1.f;
+  float sustainLoopGain = 0.f;
+  /**
+   * Whether the string has a damper, and the loop gain per period of it fully damped.
+   */
+  bool hasDamper = false;
+  float damperLoopGain = 1.f;
+  /**
+   * How far the hammer's push reflects off the near end of the string, in samples.
+   */
+  int hammerReflectionOffset = 1;
 };
 
 /**
@@ -70,7 +134,11 @@ struct PianoMannVoiceParams {
  * techniques.
  */
 struct PianoMannVoice : public SynthesiserVoice {
-  PianoMannVoice(PianoMannVoiceParams params) : params(params) {}
+  PianoMannVoice(PianoMannVoiceParams params) : params(params) {
+    jassert(params.pedalState != nullptr);
+  }
+
+  int getMidiNoteNumber() const { return params.midiNoteNumber; }
 
   bool canPlaySound(SynthesiserSound *sound) override {
     if (auto *pianoMannSound = dynamic_cast<PianoMannSound *>(sound)) {
@@ -79,125 +147,393 @@ struct PianoMannVoice : public SynthesiserVoice {
     return false;
   }
 
+  /**
+   * Seeds the noise of the excitation, so a given seed always produces the same audio. This takes
+   * effect the next time the string is prepared.
+   */
+  void setExcitationSeed(int64 newExcitationSeed) {
+    excitationSeed = newExcitationSeed;
+  }
+
+  /**
+   * Draws fresh noise for every strike so that repeated notes are not identical. The noise is
+   * keyed on the excitation seed, the note and the number of strikes since the string was
+   * prepared, so a given seed still always produces the same audio. Otherwise every strike uses
+   * the noise drawn when the string was prepared.
+   */
+  void setStrikeVariationEnabled(bool shouldVary) { isStrikeVariationEnabled = shouldVary; }
+
+  /**
+   * Excites softer strikes with duller noise, as a felt hammer hitting the string more gently
+   * excites fewer high partials.
+   */
+  void setVelocityShapingEnabled(bool shouldShape) { isVelocityShapingEnabled = shouldShape; }
+
+  /**
+   * Strikes the string with a felt hammer instead of filling it with noise. The hammer pushes on
+   * the string loop for the first few milliseconds of the note, and being nonlinear, harder
+   * strikes are both louder and brighter. Once it leaves the string the voice renders as usual.
+   * With strike variation, the felt is slightly different every strike.
+   */
+  void setHammerModelEnabled(bool shouldStrike) { isHammerModelEnabled = shouldStrike; }
+
+  /**
+   * How many strikes were hammered, and how many samples their attacks took between them, since
+   * the sample rate was last set. Read them from the thread rendering, or once rendering has
+   * stopped.
+   */
+  int64 getNumHammeredStrikes() const { return numHammeredStrikes; }
+  int64 getNumAttackSamples() const { return numAttackSamples; }
+
+  /**
+   * Only records the new rate. The string is built for it by `prepareForCurrentSampleRate`, which
+   * is expensive and so may be called later from a background thread.
+   */
   void setCurrentPlaybackSampleRate(double newRate) override {
+    isStringPrepared.store(false, std::memory_order_release);
     SynthesiserVoice::setCurrentPlaybackSampleRate(newRate);
-    if (newRate != 0.0) {
-      prepareExcitationBuffers();
+    renderCacheValidLength = 0;
+    hasNextStringTuning = false;
+    numHammeredStrikes = 0;
+    numAttackSamples = 0;
+  }
+
+  /**
+   * Builds the string to `tuning`, which is for the current sample rate, restoring
+   * `numCachedSamples` of a render cache recorded with that loop if given. The voice is not played
+   * until this is done, so it is safe to call from a background thread while the synthesiser
+   * renders.
+   */
+  void prepareForCurrentSampleRate(const PianoMannStringTuning &tuning,
+                                   const float *cachedSamples = nullptr,
+                                   int numCachedSamples = 0) {
+    jassert(!isPrepared());
+    prepareExcitationBuffers(tuning);
+    if (cachedSamples != nullptr) {
+      renderCacheValidLength =
+          jmin(numCachedSamples, static_cast<int>(renderCache.size()));
+      std::copy(cachedSamples, cachedSamples + renderCacheValidLength,
+                renderCache.begin());
     }
+    isStringPrepared.store(true, std::memory_order_release);
+  }
+
+  bool isPrepared() const {
+    return isStringPrepared.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Tunes and voices the string to `tuning` from its next strike, so a string that is still
+   * ringing keeps the pitch and tone it was struck with. A tuning for another sample rate is
+   * ignored. Called from the rendering thread.
+   */
+  void setNextStringTuning(const PianoMannStringTuning &tuning) {
+    nextStringTuning = tuning;
+    hasNextStringTuning = true;
+  }
+
+  /**
+   * The loop the string is tuned to, which the render cache was recorded with.
+   */
+  const PianoMannStringTuning &getStringTuning() const { return stringTuning; }
+
+  /**
+   * The lowest frequency a string can be tuned to. The delay line is allocated long enough for it
+   * up front, so retuning never allocates.
+   */
+  static constexpr double kMinStringFrequency = 20.0;
+
+  /**
+   * Works out the loop of the string for `midiNoteNumber` as `voicing` voices it, tuned to
+   * `frequency`, which is limited to what the loop can play. The averaging filter delays the
+   * fundamental by a fraction of a sample on top of the delay line, and a first-order allpass
+   * makes up the rest of the period, so the string is in tune between whole samples.
+   */
+  static PianoMannStringTuning tuneString(const PianoMannVoicing &voicing,
+                                          int midiNoteNumber, double frequency,
+                                          double sampleRate) {
+    jassert(sampleRate > 0.0);
+    const auto note = voicing.getNote(midiNoteNumber);
+    PianoMannStringTuning tuning;
+    tuning.frequency = jlimit(kMinStringFrequency, sampleRate / 8.0, frequency);
+    tuning.sampleRate = sampleRate;
+    tuning.weightedAverageFilter = note.weightedAverageFilter;
+    tuning.sustainLoopGain = note.sustain;
+
+    const auto period = sampleRate / tuning.frequency;
+    const auto angularFrequency = MathConstants<double>::twoPi / period;
+    // The filter feeds `g * (1-S)` of its last output back, which is where
+    // its delay at the fundamental comes from.
+    const auto feedback =
+        static_cast<double>(note.sustain) *
+        (1.0 - static_cast<double>(note.weightedAverageFilter));
+    const auto filterDelay =
+        std::atan2(feedback * std::sin(angularFrequency),
+                   1.0 - feedback * std::cos(angularFrequency)) /
+        angularFrequency;
+    // The allpass delay is kept between half a sample and a sample and a
+    // half, where its delay is flattest across the partials.
+    const auto loopDelay = period - filterDelay;
+    tuning.delayLineSize =
+        jmax(2, static_cast<int>(std::floor(loopDelay - 0.5)));
+    const auto allpassDelay = loopDelay - tuning.delayLineSize;
+    tuning.allpassCoefficient =
+        static_cast<float>(std::sin(0.5 * (1.0 - allpassDelay) * angularFrequency) /
+                           std::sin(0.5 * (1.0 + allpassDelay) * angularFrequency));
+
+    // The loop gain is applied once per trip around the string, so the
+    // damped decay time sets the gain per period.
+    tuning.hasDamper = note.hasDamper();
+    tuning.damperLoopGain =
+        tuning.hasDamper
+            ? static_cast<float>(std::pow(
+                  10.0, -3.0 * period /
+                            (sampleRate * static_cast<double>(note.damperDecaySeconds))))
+            : 1.f;
+    tuning.hammerReflectionOffset =
+        jlimit(1, jmax(1, tuning.delayLineSize - 2),
+               roundToInt(kHammerStrikePosition *
+                          static_cast<float>(tuning.delayLineSize)));
+    return tuning;
   }
 
   void startNote(int midiNoteNumber, float velocity, SynthesiserSound *,
                  int currentPitchWheelPosition) override {
+    PIANOMANN_TRACE_SCOPE_ARG("startNote", "note", params.midiNoteNumber);
     ignoreUnused(currentPitchWheelPosition);
     jassert(midiNoteNumber == params.midiNoteNumber);
-    jassert(isExcitationBufferReady);
+    jassert(isPrepared());
     ignoreUnused(midiNoteNumber);
+    if (hasNextStringTuning) {
+      hasNextStringTuning = false;
+      retuneString(nextStringTuning);
+    }
     currentNoteVelocity = velocity;
     isNoteHeld = true;
-    tailOff = 0.f;
+    isRetiring = false;
+    damperTarget = 0.f;
+    isDamperRamping = false;
+    retireGain.setCurrentAndTargetValue(1.f);
+    peakLevel = velocity;
+    windowPeakLevel = 0.f;
+    windowNumSamples = 0;
+    noteSampleIndex = 0;
+    isStrikeVaried = isStrikeVariationEnabled.load(std::memory_order_relaxed);
+    isStrikeShaped = isVelocityShapingEnabled.load(std::memory_order_relaxed);
+    isStrikeHammered = isHammerModelEnabled.load(std::memory_order_relaxed);
+    excitationKey = PianoMannDspKernels::hash(
+        static_cast<uint32>(excitationSeed.load(std::memory_order_relaxed)) ^
+        PianoMannDspKernels::hash(static_cast<uint32>(params.midiNoteNumber) ^
+                                  PianoMannDspKernels::hash(strikeCount++)));
+
+    // An unmodulated strike is the cached waveform scaled by velocity, so
+    // there is no need to excite the string until handing off. Strikes with
+    // their own noise or tone, or from the nonlinear hammer, are not cached.
+    const auto isStrikeCacheable =
+        !isStrikeVaried && !isStrikeShaped && !isStrikeHammered;
+    isPlayingFromCache = isStrikeCacheable && renderCacheValidLength > 1;
+    isRecordingToCache = isStrikeCacheable && !isPlayingFromCache &&
+                         !renderCache.empty() && currentNoteVelocity > 0.f;
     exciteBuffer();
+    numHammeredStrikes += isHammerInContact ? 1 : 0;
   }
 
   void stopNote(float velocity, bool allowTailOff) override {
     ignoreUnused(velocity);
-    if (allowTailOff) {
-      if (tailOff == 0.f) {
-        tailOff = 1.0f;
-      }
-    } else {
+    if (!allowTailOff) {
       clearCurrentNote();
     }
+    // With tail-off, the dampers take over in renderNextBlock.
     isNoteHeld = false;
   }
 
   /**
-   * The Karplus-Strong synthesis algorithm we have uses a two-point weighted average
-   * filter. The value returned here determines the weight of the `current` sample.
-   * The filter is defined as
-   * ```
-   * let S = return value;
-   * y[t] = S*x[t] + (1-S)*x[t-1]
-   * ```
+   * Quickly fades out the note regardless of the key and pedal state. This is used to bound the
+   * number of strings ringing at once.
    */
-  static constexpr float getWeightedAverageFilterForNote(int midiNoteNumber) {
-    if (midiNoteNumber <= MidiOctaves::kOctave_0 + 6) {
-      return 0.43f;
-    }
-    if (midiNoteNumber >= MidiOctaves::kOctave_5) {
-      return 0.85f;
+  void retire() {
+    if (!isRetiring) {
+      isRetiring = true;
+      retireGain.setTargetValue(0.f);
     }
-    return 0.7f;
   }
 
-  struct DecaySpec {
-    /**
-     * The decay rate for the note's sustain. Value must be [0, 1].
-     */
-    float sustain;
-    /**
-     * The additional decay rate after the note is released. This is used to
-     * slowly fade out a note upon release. Value must be [0, 1].
-     */
-    float release;
-  };
+  bool isBeingRetired() const { return isRetiring; }
+
   /**
-   * Gets the sustain and release parameters given a midi note number.
+   * Sets the output level below which the voice retires itself.
    */
-  static constexpr DecaySpec getDecayForNote(int midiNoteNumber) {
-    constexpr auto kRelease = 0.992f;
-    if (midiNoteNumber >= MidiOctaves::kOctave_5) {
-      return DecaySpec{0.9992f, kRelease};
-    }
-    return DecaySpec{0.997f, kRelease};
+  void setSilenceThreshold(float newSilenceThreshold) {
+    silenceThreshold = newSilenceThreshold;
   }
 
-  void renderNextBlock(AudioBuffer<float> &outputBuffer, int startSample,
-                       int numSamples) override {
-    const static auto weightedAverageFilterFactor =
-        getWeightedAverageFilterForNote(params.midiNoteNumber);
-    const static auto decaySpec = getDecayForNote(params.midiNoteNumber);
+  /**
+   * The peak output level over the last full period of the string.
+   */
+  float getPeakLevel() const { return peakLevel; }
+
+  /**
+   * Enables caching the waveform of unmodulated strikes. Once recorded, later strikes play the
+   * cached audio back until they are released or otherwise modulated, and then hand off to live
+   * synthesis. This takes effect the next time the string is prepared.
+   */
+  void setRenderCacheEnabled(bool shouldCache) { isRenderCacheEnabled = shouldCache; }
 
-    constexpr auto kDecayPowerLevelThreshold = 0.005f;
+  /**
+   * Keeps the delay line in half precision while the string rings on its own, which halves the
+   * memory it streams through every period. The loop still computes in single precision, but what
+   * it stores is rounded to 11 significant bits, which leaves an error that decays with the note.
+   * Strikes, the hammer and moving dampers work on a single-precision copy. This takes effect the
+   * next time the string is prepared.
+   */
+  void setCompactDelayLineEnabled(bool shouldCompact) {
+    isCompactDelayLineEnabled = shouldCompact;
+  }
 
-    if (!isNoteHeld && tailOff == 0.f) {
-      // Not playing note nor releasing it slowly
+  /**
+   * The cached waveform at unit velocity. Only the first `getRenderCacheValidLength()` samples
+   * have been recorded.
+   */
+  const std::vector<float> &getRenderCache() const { return renderCache; }
+  int getRenderCacheValidLength() const { return renderCacheValidLength; }
+
+  /**
+   * Writes everything about the string that changes as it plays, so a voice for the same note,
+   * prepared with the same settings, carries on from `readState` exactly where this one left off.
+   * The state is only meant to be read back by the same build. A silent string only writes what
+   * outlasts its note, so voices that will sound the same write the same bytes.
+   *
+   * Whether the voice is playing, and on which channel, is up to the synthesiser, see
+   * `PianoMannSynthesiser::writeState`.
+   */
+  void writeState(OutputStream &output) const {
+    writeValues(output, strikeCount, stringTuning, hasNextStringTuning,
+                nextStringTuning, renderCacheValidLength);
+    output.write(renderCache.data(),
+                 static_cast<size_t>(renderCacheValidLength) * sizeof(float));
+    if (!isVoiceActive()) {
       return;
     }
+    writeValues(output, isKeyDown(), isSustainPedalDown(),
+                isSostenutoPedalDown(), isDelayLineCompact);
+    const auto delayLineSize = static_cast<size_t>(stringTuning.delayLineSize);
+    if (isDelayLineCompact) {
+      output.write(compactDelayLineBuffer.data(),
+                   delayLineSize * sizeof(uint16));
+    } else {
+      output.write(delayLineBuffer.data(), delayLineSize * sizeof(float));
+    }
+    visitPlayingState(*this, [&output](const auto &value) {
+      writeValues(output, value);
+    });
+  }
 
-    if (tailOff > 0.f) {
-      // tailOff > 0.f implies we are releasing this note slowly.
-      tailOff *= decaySpec.release;
-      if (tailOff < kDecayPowerLevelThreshold) {
-        tailOff = 0.f;
-        clearCurrentNote();
-        return;
-      }
+  /**
+   * Restores what `writeState` wrote. The synthesiser has already started the note if it was
+   * playing.
+   */
+  void readState(InputStream &input) {
+    readValues(input, strikeCount, stringTuning, hasNextStringTuning,
+               nextStringTuning, renderCacheValidLength);
+    jassert(renderCacheValidLength <= static_cast<int>(renderCache.size()));
+    input.read(renderCache.data(),
+               static_cast<int>(renderCacheValidLength * sizeof(float)));
+    if (!isVoiceActive()) {
+      return;
     }
+    bool isKeyHeld, isSustained, isSostenutoLatched;
+    readValues(input, isKeyHeld, isSustained, isSostenutoLatched,
+               isDelayLineCompact);
+    setKeyDown(isKeyHeld);
+    setSustainPedalDown(isSustained);
+    setSostenutoPedalDown(isSostenutoLatched);
+    const auto delayLineSize = stringTuning.delayLineSize;
+    if (isDelayLineCompact) {
+      jassert(delayLineSize <= static_cast<int>(compactDelayLineBuffer.size()));
+      input.read(compactDelayLineBuffer.data(),
+                 static_cast<int>(delayLineSize * sizeof(uint16)));
+    } else {
+      jassert(delayLineSize <= static_cast<int>(delayLineBuffer.size()));
+      input.read(delayLineBuffer.data(),
+                 static_cast<int>(delayLineSize * sizeof(float)));
+    }
+    visitPlayingState(*this,
+                      [&input](auto &value) { readValues(input, value); });
+  }
 
-    for (auto sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex) {
-      const auto nextBufferPosition = (1 + currentBufferPosition) %
-                                      static_cast<int>(delayLineBuffer.size());
+  void renderNextBlock(AudioBuffer<float> &outputBuffer, int startSample,
+                       int numSamples) override {
+    if (!isVoiceActive()) {
+      return;
+    }
+    PIANOMANN_TRACE_SCOPE_ARG("renderVoice", "note", params.midiNoteNumber);
 
-      const auto weightedNextDelaySample =
-          weightedAverageFilterFactor * delayLineBuffer[nextBufferPosition];
-      const auto weightCurrentDelaySample =
-          (1 - weightedAverageFilterFactor) *
-          delayLineBuffer[currentBufferPosition];
+    setDamperTarget(getTargetDamperEngagement());
 
-      auto decay = decaySpec.sustain;
-      if (tailOff > 0.f) {
-        decay *= tailOff;
-      }
-      delayLineBuffer[nextBufferPosition] =
-          decay * (weightedNextDelaySample + weightCurrentDelaySample);
+    const auto delayLineSize = stringTuning.delayLineSize;
+    while (numSamples > 0 && isVoiceActive()) {
+      // Chunks never straddle a chunk of the damper ramp nor the end of a
+      // silence window. Both are counted from when they started, so the
+      // output does not depend on how the host and synthesiser split blocks.
+      auto numChunkSamples = jmin(numSamples, kChunkSize - damperRampPhase,
+                                  delayLineSize - windowNumSamples);
 
-      const auto currentSample = delayLineBuffer[currentBufferPosition];
-      for (auto channel = outputBuffer.getNumChannels(); --channel >= 0;) {
-        auto *output = outputBuffer.getWritePointer(channel, startSample);
-        output[sampleIndex] += currentSample;
+      if (isPlayingFromCache) {
+        if (isDamperRamping || damperTarget != 0.f || isRetiring) {
+          handOffToLiveSynthesis();
+          continue;
+        }
+        const auto numCachedSamples = getRenderCacheHandOffIndex() - noteSampleIndex;
+        if (numCachedSamples == 0) {
+          handOffToLiveSynthesis();
+          continue;
+        }
+        numChunkSamples = jmin(numChunkSamples, numCachedSamples);
+        FloatVectorOperations::copyWithMultiply(
+            chunkOutput.data(), renderCache.data() + noteSampleIndex,
+            currentNoteVelocity, numChunkSamples);
+      } else if (isInHammerAttack) {
+        PIANOMANN_TRACE_SCOPE_ARG("hammerContact", "note",
+                                  params.midiNoteNumber);
+        // The attack keeps to chunks counted from the strike, so it hands
+        // over to the sustain at the same sample however blocks are split.
+        numChunkSamples =
+            jmin(numChunkSamples, kChunkSize - noteSampleIndex % kChunkSize);
+        fillExcitation(noteSampleIndex + numChunkSamples + 2 +
+                       stringTuning.hammerReflectionOffset);
+        renderChunkFor<true>(numChunkSamples);
+        numAttackSamples += numChunkSamples;
+        isInHammerAttack = isHammerInContact ||
+                           (noteSampleIndex + numChunkSamples) % kChunkSize != 0;
+      } else {
+        if (!compactDelayLineBuffer.empty() && !isDelayLineCompact) {
+          // The line is only compacted on a chunk boundary counted from the
+          // strike, see `renderChunk`, so chunks keep to those until then.
+          numChunkSamples =
+              jmin(numChunkSamples, kChunkSize - noteSampleIndex % kChunkSize);
+        }
+        fillExcitation(noteSampleIndex + numChunkSamples + 1);
+        renderChunkFor<false>(numChunkSamples);
       }
+      emitChunk(outputBuffer, startSample, numChunkSamples);
+      noteSampleIndex += numChunkSamples;
+      startSample += numChunkSamples;
+      numSamples -= numChunkSamples;
 
-      currentBufferPosition = nextBufferPosition;
+      // Only judge silence over a full period, otherwise a quiet part of the
+      // waveform could be mistaken for the end of the note.
+      windowNumSamples += numChunkSamples;
+      if (windowNumSamples == delayLineSize) {
+        peakLevel = windowPeakLevel;
+        windowPeakLevel = 0.f;
+        windowNumSamples = 0;
+        if (peakLevel < silenceThreshold.load(std::memory_order_relaxed)) {
+          clearCurrentNote();
+        }
+      }
+      if (isRetiring && !retireGain.isSmoothing()) {
+        clearCurrentNote();
+      }
     }
   }
 
@@ -205,44 +541,587 @@ struct PianoMannVoice : public SynthesiserVoice {
 
   void pitchWheelMoved(int newValue) override { ignoreUnused(newValue); }
   void controllerMoved(int controllerNumber, int newValue) override {
+    // Pedals are tracked by the synthesiser in `PianoMannPedalState`.
     ignoreUnused(controllerNumber, newValue);
   }
 
 private:
   /**
-   * Set up the delay-line as shown in Karplus-Strong. The length of the delay line determines
-   * the frequency of note played.
+   * Set up the delay-line as shown in Karplus-Strong. The length of the delay line in use
+   * determines the frequency of note played, see `tuneString`.
    */
-  void prepareExcitationBuffers() {
+  void prepareExcitationBuffers(const PianoMannStringTuning &tuning) {
     const auto sampleRate = getSampleRate();
-    jassert(sampleRate != 0.0);
+    jassert(sampleRate != 0.0 && tuning.sampleRate == sampleRate);
 
-    const auto frequencyInHz =
-        MidiMessage::getMidiNoteInHertz(params.midiNoteNumber);
-    const auto excitationNumSamples = roundToInt(sampleRate / frequencyInHz);
+    stringTuning = tuning;
+    const auto capacity =
+        static_cast<size_t>(std::ceil(sampleRate / kMinStringFrequency)) + 1;
 
-    delayLineBuffer.resize(excitationNumSamples);
-    std::fill(delayLineBuffer.begin(), delayLineBuffer.end(), 0.f);
+    delayLineBuffer.assign(capacity, 0.f);
+    compactDelayLineBuffer.assign(isCompactDelayLineEnabled ? capacity : 0, 0);
+    compactDelayLineBuffer.shrink_to_fit();
+    isDelayLineCompact = false;
 
-    excitationBuffer.resize(excitationNumSamples);
-    std::generate(excitationBuffer.begin(), excitationBuffer.end(), [] {
-      return (Random::getSystemRandom().nextFloat() * 2.0f) - 1.0f;
+    // Every note draws its own sequence from the shared seed.
+    Random random(excitationSeed);
+    random.combineSeed(params.midiNoteNumber);
+    excitationBuffer.resize(capacity);
+    std::generate(excitationBuffer.begin(), excitationBuffer.end(), [&random] {
+      return (random.nextFloat() * 2.0f) - 1.0f;
     });
 
+    // The damper moves onto and off the string exponentially.
+    constexpr auto kDamperTimeConstantSeconds = 0.002;
+    const auto damperRampFactor =
+        std::exp(-1.0 / (kDamperTimeConstantSeconds * sampleRate));
+    for (size_t power = 0; power < damperRampPowers.size(); ++power) {
+      damperRampPowers[power] = static_cast<float>(
+          std::pow(damperRampFactor, static_cast<double>(power)));
+    }
+
+    constexpr auto kRetireSeconds = 0.01;
+    retireGain.reset(sampleRate, kRetireSeconds);
+
+    prepareHammer(sampleRate);
+
+    constexpr auto kRenderCacheSeconds = 1.0;
+    renderCache.assign(
+        isRenderCacheEnabled
+            ? static_cast<size_t>(roundToInt(sampleRate * kRenderCacheSeconds))
+            : 0,
+        0.f);
+    renderCache.shrink_to_fit();
+    renderCacheValidLength = 0;
+    isPlayingFromCache = false;
+    isRecordingToCache = false;
+
     currentBufferPosition = 0;
-    isExcitationBufferReady = true;
+    allpassInput = 0.f;
+    allpassOutput = 0.f;
+    strikeCount = 0;
+    excitationFillPosition = stringTuning.delayLineSize;
+  }
+
+  /**
+   * Switches to `newTuning` if it is for the current sample rate. A render cache recorded with
+   * another loop no longer applies. Dampers are not part of what is cached.
+   */
+  void retuneString(const PianoMannStringTuning &newTuning) {
+    if (newTuning.sampleRate != getSampleRate()) {
+      return;
+    }
+    jassert(newTuning.delayLineSize <= static_cast<int>(delayLineBuffer.size()));
+    const auto isSameLoop =
+        newTuning.frequency == stringTuning.frequency &&
+        newTuning.weightedAverageFilter == stringTuning.weightedAverageFilter &&
+        newTuning.sustainLoopGain == stringTuning.sustainLoopGain;
+    stringTuning = newTuning;
+    if (!isSameLoop) {
+      renderCacheValidLength = 0;
+    }
   }
 
   /**
    * Create burst of "noise" seeding the Karplus-Strong feedback loop. Since this feeds the delay line,
    * it must be equal or smaller in length (preferably the same size).
+   *
+   * The delay line is only filled as far as the string has got, by `fillExcitation`, which spreads
+   * the cost of a strike over its first period.
    */
   void exciteBuffer() {
-    jassert(delayLineBuffer.size() >= excitationBuffer.size());
+    jassert(static_cast<int>(delayLineBuffer.size()) >= stringTuning.delayLineSize);
+    excitationFillPosition = 0;
+    excitationShapingState = 0.f;
+    isHammerInContact = isStrikeHammered && currentNoteVelocity > 0.f;
+    isInHammerAttack = isHammerInContact;
+    if (isStrikeHammered) {
+      // The string starts at rest, and the hammer at the string.
+      hammerPosition = 0.f;
+      hammerVelocity = currentNoteVelocity;
+      stringPosition = 0.f;
+      numHammerContactSamples = 0;
+      strikeHammerStiffness = hammerStiffness;
+      if (isStrikeVaried) {
+        strikeHammerStiffness *=
+            1.f + kHammerStiffnessVariation *
+                      PianoMannDspKernels::hashToSample(excitationKey);
+      }
+    } else if (isStrikeShaped) {
+      // The one-pole low-pass keeps white noise at `a / (2 - a)` of its
+      // power, which the gain makes up for so velocity alone sets the level.
+      excitationShapingFactor =
+          jmap(currentNoteVelocity, kSoftestExcitationShapingFactor, 1.f);
+      excitationGain = currentNoteVelocity *
+                       std::sqrt((2.f - excitationShapingFactor) /
+                                 excitationShapingFactor);
+    } else {
+      excitationGain = currentNoteVelocity;
+    }
+    // The strike writes each sample of the line before the loop reads it.
+    isDelayLineCompact = false;
+    // Always start from the same position so every strike is identical.
+    currentBufferPosition = 0;
+    allpassInput = 0.f;
+    allpassOutput = 0.f;
+  }
 
-    std::transform(excitationBuffer.begin(), excitationBuffer.end(),
-                   delayLineBuffer.begin(),
-                   [this](float sample) { return currentNoteVelocity * sample; });
+  /**
+   * Excites the delay line up to `endPosition`, which covers the string up to sample
+   * `endPosition - 1` of its first period.
+   */
+  void fillExcitation(int endPosition) {
+    endPosition = jmin(endPosition, stringTuning.delayLineSize);
+    if (excitationFillPosition >= endPosition) {
+      return;
+    }
+    auto *excitation = delayLineBuffer.data() + excitationFillPosition;
+    const auto numSamples = endPosition - excitationFillPosition;
+    if (isStrikeHammered) {
+      FloatVectorOperations::clear(excitation, numSamples);
+      excitationFillPosition = endPosition;
+      return;
+    }
+    if (isStrikeVaried) {
+      PianoMannDspKernels::getKernels().generateNoise(
+          excitationKey, static_cast<uint32>(excitationFillPosition),
+          excitation, numSamples);
+    } else {
+      FloatVectorOperations::copy(
+          excitation, excitationBuffer.data() + excitationFillPosition,
+          numSamples);
+    }
+    if (isStrikeShaped) {
+      for (auto index = 0; index < numSamples; ++index) {
+        excitationShapingState +=
+            excitationShapingFactor * (excitation[index] - excitationShapingState);
+        excitation[index] = excitationShapingState;
+      }
+    }
+    FloatVectorOperations::multiply(excitation, excitationGain, numSamples);
+    excitationFillPosition = endPosition;
+  }
+
+  /**
+   * Picks the `renderChunk` for the state of the damper and of the voice, and moves the damper
+   * along.
+   */
+  template <bool kIsHammerInContact>
+  void renderChunkFor(int numSamples) {
+    if (isDamperRamping) {
+      if (isRetiring) {
+        renderChunk<true, true, kIsHammerInContact>(numSamples);
+      } else {
+        renderChunk<true, false, kIsHammerInContact>(numSamples);
+      }
+      advanceDamperRamp(numSamples);
+    } else if (isRetiring) {
+      renderChunk<false, true, kIsHammerInContact>(numSamples);
+    } else {
+      renderChunk<false, false, kIsHammerInContact>(numSamples);
+    }
+  }
+
+  /**
+   * Renders a chunk of at most `kChunkSize` samples. A settled string runs through
+   * `PianoMannDspKernels`. While the damper moves, the per-sample loop coefficients are worked
+   * out for the whole chunk up front, which vectorizes, and then used by the string update.
+   * Only the attack pays for the hammer.
+   *
+   * With a compact delay line, a settled string is compacted once its first period is over, on a
+   * chunk boundary counted from the strike. Rounding the line then happens at the same sample
+   * however blocks are split. Everything else expands it again, which is exact.
+   */
+  template <bool kIsDamperRamping, bool kIsRetiring, bool kIsHammerInContact>
+  void renderChunk(int numSamples) {
+    jassert(numSamples <= kChunkSize);
+    if constexpr (!kIsDamperRamping && !kIsRetiring && !kIsHammerInContact) {
+      if (!compactDelayLineBuffer.empty() && !isDelayLineCompact &&
+          noteSampleIndex >= stringTuning.delayLineSize &&
+          noteSampleIndex % kChunkSize == 0) {
+        compactDelayLine();
+      }
+      if (isDelayLineCompact) {
+        renderCompactChunk(numSamples);
+        return;
+      }
+      PianoMannDspKernels::StringLoop loop;
+      loop.delayLine = delayLineBuffer.data();
+      loop.delayLineSize = stringTuning.delayLineSize;
+      loop.position = currentBufferPosition;
+      loop.allpassCoefficient = stringTuning.allpassCoefficient;
+      loop.allpassInput = allpassInput;
+      loop.allpassOutput = allpassOutput;
+      PianoMannDspKernels::getKernels().renderString(
+          loop, getFilterFactorForDamping(damperTarget),
+          getLoopGainForDamping(damperTarget), chunkOutput.data(), numSamples);
+      currentBufferPosition = loop.position;
+      allpassInput = loop.allpassInput;
+      allpassOutput = loop.allpassOutput;
+      return;
+    }
+
+    expandDelayLine();
+    float filterFactors[kChunkSize], decays[kChunkSize];
+    if constexpr (kIsDamperRamping) {
+      const auto rampDistance = damperRampDistance * damperRampScale;
+      for (auto sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex) {
+        const auto damping =
+            damperTarget +
+            rampDistance *
+                damperRampPowers[static_cast<size_t>(damperRampPhase +
+                                                     sampleIndex + 1)];
+        filterFactors[sampleIndex] = getFilterFactorForDamping(damping);
+        decays[sampleIndex] = getLoopGainForDamping(damping);
+      }
+    }
+    const auto settledFilterFactor = getFilterFactorForDamping(damperTarget);
+    const auto settledDecay = getLoopGainForDamping(damperTarget);
+
+    auto *output = chunkOutput.data();
+    const auto delayLineSize = stringTuning.delayLineSize;
+    auto *delayLine = delayLineBuffer.data();
+    auto bufferPosition = currentBufferPosition;
+    const auto allpassCoefficient = stringTuning.allpassCoefficient;
+    auto chunkAllpassInput = allpassInput, chunkAllpassOutput = allpassOutput;
+    for (auto sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex) {
+      const auto nextBufferPosition =
+          bufferPosition + 1 == delayLineSize ? 0 : bufferPosition + 1;
+
+      float filterFactor, decay;
+      if constexpr (kIsDamperRamping) {
+        filterFactor = filterFactors[sampleIndex];
+        decay = decays[sampleIndex];
+      } else {
+        filterFactor = settledFilterFactor;
+        decay = settledDecay;
+      }
+
+      // The recurrence of the string kernels, though not their rounding: the
+      // FMA variants round less often. Chunks take the same path however
+      // blocks are split, so this only makes ISAs differ in the last bits.
+      const auto delayed = delayLine[nextBufferPosition];
+      chunkAllpassOutput =
+          allpassCoefficient * (delayed - chunkAllpassOutput) + chunkAllpassInput;
+      chunkAllpassInput = delayed;
+      const auto weightedNextDelaySample = filterFactor * chunkAllpassOutput;
+      const auto weightCurrentDelaySample =
+          (1 - filterFactor) * delayLine[bufferPosition];
+      delayLine[nextBufferPosition] =
+          decay * (weightedNextDelaySample + weightCurrentDelaySample);
+
+      output[sampleIndex] = delayLine[bufferPosition];
+      if constexpr (kIsHammerInContact) {
+        if (isHammerInContact) {
+          pushWithHammer(nextBufferPosition, output[sampleIndex]);
+        }
+      }
+      if constexpr (kIsRetiring) {
+        output[sampleIndex] *= retireGain.getNextValue();
+      }
+
+      bufferPosition = nextBufferPosition;
+    }
+    currentBufferPosition = bufferPosition;
+    allpassInput = chunkAllpassInput;
+    allpassOutput = chunkAllpassOutput;
+  }
+
+  void renderCompactChunk(int numSamples) {
+    PianoMannDspKernels::CompactStringLoop loop;
+    loop.delayLine = compactDelayLineBuffer.data();
+    loop.delayLineSize = stringTuning.delayLineSize;
+    loop.position = currentBufferPosition;
+    loop.allpassCoefficient = stringTuning.allpassCoefficient;
+    loop.allpassInput = allpassInput;
+    loop.allpassOutput = allpassOutput;
+    PianoMannDspKernels::getKernels().renderCompactString(
+        loop, getFilterFactorForDamping(damperTarget),
+        getLoopGainForDamping(damperTarget), chunkOutput.data(), numSamples);
+    currentBufferPosition = loop.position;
+    allpassInput = loop.allpassInput;
+    allpassOutput = loop.allpassOutput;
+  }
+
+  void compactDelayLine() {
+    jassert(!isDelayLineCompact);
+    PianoMannDspKernels::getKernels().floatsToHalves(
+        delayLineBuffer.data(), compactDelayLineBuffer.data(),
+        stringTuning.delayLineSize);
+    isDelayLineCompact = true;
+  }
+
+  void expandDelayLine() {
+    if (isDelayLineCompact) {
+      PianoMannDspKernels::getKernels().halvesToFloats(
+          compactDelayLineBuffer.data(), delayLineBuffer.data(),
+          stringTuning.delayLineSize);
+      isDelayLineCompact = false;
+    }
+  }
+
+  /**
+   * Works out the felt of the hammer for this note. The felt pushes back with `K * c^p` for a
+   * compression `c`, and is harder and shorter in contact up the keyboard. For a hammer of unit mass and
+   * speed on a rigid string, the peak compression `c` and the contact time `T` are related by
+   * `T = 2 * I * c` where `I = sqrt(pi) * Gamma(1 + 1/(p+1)) / Gamma(1/2 + 1/(p+1))`, so the
+   * stiffness is solved from the contact time wanted at full velocity. The force is normalised
+   * by its peak.
+   */
+  void prepareHammer(double sampleRate) {
+    const auto keyboardPosition =
+        static_cast<double>(params.midiNoteNumber - PianoMannSound::kMinNote) /
+        (PianoMannSound::kMaxNote - PianoMannSound::kMinNote);
+    const auto exponent = 2.3 + 0.7 * keyboardPosition;
+    const auto contactSeconds = 3.0e-3 * std::pow(0.25 / 3.0, keyboardPosition);
+    const auto integral = std::sqrt(MathConstants<double>::pi) *
+                          std::tgamma(1.0 + 1.0 / (exponent + 1.0)) /
+                          std::tgamma(0.5 + 1.0 / (exponent + 1.0));
+    const auto peakCompression = contactSeconds / (2.0 * integral);
+    const auto stiffness =
+        (exponent + 1.0) / (2.0 * std::pow(peakCompression, exponent + 1.0));
+
+    hammerExponent = static_cast<float>(exponent);
+    hammerStiffness = static_cast<float>(stiffness);
+    hammerForceGain = static_cast<float>(
+        1.0 / (stiffness * std::pow(peakCompression, exponent)));
+    hammerTimeStep = static_cast<float>(1.0 / sampleRate);
+    maxHammerContactSamples =
+        roundToInt(sampleRate * kMaxHammerContactSeconds);
+    isHammerInContact = false;
+    isInHammerAttack = false;
+  }
+
+  /**
+   * Advances the hammer by a sample, given the string output at the hammer. The force goes into
+   * the loop just ahead of the string, and again inverted as it reflects off the near end of the
+   * string. This leaves no offset in the loop, and dips the partials with a node at the strike
+   * position, as on a real piano.
+   */
+  void pushWithHammer(int nextBufferPosition, float stringOutput) {
+    const auto compression = hammerPosition - stringPosition;
+    const auto force =
+        compression > 0.f
+            ? strikeHammerStiffness * std::pow(compression, hammerExponent)
+            : 0.f;
+    const auto stringVelocity = kStringYield * stringOutput;
+    stringPosition += stringVelocity * hammerTimeStep;
+    hammerVelocity -= force * hammerTimeStep;
+    hammerPosition += hammerVelocity * hammerTimeStep;
+
+    const auto delayLineSize = stringTuning.delayLineSize;
+    const auto directPosition =
+        nextBufferPosition + 1 == delayLineSize ? 0 : nextBufferPosition + 1;
+    const auto reflectedPosition =
+        (directPosition + stringTuning.hammerReflectionOffset) % delayLineSize;
+    const auto injection = hammerForceGain * force;
+    delayLineBuffer[static_cast<size_t>(directPosition)] += injection;
+    delayLineBuffer[static_cast<size_t>(reflectedPosition)] -= injection;
+
+    ++numHammerContactSamples;
+    if ((compression <= 0.f && hammerVelocity <= stringVelocity) ||
+        numHammerContactSamples >= maxHammerContactSamples) {
+      isHammerInContact = false;
+    }
+  }
+
+  /**
+   * Adds the chunk just rendered into `chunkOutput` to the output, tracks its level and records
+   * it to the render cache.
+   */
+  void emitChunk(AudioBuffer<float> &outputBuffer, int startSample,
+                 int numSamples) {
+    const auto *output = chunkOutput.data();
+
+    const auto peak = PianoMannDspKernels::getKernels().addToChannels(
+        output, outputBuffer.getArrayOfWritePointers(),
+        outputBuffer.getNumChannels(), startSample, numSamples);
+    windowPeakLevel = jmax(windowPeakLevel, peak);
+
+    if (isRecordingToCache) {
+      // The recording is only valid for as long as the string was free.
+      if (isDamperRamping || damperTarget != 0.f || isRetiring) {
+        isRecordingToCache = false;
+        return;
+      }
+      const auto numRecordedSamples = jmin(
+          numSamples, static_cast<int>(renderCache.size()) - noteSampleIndex);
+      FloatVectorOperations::copyWithMultiply(
+          renderCache.data() + noteSampleIndex, output,
+          1.f / currentNoteVelocity, numRecordedSamples);
+      renderCacheValidLength = noteSampleIndex + numRecordedSamples;
+      isRecordingToCache =
+          renderCacheValidLength < static_cast<int>(renderCache.size());
+    }
+  }
+
+  /**
+   * Cached playback stops one sample short of the recording: the string state at a given sample
+   * includes the output of that sample, see `handOffToLiveSynthesis`.
+   */
+  int getRenderCacheHandOffIndex() const { return renderCacheValidLength - 1; }
+
+  /**
+   * Calls `visit` with every member that changes while a note plays, see `writeState`.
+   */
+  template <typename Voice, typename Visitor>
+  static void visitPlayingState(Voice &voice, Visitor &&visit) {
+    visit(voice.currentNoteVelocity);
+    visit(voice.isNoteHeld);
+    visit(voice.noteSampleIndex);
+    visit(voice.currentBufferPosition);
+    visit(voice.allpassInput);
+    visit(voice.allpassOutput);
+    visit(voice.isStrikeVaried);
+    visit(voice.isStrikeShaped);
+    visit(voice.isStrikeHammered);
+    visit(voice.excitationKey);
+    visit(voice.excitationFillPosition);
+    visit(voice.excitationGain);
+    visit(voice.excitationShapingFactor);
+    visit(voice.excitationShapingState);
+    visit(voice.isHammerInContact);
+    visit(voice.isInHammerAttack);
+    visit(voice.hammerPosition);
+    visit(voice.hammerVelocity);
+    visit(voice.stringPosition);
+    visit(voice.strikeHammerStiffness);
+    visit(voice.numHammerContactSamples);
+    visit(voice.damperTarget);
+    visit(voice.isDamperRamping);
+    visit(voice.damperRampDistance);
+    visit(voice.damperRampScale);
+    visit(voice.damperRampPhase);
+    visit(voice.isPlayingFromCache);
+    visit(voice.isRecordingToCache);
+    visit(voice.isRetiring);
+    visit(voice.retireGain);
+    visit(voice.peakLevel);
+    visit(voice.windowPeakLevel);
+    visit(voice.windowNumSamples);
+  }
+
+  /**
+   * Values are written as their bytes in memory, since the state never leaves the process.
+   */
+  template <typename... Values>
+  static void writeValues(OutputStream &output, const Values &... values) {
+    static_assert((std::is_trivially_copyable<Values>::value && ...),
+                  "Only plain values can be written as bytes");
+    (output.write(&values, sizeof(Values)), ...);
+  }
+  template <typename... Values>
+  static void readValues(InputStream &input, Values &... values) {
+    static_assert((std::is_trivially_copyable<Values>::value && ...),
+                  "Only plain values can be read as bytes");
+    (input.read(&values, static_cast<int>(sizeof(Values))), ...);
+  }
+
+  /**
+   * Switches from cached playback to live synthesis. The delay line at sample `n` holds the last
+   * period of output, `y[n-N+1] .. y[n]`, each at its position modulo the delay line size `N`.
+   * Positions not yet written in the first period still hold the excitation. The allpass last
+   * read what the loop held a period before `y[n]`, and its output is what the filter turned into
+   * `y[n]` from `y[n-1]`.
+   */
+  void handOffToLiveSynthesis() {
+    PIANOMANN_TRACE_SCOPE_ARG("handOffToLiveSynthesis", "note",
+                              params.midiNoteNumber);
+    jassert(isPlayingFromCache);
+    jassert(noteSampleIndex <= getRenderCacheHandOffIndex());
+    const auto delayLineSize = stringTuning.delayLineSize;
+
+    exciteBuffer();
+    fillExcitation(delayLineSize);
+    if (noteSampleIndex > 0) {
+      const auto getOutput = [this](int sampleIndex) {
+        return currentNoteVelocity * renderCache[static_cast<size_t>(sampleIndex)];
+      };
+      allpassInput = noteSampleIndex < delayLineSize
+                         ? delayLineBuffer[static_cast<size_t>(noteSampleIndex)]
+                         : getOutput(noteSampleIndex - delayLineSize);
+      const auto weightedAverageFilter = stringTuning.weightedAverageFilter;
+      allpassOutput = (getOutput(noteSampleIndex) / stringTuning.sustainLoopGain -
+                       (1 - weightedAverageFilter) * getOutput(noteSampleIndex - 1)) /
+                      weightedAverageFilter;
+    }
+    for (auto sampleIndex = jmax(0, noteSampleIndex - delayLineSize + 1);
+         sampleIndex <= noteSampleIndex; ++sampleIndex) {
+      delayLineBuffer[static_cast<size_t>(sampleIndex % delayLineSize)] =
+          currentNoteVelocity * renderCache[static_cast<size_t>(sampleIndex)];
+    }
+    currentBufferPosition = noteSampleIndex % delayLineSize;
+
+    isPlayingFromCache = false;
+    // Keep extending the recording if this strike got to its end unmodulated.
+    isRecordingToCache = noteSampleIndex == getRenderCacheHandOffIndex() &&
+                         !isDamperRamping && damperTarget == 0.f &&
+                         !isRetiring;
+  }
+
+  /**
+   * A damper both shortens the decay and dulls the tone by pulling the averaging filter towards
+   * its strongest low-pass setting.
+   */
+  float getFilterFactorForDamping(float damping) const {
+    return stringTuning.weightedAverageFilter +
+           damping * (0.5f - stringTuning.weightedAverageFilter);
+  }
+  float getLoopGainForDamping(float damping) const {
+    return stringTuning.sustainLoopGain *
+           (1.f - damping * (1.f - stringTuning.damperLoopGain));
+  }
+
+  float getCurrentDamperEngagement() const {
+    if (!isDamperRamping) {
+      return damperTarget;
+    }
+    return damperTarget +
+           damperRampDistance * damperRampScale *
+               damperRampPowers[static_cast<size_t>(damperRampPhase)];
+  }
+
+  /**
+   * Starts ramping the damper towards `newTarget` from wherever it is now.
+   */
+  void setDamperTarget(float newTarget) {
+    if (newTarget == damperTarget) {
+      return;
+    }
+    damperRampDistance = getCurrentDamperEngagement() - newTarget;
+    damperTarget = newTarget;
+    damperRampScale = 1.f;
+    damperRampPhase = 0;
+    isDamperRamping = true;
+  }
+
+  void advanceDamperRamp(int numSamples) {
+    damperRampPhase += numSamples;
+    if (damperRampPhase < kChunkSize) {
+      return;
+    }
+    jassert(damperRampPhase == kChunkSize);
+    damperRampPhase = 0;
+    damperRampScale *= damperRampPowers[kChunkSize];
+
+    constexpr auto kSettledDistance = 1.0e-4f;
+    if (std::abs(damperRampDistance * damperRampScale) < kSettledDistance) {
+      isDamperRamping = false;
+    }
+  }
+
+  /**
+   * The dampers are lifted while the key is down or the string is latched by the sostenuto pedal.
+   * Otherwise they follow the sustain pedal.
+   */
+  float getTargetDamperEngagement() const {
+    if (!stringTuning.hasDamper) {
+      return 0.f;
+    }
+    if ((isNoteHeld && isKeyDown()) || isSostenutoPedalDown()) {
+      return 0.f;
+    }
+    return params.pedalState->getDamperEngagement();
   }
 
   /**
@@ -254,22 +1133,146 @@ private:
    */
   float currentNoteVelocity = 0.f;
 
-  bool isExcitationBufferReady = false;
+  /**
+   * Whether the string has been built for the current sample rate. Settings read while building
+   * it are atomic since it may be built on a background thread.
+   */
+  std::atomic<bool> isStringPrepared{false};
+  std::atomic<int64> excitationSeed{0};
   std::vector<float> excitationBuffer, delayLineBuffer;
+  /**
+   * The delay line in half precision, see `setCompactDelayLineEnabled`. Only one of the two lines
+   * is current at a time.
+   */
+  std::atomic<bool> isCompactDelayLineEnabled{false};
+  std::vector<uint16> compactDelayLineBuffer;
+  bool isDelayLineCompact = false;
   /**
    * The delay line buffer is a feedback loop and so the array behaves as a ring buffer. This tracks
    * the current position in the ring buffer.
    */
   int currentBufferPosition = 0;
 
+  /**
+   * The length of the string in use and the fractional delay that tunes it, see `tuneString`.
+   * `nextStringTuning` waits for the next strike, see `setNextStringTuning`.
+   */
+  PianoMannStringTuning stringTuning;
+  PianoMannStringTuning nextStringTuning;
+  bool hasNextStringTuning = false;
+  float allpassInput = 0.f;
+  float allpassOutput = 0.f;
+
+  /**
+   * How the current strike excites the string, see `exciteBuffer`. `excitationFillPosition` is
+   * how far into the delay line the excitation has been written.
+   */
+  std::atomic<bool> isStrikeVariationEnabled{false};
+  std::atomic<bool> isVelocityShapingEnabled{false};
+  bool isStrikeVaried = false;
+  bool isStrikeShaped = false;
+  uint32 strikeCount = 0;
+  uint32 excitationKey = 0;
+  int excitationFillPosition = 0;
+  float excitationGain = 0.f;
+  float excitationShapingFactor = 1.f;
+  float excitationShapingState = 0.f;
+  /**
+   * The low-pass coefficient shaping the noise of the softest strike. Full velocity is unshaped.
+   */
+  static constexpr float kSoftestExcitationShapingFactor = 0.2f;
+
+  /**
+   * The hammer, see `prepareHammer` and `pushWithHammer`. Positions and speeds are normalised so
+   * the hammer hits at unit speed at full velocity.
+   */
+  std::atomic<bool> isHammerModelEnabled{false};
+  bool isStrikeHammered = false;
+  bool isHammerInContact = false;
+  /**
+   * The attack lasts from the strike to the end of the chunk in which the hammer leaves the
+   * string.
+   */
+  bool isInHammerAttack = false;
+  int64 numHammeredStrikes = 0;
+  int64 numAttackSamples = 0;
+  float hammerPosition = 0.f;
+  float hammerVelocity = 0.f;
+  float stringPosition = 0.f;
+  float hammerExponent = 2.5f;
+  float hammerStiffness = 0.f;
+  float strikeHammerStiffness = 0.f;
+  float hammerForceGain = 0.f;
+  float hammerTimeStep = 0.f;
+  int numHammerContactSamples = 0;
+  int maxHammerContactSamples = 0;
+  /**
+   * Where along the string the hammer strikes, as a fraction of its length.
+   */
+  static constexpr float kHammerStrikePosition = 1.f / 8.f;
+  /**
+   * How fast the string at the hammer moves relative to the loop's output.
+   */
+  static constexpr float kStringYield = 0.1f;
+  static constexpr float kHammerStiffnessVariation = 0.05f;
+  /**
+   * A bound on the attack in case the hammer never leaves the string.
+   */
+  static constexpr double kMaxHammerContactSeconds = 0.02;
+
   /**
    * Whether or not the currently playing note is held down right now. Upon release, this is `false`
    * but there might still be some sound created after release.
    */
   bool isNoteHeld = false;
   /**
-   * The current value of the decay that starts after a note's release. A value of (approximately) 0 means that the decay
-   * is (mostly) complete. A value of 1 is used to initialize the tail off.
+   * The number of samples rendered at a time. Loop coefficients are computed a chunk at a time.
+   */
+  static constexpr int kChunkSize = 32;
+
+  /**
+   * How firmly the damper rests on the string. It approaches `damperTarget` exponentially to
+   * avoid clicks when pedalling, as `damperTarget + damperRampDistance * k^n` where `n` counts
+   * samples since the target changed. `k^n` is kept as `damperRampScale` for whole chunks times
+   * `damperRampPowers` within the chunk, so it is exactly the same however blocks are split.
+   */
+  float damperTarget = 0.f;
+  bool isDamperRamping = false;
+  float damperRampDistance = 0.f;
+  float damperRampScale = 1.f;
+  int damperRampPhase = 0;
+  std::array<float, kChunkSize + 1> damperRampPowers{};
+
+  /**
+   * The output of the chunk being rendered.
+   */
+  std::array<float, kChunkSize> chunkOutput{};
+
+  /**
+   * The number of samples since the strike.
+   */
+  int noteSampleIndex = 0;
+
+  /**
+   * The waveform of an unmodulated strike at unit velocity, see `setRenderCacheEnabled`.
+   */
+  std::atomic<bool> isRenderCacheEnabled{false};
+  std::vector<float> renderCache;
+  int renderCacheValidLength = 0;
+  bool isPlayingFromCache = false;
+  bool isRecordingToCache = false;
+
+  /**
+   * Whether this voice is being faded out to free up CPU, see `retire`.
+   */
+  bool isRetiring = false;
+  LinearSmoothedValue<float> retireGain;
+
+  /**
+   * Output level tracking used to retire the voice once it is inaudible.
    */
-  float tailOff = 0.f;
+  std::atomic<float> silenceThreshold{0.0005f};
+  float peakLevel = 0.f;
+  float windowPeakLevel = 0.f;
+  int windowNumSamples = 0;
 };
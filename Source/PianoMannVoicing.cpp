@@ -0,0 +1,471 @@
+/*
+  ==============================================================================
+
+    PianoMannVoicing.cpp
+    Created: 20 Oct 2026 12:04:16am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannVoicing.h"
+#include "PianoMannButterworthLowPassFilter.h"
+#include "PianoMannVoice.h"
+#include <cmath>
+#include <cstring>
+#include <map>
+
+namespace {
+constexpr char kMagic[4] = {'P', 'M', 'V', 'O'};
+constexpr int32 kVersion = 1;
+constexpr size_t kHeaderSize = 32;
+constexpr size_t kNoteSize = 3 * sizeof(float);
+constexpr size_t kTableHeaderSize = 16;
+constexpr size_t kTableSize =
+    kTableHeaderSize +
+    5 * PianoMannVoicing::kMaxTableSections * sizeof(float);
+static_assert((kHeaderSize + PianoMannVoicing::kNumNotes * kNoteSize) % 8 == 0,
+              "Tables must stay 8-byte aligned");
+
+/**
+ * Little-endian is native on every platform the plugin ships for.
+ */
+template <typename T> T read(const char *source) {
+  T value;
+  std::memcpy(&value, source, sizeof(T));
+  return value;
+}
+
+bool isValidOrder(int order) {
+  return order >= 1 && (order + 1) / 2 <= PianoMannVoicing::kMaxTableSections;
+}
+
+/**
+ * Strings taken over from the render cache divide by both the filter weight and the sustain, see
+ * `PianoMannVoice`, so neither may be 0 or so small that dividing by it overflows.
+ */
+Result checkNote(int midiNoteNumber, const PianoMannVoicing::Note &note) {
+  const auto isValid =
+      std::isnormal(note.weightedAverageFilter) &&
+      note.weightedAverageFilter > 0.f && note.weightedAverageFilter <= 1.f &&
+      std::isnormal(note.sustain) && note.sustain > 0.f &&
+      note.sustain < 1.f && std::isfinite(note.damperDecaySeconds) &&
+      note.damperDecaySeconds >= 0.f;
+  return isValid ? Result::ok()
+                 : Result::fail("Note " + String(midiNoteNumber) +
+                                " is out of range");
+}
+
+Result checkPostFilter(const PianoMannVoicing::PostFilter &postFilter) {
+  constexpr auto kMaxCutoffFrequency = 20000.f;
+  if (!std::isfinite(postFilter.cutoffFrequency) ||
+      postFilter.cutoffFrequency <= 0.f ||
+      postFilter.cutoffFrequency > kMaxCutoffFrequency) {
+    return Result::fail("The post filter cut-off is out of range");
+  }
+  if (!isValidOrder(postFilter.fullOrder) ||
+      !isValidOrder(postFilter.economyOrder)) {
+    return Result::fail("The post filter orders are out of range");
+  }
+  return Result::ok();
+}
+
+/**
+ * Voicings are shared by file, for as long as any instance uses them.
+ */
+struct SharedVoicings {
+  CriticalSection lock;
+  std::map<String, std::weak_ptr<const PianoMannVoicing>> voicings;
+};
+SharedVoicings &getSharedVoicings() {
+  static SharedVoicings sharedVoicings;
+  return sharedVoicings;
+}
+} // namespace
+
+std::shared_ptr<const PianoMannVoicing> PianoMannVoicing::getBuiltIn() {
+  static const auto builtIn = [] {
+    std::shared_ptr<const PianoMannVoicing> voicing;
+    const auto result = create(describeBuiltIn(), voicing);
+    jassert(result.wasOk());
+    ignoreUnused(result);
+    return voicing;
+  }();
+  return builtIn;
+}
+
+PianoMannVoicing::Description PianoMannVoicing::describeBuiltIn() {
+  Description description;
+  for (auto midiNoteNumber = 0; midiNoteNumber < kNumNotes; ++midiNoteNumber) {
+    auto &note = description.notes[static_cast<size_t>(midiNoteNumber)];
+    note.weightedAverageFilter = midiNoteNumber <= MidiOctaves::kOctave_0 + 6
+                                     ? 0.43f
+                                     : midiNoteNumber >= MidiOctaves::kOctave_5
+                                           ? 0.85f
+                                           : 0.7f;
+    note.sustain = midiNoteNumber >= MidiOctaves::kOctave_5 ? 0.9992f : 0.997f;
+    // As on a real piano, the top of the keyboard is left undamped, and
+    // heavier bass strings take longer to stop.
+    note.damperDecaySeconds = midiNoteNumber >= MidiOctaves::kOctave_6 - 3
+                                  ? 0.f
+                                  : midiNoteNumber < MidiOctaves::kOctave_2
+                                        ? 0.4f
+                                        : midiNoteNumber < MidiOctaves::kOctave_4
+                                              ? 0.25f
+                                              : 0.15f;
+  }
+  return description;
+}
+
+Result PianoMannVoicing::load(const File &file,
+                              std::shared_ptr<const PianoMannVoicing> &result) {
+  if (!file.existsAsFile()) {
+    return Result::fail("Cannot find " + file.getFullPathName());
+  }
+  const auto modificationTime = file.getLastModificationTime();
+
+  auto &sharedVoicings = getSharedVoicings();
+  const ScopedLock sl(sharedVoicings.lock);
+  auto &sharedVoicing = sharedVoicings.voicings[file.getFullPathName()];
+  if (auto voicing = sharedVoicing.lock()) {
+    if (voicing->modificationTime == modificationTime) {
+      result = std::move(voicing);
+      return Result::ok();
+    }
+  }
+
+  std::shared_ptr<PianoMannVoicing> voicing(new PianoMannVoicing());
+  voicing->mappedFile =
+      std::make_unique<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+  if (voicing->mappedFile->getData() == nullptr) {
+    return Result::fail("Cannot read " + file.getFullPathName());
+  }
+  const auto imageResult = voicing->useImage(voicing->mappedFile->getData(),
+                                             voicing->mappedFile->getSize());
+  if (imageResult.failed()) {
+    return Result::fail(file.getFileName() + ": " +
+                        imageResult.getErrorMessage());
+  }
+  voicing->file = file;
+  voicing->modificationTime = modificationTime;
+  sharedVoicing = voicing;
+  result = std::move(voicing);
+  return Result::ok();
+}
+
+Result PianoMannVoicing::create(const Description &description,
+                                std::shared_ptr<const PianoMannVoicing> &result,
+                                const Array<double> &tableSampleRates) {
+  std::shared_ptr<PianoMannVoicing> voicing(new PianoMannVoicing());
+  voicing->ownedImage = createImage(description, tableSampleRates);
+  const auto imageResult = voicing->useImage(voicing->ownedImage.getData(),
+                                             voicing->ownedImage.getSize());
+  if (imageResult.failed()) {
+    return imageResult;
+  }
+  result = std::move(voicing);
+  return Result::ok();
+}
+
+Result PianoMannVoicing::write(const Description &description,
+                               const File &file,
+                               const Array<double> &tableSampleRates) {
+  std::shared_ptr<const PianoMannVoicing> voicing;
+  const auto createResult = create(description, voicing, tableSampleRates);
+  if (createResult.failed()) {
+    return createResult;
+  }
+  if (!file.getParentDirectory().createDirectory()) {
+    return Result::fail("Cannot create " +
+                        file.getParentDirectory().getFullPathName());
+  }
+
+  TemporaryFile temporaryFile(file);
+  {
+    FileOutputStream output(temporaryFile.getFile());
+    if (output.failedToOpen()) {
+      return output.getStatus();
+    }
+    output.write(voicing->ownedImage.getData(), voicing->ownedImage.getSize());
+    output.flush();
+    if (output.getStatus().failed()) {
+      return output.getStatus();
+    }
+  }
+  return temporaryFile.overwriteTargetFileWithTemporary()
+             ? Result::ok()
+             : Result::fail("Cannot write " + file.getFullPathName());
+}
+
+String PianoMannVoicing::toJson(const Description &description) {
+  // Floats go through their shortest decimal form, so 0.7 reads as 0.7.
+  const auto toVar = [](float value) {
+    return var(String(value).getDoubleValue());
+  };
+
+  auto *postFilter = new DynamicObject();
+  postFilter->setProperty("cutoffFrequency",
+                          toVar(description.postFilter.cutoffFrequency));
+  postFilter->setProperty("fullOrder", description.postFilter.fullOrder);
+  postFilter->setProperty("economyOrder", description.postFilter.economyOrder);
+
+  var notes;
+  for (auto midiNoteNumber = PianoMannSound::kMinNote;
+       midiNoteNumber <= PianoMannSound::kMaxNote; ++midiNoteNumber) {
+    const auto &note = description.notes[static_cast<size_t>(midiNoteNumber)];
+    auto *noteObject = new DynamicObject();
+    noteObject->setProperty("note", midiNoteNumber);
+    noteObject->setProperty("weightedAverageFilter",
+                            toVar(note.weightedAverageFilter));
+    noteObject->setProperty("sustain", toVar(note.sustain));
+    noteObject->setProperty("damperDecaySeconds",
+                            toVar(note.damperDecaySeconds));
+    notes.append(var(noteObject));
+  }
+
+  auto *voicing = new DynamicObject();
+  voicing->setProperty("version", kVersion);
+  voicing->setProperty("postFilter", var(postFilter));
+  voicing->setProperty("notes", notes);
+  return JSON::toString(var(voicing));
+}
+
+Result PianoMannVoicing::parseJson(const String &json, Description &result) {
+  var parsed;
+  const auto parseResult = JSON::parse(json, parsed);
+  if (parseResult.failed()) {
+    return parseResult;
+  }
+  if (!parsed.isObject()) {
+    return Result::fail("A voicing must be a JSON object");
+  }
+  if (parsed.hasProperty("version") &&
+      static_cast<int>(parsed["version"]) > kVersion) {
+    return Result::fail("The voicing is from a newer version of PianoMann");
+  }
+
+  auto description = describeBuiltIn();
+  const auto readFloat = [](const var &object, const Identifier &name,
+                            float &value) {
+    if (object.hasProperty(name)) {
+      value = static_cast<float>(static_cast<double>(object[name]));
+    }
+  };
+  const auto readInt = [](const var &object, const Identifier &name,
+                          int &value) {
+    if (object.hasProperty(name)) {
+      value = static_cast<int>(object[name]);
+    }
+  };
+
+  const auto &postFilter = parsed["postFilter"];
+  readFloat(postFilter, "cutoffFrequency",
+            description.postFilter.cutoffFrequency);
+  readInt(postFilter, "fullOrder", description.postFilter.fullOrder);
+  readInt(postFilter, "economyOrder", description.postFilter.economyOrder);
+
+  if (const auto *notes = parsed["notes"].getArray()) {
+    for (const auto &noteObject : *notes) {
+      const auto midiNoteNumber = static_cast<int>(noteObject["note"]);
+      if (!noteObject.hasProperty("note") ||
+          !isPositiveAndBelow(midiNoteNumber, kNumNotes)) {
+        return Result::fail("Every note needs a MIDI note number");
+      }
+      auto &note = description.notes[static_cast<size_t>(midiNoteNumber)];
+      readFloat(noteObject, "weightedAverageFilter", note.weightedAverageFilter);
+      readFloat(noteObject, "sustain", note.sustain);
+      readFloat(noteObject, "damperDecaySeconds", note.damperDecaySeconds);
+    }
+  }
+
+  // Values are checked as the voicing is made, but a mistake is easier to
+  // find by the line it is on.
+  for (auto midiNoteNumber = 0; midiNoteNumber < kNumNotes; ++midiNoteNumber) {
+    const auto noteResult = checkNote(
+        midiNoteNumber, description.notes[static_cast<size_t>(midiNoteNumber)]);
+    if (noteResult.failed()) {
+      return noteResult;
+    }
+  }
+  const auto postFilterResult = checkPostFilter(description.postFilter);
+  if (postFilterResult.failed()) {
+    return postFilterResult;
+  }
+  result = description;
+  return Result::ok();
+}
+
+PianoMannVoicing::Description PianoMannVoicing::describe() const {
+  Description description;
+  for (auto midiNoteNumber = 0; midiNoteNumber < kNumNotes; ++midiNoteNumber) {
+    description.notes[static_cast<size_t>(midiNoteNumber)] =
+        getNote(midiNoteNumber);
+  }
+  description.postFilter = postFilter;
+  return description;
+}
+
+PianoMannDspKernels::BiquadCascade
+PianoMannVoicing::getPostFilterCascade(double sampleRate,
+                                       bool isFullOrder) const {
+  const auto order =
+      isFullOrder ? postFilter.fullOrder : postFilter.economyOrder;
+  for (auto tableIndex = 0; tableIndex < numTables; ++tableIndex) {
+    const auto *table = tables + static_cast<size_t>(tableIndex) * kTableSize;
+    if (read<double>(table) != sampleRate || read<int32>(table + 8) != order) {
+      continue;
+    }
+    PianoMannDspKernels::BiquadCascade cascade;
+    cascade.numSections = read<int32>(table + 12);
+    const auto *coefficients =
+        reinterpret_cast<const float *>(table + kTableHeaderSize);
+    for (auto section = 0; section < cascade.numSections; ++section) {
+      const auto *sectionCoefficients = coefficients + 5 * section;
+      cascade.b0[section] = sectionCoefficients[0];
+      cascade.b1[section] = sectionCoefficients[1];
+      cascade.b2[section] = sectionCoefficients[2];
+      cascade.a1[section] = sectionCoefficients[3];
+      cascade.a2[section] = sectionCoefficients[4];
+    }
+    return cascade;
+  }
+  // The design needs the cut-off below Nyquist, which only low sample rates
+  // get near.
+  return PianoMannButterworthLowPassFilter::design(
+      jmin(postFilter.cutoffFrequency, static_cast<float>(0.45 * sampleRate)),
+      sampleRate, order);
+}
+
+Result PianoMannVoicing::useImage(const void *imageData, size_t imageSize) {
+  const auto *data = static_cast<const char *>(imageData);
+  if (data == nullptr || imageSize < kHeaderSize ||
+      std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    return Result::fail("Not a voicing file");
+  }
+  if (read<int32>(data + 4) != kVersion) {
+    return Result::fail("Unsupported voicing version " +
+                        String(read<int32>(data + 4)));
+  }
+  const auto numNotes = read<int32>(data + 8);
+  postFilter.cutoffFrequency = read<float>(data + 12);
+  postFilter.fullOrder = read<int32>(data + 16);
+  postFilter.economyOrder = read<int32>(data + 20);
+  numTables = read<int32>(data + 24);
+  if (numNotes != kNumNotes || numTables < 0 ||
+      imageSize != kHeaderSize + kNumNotes * kNoteSize +
+                       static_cast<size_t>(numTables) * kTableSize) {
+    return Result::fail("The voicing file is truncated or malformed");
+  }
+  const auto postFilterResult = checkPostFilter(postFilter);
+  if (postFilterResult.failed()) {
+    return postFilterResult;
+  }
+
+  notes = reinterpret_cast<const float *>(data + kHeaderSize);
+  for (auto midiNoteNumber = 0; midiNoteNumber < kNumNotes; ++midiNoteNumber) {
+    const auto noteResult = checkNote(midiNoteNumber, getNote(midiNoteNumber));
+    if (noteResult.failed()) {
+      return noteResult;
+    }
+  }
+
+  tables = data + kHeaderSize + kNumNotes * kNoteSize;
+  for (auto tableIndex = 0; tableIndex < numTables; ++tableIndex) {
+    const auto *table = tables + static_cast<size_t>(tableIndex) * kTableSize;
+    const auto sampleRate = read<double>(table);
+    const auto order = read<int32>(table + 8);
+    const auto numSections = read<int32>(table + 12);
+    auto isValid = std::isfinite(sampleRate) && sampleRate > 0.0 &&
+                   (order == postFilter.fullOrder ||
+                    order == postFilter.economyOrder) &&
+                   numSections == (order + 1) / 2;
+    const auto *coefficients =
+        reinterpret_cast<const float *>(table + kTableHeaderSize);
+    for (auto index = 0; isValid && index < 5 * kMaxTableSections; ++index) {
+      isValid = std::isfinite(coefficients[index]);
+    }
+    if (!isValid) {
+      return Result::fail("Post filter table " + String(tableIndex) +
+                          " is malformed");
+    }
+  }
+  return Result::ok();
+}
+
+MemoryBlock
+PianoMannVoicing::createImage(const Description &description,
+                              const Array<double> &tableSampleRates) {
+  const auto &postFilter = description.postFilter;
+  Array<int> tableOrders;
+  for (const auto order : {postFilter.fullOrder, postFilter.economyOrder}) {
+    // An order that cannot be designed fails the check of the image.
+    if (isValidOrder(order)) {
+      tableOrders.addIfNotAlreadyThere(order);
+    }
+  }
+
+  MemoryOutputStream output;
+  output.write(kMagic, sizeof(kMagic));
+  output.writeInt(kVersion);
+  output.writeInt(kNumNotes);
+  output.writeFloat(postFilter.cutoffFrequency);
+  output.writeInt(postFilter.fullOrder);
+  output.writeInt(postFilter.economyOrder);
+  output.writeInt(tableSampleRates.size() * tableOrders.size());
+  output.writeInt(0);
+  for (const auto &note : description.notes) {
+    output.writeFloat(note.weightedAverageFilter);
+    output.writeFloat(note.sustain);
+    output.writeFloat(note.damperDecaySeconds);
+  }
+  for (const auto sampleRate : tableSampleRates) {
+    for (const auto order : tableOrders) {
+      const auto cascade = PianoMannButterworthLowPassFilter::design(
+          jmin(postFilter.cutoffFrequency,
+               static_cast<float>(0.45 * sampleRate)),
+          sampleRate, order);
+      output.writeDouble(sampleRate);
+      output.writeInt(order);
+      output.writeInt(cascade.numSections);
+      for (auto section = 0; section < kMaxTableSections; ++section) {
+        output.writeFloat(cascade.b0[section]);
+        output.writeFloat(cascade.b1[section]);
+        output.writeFloat(cascade.b2[section]);
+        output.writeFloat(cascade.a1[section]);
+        output.writeFloat(cascade.a2[section]);
+      }
+    }
+  }
+  return output.getMemoryBlock();
+}
+
+Result PianoMannVoicing::Watcher::watch(const File &fileToWatch) {
+  watchedFile = fileToWatch;
+  if (watchedFile == File()) {
+    stopTimer();
+    lastResult = Result::ok();
+    return lastResult;
+  }
+  startTimer(kPollIntervalMilliseconds);
+  return loadWatchedFile();
+}
+
+void PianoMannVoicing::Watcher::timerCallback() {
+  const auto modificationTime = watchedFile.getLastModificationTime();
+  const auto hasSettled = modificationTime == polledModificationTime;
+  polledModificationTime = modificationTime;
+  if (hasSettled && modificationTime != triedModificationTime) {
+    loadWatchedFile();
+  }
+}
+
+Result PianoMannVoicing::Watcher::loadWatchedFile() {
+  triedModificationTime = watchedFile.getLastModificationTime();
+  polledModificationTime = triedModificationTime;
+  std::shared_ptr<const PianoMannVoicing> voicing;
+  lastResult = load(watchedFile, voicing);
+  if (lastResult.wasOk()) {
+    onVoicingLoaded(std::move(voicing));
+  }
+  return lastResult;
+}
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    PianoMannVoicing.h
+    Created: 20 Oct 2026 12:04:16am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PianoMannDspKernels.h"
+#include <JuceHeader.h>
+#include <array>
+#include <functional>
+#include <memory>
+
+/**
+ * How the piano is voiced: the loop filter, sustain and damper of every string, and the low-pass
+ * filter on the output. Voicings are read-only once made. The built-in one is compiled in, and
+ * others come from voicing files, which are memory-mapped and used in place rather than parsed.
+ * Instances loading the same unchanged file share its mapping.
+ *
+ * A voicing file is laid out as a header, a row per MIDI note and the post filter's coefficients
+ * precomputed for some sample rates:
+ *
+ *   Header: magic "PMVO", int32 version, int32 number of notes (128), float32 post filter cut-off,
+ *           int32 full order, int32 economy order, int32 number of tables, int32 reserved (0)
+ *   Note:   float32 weighted average filter, float32 sustain, float32 damper decay seconds
+ *   Table:  float64 sample rate, int32 order, int32 number of sections,
+ *           float32 b0, b1, b2, a1, a2 for each of `kMaxTableSections` sections
+ *
+ * All values are little-endian, the notes stay 4-byte aligned and the tables 8-byte aligned. A
+ * sample rate without a table has its post filter designed when it is needed. Files are meant to
+ * be replaced whole, as `write` does, rather than rewritten in place while mapped.
+ */
+class PianoMannVoicing {
+public:
+  static constexpr int kNumNotes = 128;
+  static constexpr int kMaxTableSections = 16;
+  static_assert(kMaxTableSections <= PianoMannDspKernels::BiquadCascade::kMaxSections,
+                "Tables must fit in a cascade");
+
+  struct Note {
+    /**
+     * The Karplus-Strong loop of the string uses a two-point weighted average filter, whose
+     * weight of the `current` sample this is, in (0, 1]. The filter is defined as
+     * ```
+     * let S = weightedAverageFilter;
+     * y[t] = S*x[t] + (1-S)*x[t-1]
+     * ```
+     */
+    float weightedAverageFilter;
+    /**
+     * The loop gain of the string while its damper is lifted, in (0, 1).
+     */
+    float sustain;
+    /**
+     * The time for a fully damped string to decay by 60dB, in seconds, or 0 if the string has no
+     * damper and rings until it decays on its own.
+     */
+    float damperDecaySeconds;
+
+    bool hasDamper() const { return damperDecaySeconds > 0.f; }
+  };
+
+  struct PostFilter {
+    float cutoffFrequency = 5000.f;
+    /**
+     * The orders of the Butterworth filter at full quality and in economy, see
+     * `PianoMannPostFilter`.
+     */
+    int fullOrder = 17;
+    int economyOrder = 7;
+  };
+
+  /**
+   * A voicing as plain values, for tools to edit and for `create` and `write` to turn into a
+   * voicing. Notes outside the synthesiser's range are kept but unused.
+   */
+  struct Description {
+    std::array<Note, kNumNotes> notes{};
+    PostFilter postFilter;
+  };
+
+  /**
+   * The voicing the piano was designed with.
+   */
+  static std::shared_ptr<const PianoMannVoicing> getBuiltIn();
+  static Description describeBuiltIn();
+
+  /**
+   * Maps a voicing file, or shares the mapping of another instance if the file has not changed
+   * since. On failure, `result` is left as it was.
+   */
+  static Result load(const File &file,
+                     std::shared_ptr<const PianoMannVoicing> &result);
+
+  /**
+   * A voicing held in memory, with the post filter precomputed for `tableSampleRates`.
+   */
+  static Result create(const Description &description,
+                       std::shared_ptr<const PianoMannVoicing> &result,
+                       const Array<double> &tableSampleRates = getCommonSampleRates());
+  /**
+   * Writes a voicing file, replacing `file` only once fully written.
+   */
+  static Result write(const Description &description, const File &file,
+                      const Array<double> &tableSampleRates = getCommonSampleRates());
+  static Array<double> getCommonSampleRates() {
+    return {44100.0, 48000.0, 88200.0, 96000.0};
+  }
+
+  /**
+   * Describes a voicing as JSON, for sound designers to edit by hand and compile with `write`,
+   * see `PianoMannStandaloneApp.cpp`. Notes missing from the JSON keep the built-in voicing.
+   */
+  static String toJson(const Description &description);
+  static Result parseJson(const String &json, Description &result);
+
+  Note getNote(int midiNoteNumber) const {
+    jassert(isPositiveAndBelow(midiNoteNumber, kNumNotes));
+    const auto *row = notes + 3 * midiNoteNumber;
+    return {row[0], row[1], row[2]};
+  }
+  const PostFilter &getPostFilter() const { return postFilter; }
+  Description describe() const;
+
+  /**
+   * The sections of the post filter at full or economy order for `sampleRate`, from the tables
+   * if there is one for it, and designed otherwise.
+   */
+  PianoMannDspKernels::BiquadCascade
+  getPostFilterCascade(double sampleRate, bool isFullOrder) const;
+
+  /**
+   * The file the voicing was loaded from, which is empty for voicings made in memory.
+   */
+  const File &getFile() const { return file; }
+
+  /**
+   * Watches a voicing file from the message thread, and loads it again whenever it changes. A
+   * change is only loaded once the file has stopped changing for a poll, so a file still being
+   * written is not picked up half way. A file that cannot be loaded is skipped until it changes
+   * again.
+   */
+  class Watcher : private Timer {
+  public:
+    using Callback = std::function<void(std::shared_ptr<const PianoMannVoicing>)>;
+
+    explicit Watcher(Callback onLoaded) : onVoicingLoaded(std::move(onLoaded)) {}
+    ~Watcher() override { stopTimer(); }
+
+    /**
+     * Loads `fileToWatch` and keeps watching it, even if it cannot be loaded yet. An empty `File`
+     * stops watching.
+     */
+    Result watch(const File &fileToWatch);
+    const File &getWatchedFile() const { return watchedFile; }
+    /**
+     * Whether the watched file could be loaded the last time it was tried, which is when it was
+     * first watched or last changed.
+     */
+    const Result &getLastResult() const { return lastResult; }
+
+  private:
+    void timerCallback() override;
+    Result loadWatchedFile();
+
+    static constexpr int kPollIntervalMilliseconds = 500;
+
+    Callback onVoicingLoaded;
+    File watchedFile;
+    /**
+     * The modification time of the file when last loaded or tried, and when last polled.
+     */
+    Time triedModificationTime;
+    Time polledModificationTime;
+    Result lastResult = Result::ok();
+
+    JUCE_DECLARE_NON_COPYABLE(Watcher)
+  };
+
+  PianoMannVoicing(const PianoMannVoicing &) = delete;
+  PianoMannVoicing &operator=(const PianoMannVoicing &) = delete;
+
+private:
+  PianoMannVoicing() = default;
+
+  /**
+   * Checks the layout and values of a voicing image, and points the voicing into it.
+   */
+  Result useImage(const void *imageData, size_t imageSize);
+  static MemoryBlock createImage(const Description &description,
+                                 const Array<double> &tableSampleRates);
+
+  std::unique_ptr<MemoryMappedFile> mappedFile;
+  MemoryBlock ownedImage;
+  File file;
+  Time modificationTime;
+
+  const float *notes = nullptr;
+  PostFilter postFilter;
+  const char *tables = nullptr;
+  int numTables = 0;
+};
@@ -11,18 +11,120 @@
 #include "PluginEditor.h"
 #include "PluginProcessor.h"
 
+namespace {
+enum TuningId { kEqualTemperamentId = 1, kStretchedId, kLoadedScaleId };
+} // namespace
+
 //==============================================================================
 PianoMannAudioProcessorEditor::PianoMannAudioProcessorEditor(
     PianoMannAudioProcessor &p)
-    : AudioProcessorEditor(&p), processor(p),
+    : AudioProcessorEditor(&p), processor(p), visualiser(p),
       midiKeyboardComponent(p.keyboardState,
                             MidiKeyboardComponent::horizontalKeyboard) {
   setOpaque(true);
-  setSize(640, 72);
+  setSize(640, 296);
+  addAndMakeVisible(visualiser);
   addAndMakeVisible(midiKeyboardComponent);
+  processor.setKeyboardShown(true);
+  addAndMakeVisible(qualityTierLabel);
+
+  renderAheadButton.setToggleState(p.isRenderAheadEnabled(),
+                                   dontSendNotification);
+  renderAheadButton.onClick = [this] {
+    processor.setRenderAheadEnabled(renderAheadButton.getToggleState());
+  };
+  addAndMakeVisible(renderAheadButton);
+
+  quantumBufferingButton.setToggleState(p.isQuantumBufferingEnabled(),
+                                        dontSendNotification);
+  quantumBufferingButton.onClick = [this] {
+    processor.setQuantumBufferingEnabled(
+        quantumBufferingButton.getToggleState());
+  };
+  addAndMakeVisible(quantumBufferingButton);
+
+  updateTuningBox();
+  tuningBox.onChange = [this] {
+    switch (tuningBox.getSelectedId()) {
+    case kEqualTemperamentId:
+      processor.setTuning(PianoMannTuning::equalTemperament());
+      break;
+    case kStretchedId:
+      processor.setTuning(PianoMannTuning::stretched());
+      break;
+    default:
+      break;
+    }
+  };
+  addAndMakeVisible(tuningBox);
+
+  loadScalaButton.onClick = [this] {
+    scalaChooser = std::make_unique<FileChooser>(
+        "Load a Scala scale, and optionally its keyboard mapping", File(),
+        "*.scl;*.kbm");
+    scalaChooser->launchAsync(FileBrowserComponent::openMode |
+                                  FileBrowserComponent::canSelectFiles |
+                                  FileBrowserComponent::canSelectMultipleItems,
+                              [this](const FileChooser &chooser) {
+                                loadScala(chooser.getResults());
+                              });
+  };
+  addAndMakeVisible(loadScalaButton);
+
+  loadVoicingButton.onClick = [this] {
+    voicingChooser = std::make_unique<FileChooser>(
+        "Load a voicing", processor.getVoicingFile(), "*.pmvoicing");
+    voicingChooser->launchAsync(FileBrowserComponent::openMode |
+                                    FileBrowserComponent::canSelectFiles,
+                                [this](const FileChooser &chooser) {
+                                  loadVoicing(chooser.getResult());
+                                });
+  };
+  addAndMakeVisible(loadVoicingButton);
+
+  if (p.canRecord()) {
+    recordFormatBox.addItem("WAV", 1);
+    recordFormatBox.addItem("FLAC", 2);
+    recordFormatBox.setSelectedId(1, dontSendNotification);
+    addAndMakeVisible(recordFormatBox);
+
+    recordButton.onClick = [this] {
+      if (processor.isRecording()) {
+        processor.stopRecording();
+      } else {
+        processor.startRecording(PianoMannRecorder::getDefaultFile(
+            recordFormatBox.getSelectedId() == 2 ? ".flac" : ".wav"));
+      }
+      updateRecordButton();
+    };
+    addAndMakeVisible(recordButton);
+
+    renderMidiButton.onClick = [this] {
+      midiChooser = std::make_unique<FileChooser>(
+          "Render a MIDI file", File(), "*.mid;*.midi");
+      midiChooser->launchAsync(FileBrowserComponent::openMode |
+                                   FileBrowserComponent::canSelectFiles,
+                               [this](const FileChooser &chooser) {
+                                 renderMidi(chooser.getResult());
+                               });
+    };
+    addAndMakeVisible(renderMidiButton);
+  }
+
+  if (PianoMannTrace::kIsEnabled && p.canRecord()) {
+    saveTraceButton.onClick = [this] {
+      processor.exportTrace(PianoMannTrace::getDefaultFile());
+    };
+    addAndMakeVisible(saveTraceButton);
+  }
+
+  timerCallback();
+  startTimerHz(4);
 }
 
-PianoMannAudioProcessorEditor::~PianoMannAudioProcessorEditor() = default;
+PianoMannAudioProcessorEditor::~PianoMannAudioProcessorEditor() {
+  processor.setKeyboardShown(false);
+}
 
 void PianoMannAudioProcessorEditor::paint(Graphics &g) {
   // Since this component is opaque, we must fill the entire viewport
@@ -30,5 +132,157 @@ void PianoMannAudioProcessorEditor::paint(Graphics &g) {
 }
 
 void PianoMannAudioProcessorEditor::resized() {
-  midiKeyboardComponent.setBounds(8, 8, getWidth() - 16, 64);
+  visualiser.setBounds(8, 8, getWidth() - 16, 160);
+  midiKeyboardComponent.setBounds(8, 176, getWidth() - 16, 64);
+  auto tuningRow = Rectangle<int>(8, 248, getWidth() - 16, 24);
+  loadVoicingButton.setBounds(tuningRow.removeFromRight(112).reduced(4, 0));
+  loadScalaButton.setBounds(tuningRow.removeFromRight(104).reduced(4, 0));
+  tuningBox.setBounds(tuningRow.removeFromRight(200));
+  if (processor.canRecord()) {
+    renderMidiButton.setBounds(tuningRow.removeFromLeft(112));
+  }
+  auto bottomRow = getLocalBounds().reduced(8, 0).removeFromBottom(24);
+  renderAheadButton.setBounds(bottomRow.removeFromRight(120));
+  quantumBufferingButton.setBounds(bottomRow.removeFromRight(112));
+  if (processor.canRecord()) {
+    recordButton.setBounds(bottomRow.removeFromRight(72).reduced(4, 0));
+    recordFormatBox.setBounds(bottomRow.removeFromRight(72));
+  }
+  if (PianoMannTrace::kIsEnabled && processor.canRecord()) {
+    saveTraceButton.setBounds(bottomRow.removeFromRight(88).reduced(4, 0));
+  }
+  qualityTierLabel.setBounds(bottomRow);
+}
+
+void PianoMannAudioProcessorEditor::timerCallback() {
+  // Recording also stops when the device is reconfigured.
+  if (processor.canRecord()) {
+    updateRecordButton();
+    const auto isRenderingMidi = processor.isRenderingMidiFile();
+    renderMidiButton.setButtonText(isRenderingMidi ? "Rendering..."
+                                                   : "Render MIDI...");
+    renderMidiButton.setEnabled(!isRenderingMidi);
+    if (isMidiRenderUnreported && !isRenderingMidi) {
+      reportMidiRender();
+    }
+  }
+
+  // The voicing file is loaded again whenever it changes.
+  const auto &voicingResult = processor.getVoicingFileResult();
+  if (voicingResult.getErrorMessage() != shownVoicingError) {
+    shownVoicingError = voicingResult.getErrorMessage();
+    if (voicingResult.failed()) {
+      showVoicingError(voicingResult);
+    }
+  }
+
+  const auto qualityTier = processor.getQualityTier();
+  if (qualityTier == displayedQualityTier) {
+    return;
+  }
+  displayedQualityTier = qualityTier;
+  qualityTierLabel.setText(qualityTier == 0
+                               ? String("Quality: full")
+                               : "Quality: reduced (tier " +
+                                     String(qualityTier) + ")",
+                           dontSendNotification);
+}
+
+void PianoMannAudioProcessorEditor::updateTuningBox() {
+  const auto &tuning = processor.getTuning();
+  tuningBox.clear(dontSendNotification);
+  tuningBox.addItem("Equal temperament", kEqualTemperamentId);
+  tuningBox.addItem("Stretched", kStretchedId);
+  if (tuning == PianoMannTuning::equalTemperament()) {
+    tuningBox.setSelectedId(kEqualTemperamentId, dontSendNotification);
+  } else if (tuning == PianoMannTuning::stretched()) {
+    tuningBox.setSelectedId(kStretchedId, dontSendNotification);
+  } else {
+    tuningBox.addItem(tuning.getName().isEmpty() ? String("Scale")
+                                                 : tuning.getName(),
+                      kLoadedScaleId);
+    tuningBox.setSelectedId(kLoadedScaleId, dontSendNotification);
+  }
+}
+
+void PianoMannAudioProcessorEditor::loadScala(const Array<File> &files) {
+  if (files.isEmpty()) {
+    return;
+  }
+  File scaleFile, keyboardMappingFile;
+  for (const auto &file : files) {
+    (file.hasFileExtension("kbm") ? keyboardMappingFile : scaleFile) = file;
+  }
+
+  PianoMannTuning loadedTuning;
+  const auto result =
+      scaleFile == File()
+          ? Result::fail("Choose a .scl file along with the keyboard mapping")
+          : PianoMannTuning::loadScala(scaleFile, keyboardMappingFile,
+                                       loadedTuning);
+  if (result.failed()) {
+    AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon,
+                                     "Cannot load the scale",
+                                     result.getErrorMessage());
+    return;
+  }
+  processor.setTuning(loadedTuning);
+  updateTuningBox();
+}
+
+void PianoMannAudioProcessorEditor::loadVoicing(const File &voicingFile) {
+  if (voicingFile == File()) {
+    return;
+  }
+  const auto result = processor.setVoicingFile(voicingFile);
+  shownVoicingError = result.getErrorMessage();
+  if (result.failed()) {
+    showVoicingError(result);
+  }
+}
+
+void PianoMannAudioProcessorEditor::showVoicingError(const Result &result) {
+  AlertWindow::showMessageBoxAsync(
+      AlertWindow::WarningIcon, "Cannot load the voicing",
+      result.getErrorMessage() +
+          "\n\nThe file is still watched, and is loaded once it is fixed.");
+}
+
+void PianoMannAudioProcessorEditor::renderMidi(const File &midiFile) {
+  if (midiFile == File()) {
+    return;
+  }
+  if (!processor.startRenderingMidiFile(midiFile)) {
+    AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon,
+                                     "Cannot render the MIDI file",
+                                     "Cannot read " +
+                                         midiFile.getFullPathName());
+    return;
+  }
+  isMidiRenderUnreported = true;
+  timerCallback();
+}
+
+void PianoMannAudioProcessorEditor::reportMidiRender() {
+  isMidiRenderUnreported = false;
+  const auto &renderer = processor.getMidiFileRenderer();
+  const auto result = renderer.getLastResult();
+  if (result.failed()) {
+    AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon,
+                                     "Cannot render the MIDI file",
+                                     result.getErrorMessage());
+    return;
+  }
+  const auto report = renderer.getLastReport();
+  AlertWindow::showMessageBoxAsync(
+      AlertWindow::InfoIcon, "Rendered the MIDI file",
+      "Wrote " + renderer.getLastFile().getFullPathName() + ", rendered in " +
+          String(report.numChunks) + " chunks of which " +
+          String(report.numRepairedChunks) + " were rendered again.");
+}
+
+void PianoMannAudioProcessorEditor::updateRecordButton() {
+  const auto isRecording = processor.isRecording();
+  recordButton.setButtonText(isRecording ? "Stop" : "Record");
+  recordFormatBox.setEnabled(!isRecording);
 }
@@ -10,13 +10,15 @@
 
 #pragma once
 
+#include "PianoMannVisualiser.h"
 #include "PluginProcessor.h"
 #include <JuceHeader.h>
 
 //==============================================================================
 /**
  */
-class PianoMannAudioProcessorEditor : public AudioProcessorEditor {
+class PianoMannAudioProcessorEditor : public AudioProcessorEditor,
+                                     private Timer {
 public:
   explicit PianoMannAudioProcessorEditor(PianoMannAudioProcessor&);
   ~PianoMannAudioProcessorEditor();
@@ -25,10 +27,57 @@ public:
   void resized() override;
 
 private:
+  void timerCallback() override;
+
   // This reference is provided as a quick way for your editor to
   // access the processor object that created it.
   PianoMannAudioProcessor &processor;
+  PianoMannVisualiser visualiser;
   MidiKeyboardComponent midiKeyboardComponent;
+  Label qualityTierLabel;
+  ToggleButton renderAheadButton{"Render ahead"};
+  ToggleButton quantumBufferingButton{"Fixed quanta"};
+  int displayedQualityTier = -1;
+
+  /**
+   * Picks a built-in tuning, or shows the name of a loaded scale.
+   */
+  ComboBox tuningBox;
+  TextButton loadScalaButton{"Load Scala..."};
+  std::unique_ptr<FileChooser> scalaChooser;
+  void updateTuningBox();
+  void loadScala(const Array<File> &files);
+  /**
+   * Voices the piano from a voicing file, which keeps being watched for changes.
+   */
+  TextButton loadVoicingButton{"Load voicing..."};
+  std::unique_ptr<FileChooser> voicingChooser;
+  void loadVoicing(const File &voicingFile);
+  /**
+   * Each reason the voicing file cannot be loaded is shown once, whether it is loaded here or
+   * reloaded after a change.
+   */
+  String shownVoicingError;
+  void showVoicingError(const Result &result);
+
+  /**
+   * Only shown in the standalone app, see `PianoMannAudioProcessor::canRecord`.
+   */
+  TextButton recordButton;
+  ComboBox recordFormatBox;
+  void updateRecordButton();
+  TextButton renderMidiButton;
+  std::unique_ptr<FileChooser> midiChooser;
+  void renderMidi(const File &midiFile);
+  /**
+   * Whether a render started here has yet to be reported, which `timerCallback` does once it ends.
+   */
+  bool isMidiRenderUnreported = false;
+  void reportMidiRender();
+  /**
+   * Only shown in the standalone app of builds with tracing, see `PianoMannTrace`.
+   */
+  TextButton saveTraceButton{"Save trace"};
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoMannAudioProcessorEditor)
 };
@@ -9,8 +9,34 @@
 */
 
 #include "PluginProcessor.h"
+#include "PianoMannRealtimeSafety.h"
+#include "PianoMannTrace.h"
 #include "PianoMannVoice.h"
 #include "PluginEditor.h"
+#include <algorithm>
+#include <cstdlib>
+
+//==============================================================================
+class PianoMannAudioProcessor::QualityTierReporter : private Timer {
+public:
+  explicit QualityTierReporter(PianoMannAudioProcessor &processorToReport)
+      : processor(processorToReport) {
+    startTimerHz(kUpdatesPerSecond);
+  }
+  ~QualityTierReporter() override { stopTimer(); }
+
+private:
+  /**
+   * Tiers change at most a few times a second, see `PianoMannQualityGovernor`.
+   */
+  static constexpr int kUpdatesPerSecond = 4;
+
+  void timerCallback() override {
+    *processor.qualityTierParameter = processor.qualityTier.load();
+  }
+
+  PianoMannAudioProcessor &processor;
+};
 
 //==============================================================================
 PianoMannAudioProcessor::PianoMannAudioProcessor()
@@ -21,25 +47,55 @@ PianoMannAudioProcessor::PianoMannAudioProcessor()
                          .withInput("Input", AudioChannelSet::stereo(), true)
 #endif
                          .withOutput("Output", AudioChannelSet::stereo(), true)
+                         .withOutput("Bass", AudioChannelSet::stereo(), false)
+                         .withOutput("Mid", AudioChannelSet::stereo(), false)
+                         .withOutput("Treble", AudioChannelSet::stereo(), false)
 #endif
       )
 #endif
 {
-  initializeSynth();
+  // Before any audio, so the audio thread never has to look at the CPU or the
+  // environment.
+  PianoMannDspKernels::selectKernels();
+  // Reports the governor's choice to the host. Anything the host writes here
+  // is overwritten on the next tier change.
+  addParameter(qualityTierParameter = new AudioParameterInt(
+                   "qualityTier", "Quality Tier", 0,
+                   PianoMannQualityGovernor::kNumTiers - 1, 0));
+  qualityTierReporter = std::make_unique<QualityTierReporter>(*this);
+  initializeSynth(synth);
+  initializeSynth(liveSynth);
+  setExcitationSeed(kDefaultExcitationSeed);
+  setStrikeVariationEnabled(isStrikeVariationEnabled);
+  setVelocityShapingEnabled(isVelocityShapingEnabled);
+  setHammerModelEnabled(isHammerModelEnabled);
+  PianoMannTrace::prepare();
 }
 
-PianoMannAudioProcessor::~PianoMannAudioProcessor() = default;
+PianoMannAudioProcessor::~PianoMannAudioProcessor() {
+  offlineRenderer.stop();
+  renderAhead.stop();
+  preparation.stop();
+}
 
-void PianoMannAudioProcessor::initializeSynth() {
-  synth.clearVoices();
-  synth.clearSounds();
+void PianoMannAudioProcessor::initializeSynth(
+    PianoMannSynthesiser &synthToInitialize) {
+  synthToInitialize.clearVoices();
+  synthToInitialize.clearSounds();
+  synthToInitialize.addKeys();
+}
 
-  for (auto midiNote = PianoMannSound::kMinNote;
-       midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
-    synth.addVoice(
-        new PianoMannVoice({midiNote}));
-    synth.addSound(new PianoMannSound(midiNote));
+void PianoMannAudioProcessor::applyQualityTier(int tier) {
+  const auto tierSpec = PianoMannQualityGovernor::getTierSpec(tier);
+  for (auto &synthPostProcessor : synthPostProcessors) {
+    synthPostProcessor.setUseFullOrder(tierSpec.useFullOrderPostFilter);
+  }
+  for (auto *synthToUpdate : {&synth, &liveSynth}) {
+    synthToUpdate->setMaxRingingVoices(tierSpec.maxRingingVoices);
+    synthToUpdate->setSilenceThreshold(tierSpec.silenceThreshold);
   }
+
+  qualityTier = tier;
 }
 
 //==============================================================================
@@ -100,18 +156,165 @@ void PianoMannAudioProcessor::changeProgramName(int index,
 //==============================================================================
 void PianoMannAudioProcessor::prepareToPlay(
     double sampleRate, int maximumExpectedSamplesPerBlock) {
+  // The background thread owns `synth` while rendering ahead.
+  renderAhead.stop();
+  preparation.stop();
+
+  // Only cheap preparation happens here. Strings and the full-order filters
+  // are built by `startBackgroundPreparation` below, so every string is
+  // stopped and unprepared first, even at the same rate.
   synth.setCurrentPlaybackSampleRate(sampleRate);
-  keyboardState.reset();
+  liveSynth.setCurrentPlaybackSampleRate(sampleRate);
+  keyboardBridge.reset();
+
+  routeRegistersToOutputBuses();
+  // With quantum buffering, the post filters are handed whole quanta.
+  const auto maximumPostFilterBlockSize = jmax(
+      maximumExpectedSamplesPerBlock, PianoMannQuantumBuffer::kQuantumSize);
+  for (auto busIndex = 0; busIndex < kNumOutputBuses; ++busIndex) {
+    const dsp::ProcessSpec processSpec{
+        sampleRate, static_cast<uint32>(maximumPostFilterBlockSize),
+        static_cast<uint32>(getChannelCountOfBus(false, busIndex))};
+    synthPostProcessors[static_cast<size_t>(busIndex)].prepare(processSpec,
+                                                               *voicing);
+  }
 
-  const dsp::ProcessSpec processSpec{
-      sampleRate, static_cast<uint32>(maximumExpectedSamplesPerBlock),
-      static_cast<uint32>(getTotalNumOutputChannels())};
-  synthPostProcessor.prepare(processSpec);
+  qualityGovernor.prepare(sampleRate);
+  pinnedQualityTier = requestedPinnedQualityTier.load();
+  applyQualityTier(pinnedQualityTier != kAdaptiveQualityTier
+                       ? pinnedQualityTier
+                       : qualityGovernor.getTier());
+
+  if (canRecord()) {
+    recorder.prepare(sampleRate, getMainBusNumOutputChannels());
+  }
+  visualiserFeed.prepare(sampleRate);
+
+  startBackgroundPreparation(sampleRate);
+
+  isRenderingAhead = isRenderAheadRequested.load();
+  isBufferingQuanta = !isRenderingAhead && isQuantumBufferingRequested.load();
+  liveNotes.reset();
+  if (isRenderingAhead) {
+    liveMidi.ensureSize(4096);
+    setLatencySamples(renderAhead.start(sampleRate,
+                                        maximumExpectedSamplesPerBlock,
+                                        getTotalNumOutputChannels()));
+  } else if (isBufferingQuanta) {
+    quantumBuffer.prepare(maximumExpectedSamplesPerBlock,
+                          getTotalNumOutputChannels());
+    setLatencySamples(PianoMannQuantumBuffer::kLatencySamples);
+  } else {
+    setLatencySamples(0);
+  }
 }
 
 void PianoMannAudioProcessor::releaseResources() {
-  keyboardState.reset();
-  synthPostProcessor.reset();
+  renderAhead.stop();
+  preparation.stop();
+  renderCacheReader.reset();
+  recorder.stop();
+  if (hasRenderedOfflineSinceTraceExport) {
+    exportTrace(PianoMannTrace::getDefaultFile());
+    hasRenderedOfflineSinceTraceExport = false;
+  }
+  // Both synthesisers record the same strikes, so one of them is enough.
+  if (isRenderCacheEnabled && getSampleRate() > 0.0) {
+    PianoMannRenderCache::save(
+        synth,
+        PianoMannRenderCache::getDefaultFile(getSampleRate(), excitationSeed),
+        getSampleRate(), excitationSeed);
+  }
+  keyboardBridge.reset();
+  for (auto &synthPostProcessor : synthPostProcessors) {
+    synthPostProcessor.reset();
+  }
+}
+
+void PianoMannAudioProcessor::startBackgroundPreparation(double sampleRate) {
+  std::vector<PianoMannBackgroundPreparation::Step> steps;
+
+  // The steps keep the voicing they started with, even if a new one is
+  // loaded meanwhile. The new one reaches the strings and filters through
+  // `setVoicing` as well.
+  for (auto &synthPostProcessor : synthPostProcessors) {
+    steps.emplace_back([&synthPostProcessor, stepVoicing = voicing] {
+      synthPostProcessor.prepareFullOrder(*stepVoicing);
+    });
+  }
+
+  renderCacheReader.reset();
+  if (isRenderCacheEnabled) {
+    const auto renderCacheFile =
+        PianoMannRenderCache::getDefaultFile(sampleRate, excitationSeed);
+    steps.emplace_back(
+        [this, renderCacheFile, sampleRate, seed = excitationSeed] {
+          renderCacheReader = std::make_unique<PianoMannRenderCache::Reader>(
+              renderCacheFile, sampleRate, seed);
+        });
+  }
+
+  // Strings are prepared from the middle of the keyboard outwards, the
+  // likeliest to be played first. Notes played before their string is ready
+  // are deferred by the synthesiser.
+  std::vector<int> midiNotes;
+  for (auto midiNote = PianoMannSound::kMinNote;
+       midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
+    midiNotes.push_back(midiNote);
+  }
+  constexpr auto kMiddleNote =
+      (PianoMannSound::kMinNote + PianoMannSound::kMaxNote) / 2;
+  std::stable_sort(midiNotes.begin(), midiNotes.end(), [](int a, int b) {
+    return std::abs(a - kMiddleNote) < std::abs(b - kMiddleNote);
+  });
+  // Later tunings reach the strings through `setTuning` instead.
+  for (const auto midiNote : midiNotes) {
+    steps.emplace_back([this, midiNote, sampleRate, stepVoicing = voicing,
+                        frequency = tuning.getFrequency(midiNote)] {
+      const auto stringTuning = PianoMannVoice::tuneString(
+          *stepVoicing, midiNote, frequency, sampleRate);
+      auto cached = renderCacheReader != nullptr
+                        ? renderCacheReader->getEntry(midiNote)
+                        : PianoMannRenderCache::Reader::Entry{};
+      if (!cached.isRecordedWith(stringTuning)) {
+        cached = {};
+      }
+      for (auto *synthToPrepare : {&synth, &liveSynth}) {
+        synthToPrepare->findVoiceForNote(midiNote)->prepareForCurrentSampleRate(
+            stringTuning, cached.samples, cached.numSamples);
+      }
+    });
+  }
+
+  preparation.start(std::move(steps));
+}
+
+void PianoMannAudioProcessor::routeRegistersToOutputBuses() {
+  const auto numMainChannels = getChannelCountOfBus(false, 0);
+  for (auto registerIndex = 0;
+       registerIndex < PianoMannSynthesiser::kNumRegisters; ++registerIndex) {
+    const auto busIndex = 1 + registerIndex;
+    const auto numBusChannels = getChannelCountOfBus(false, busIndex);
+    const auto firstChannel =
+        numBusChannels > 0
+            ? getChannelIndexInProcessBlockBuffer(false, busIndex, 0)
+            : 0;
+    for (auto *synthToRoute : {&synth, &liveSynth}) {
+      synthToRoute->setRegisterChannels(
+          static_cast<PianoMannSynthesiser::Register>(registerIndex),
+          firstChannel, numBusChannels > 0 ? numBusChannels : numMainChannels);
+    }
+  }
+}
+
+void PianoMannAudioProcessor::processPostFilters(AudioBuffer<float> &buffer) {
+  for (auto busIndex = 0; busIndex < kNumOutputBuses; ++busIndex) {
+    auto busBuffer = getBusBuffer(buffer, false, busIndex);
+    if (busBuffer.getNumChannels() > 0) {
+      PIANOMANN_TRACE_SCOPE_ARG("postFilter", "bus", busIndex);
+      synthPostProcessors[static_cast<size_t>(busIndex)].process(busBuffer);
+    }
+  }
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -127,6 +330,14 @@ bool PianoMannAudioProcessor::isBusesLayoutSupported(
       layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
     return false;
 
+  // Register outputs may also be disabled.
+  for (auto busIndex = 1; busIndex < layouts.outputBuses.size(); ++busIndex) {
+    const auto &channelSet = layouts.outputBuses[busIndex];
+    if (!channelSet.isDisabled() && channelSet != AudioChannelSet::mono() &&
+        channelSet != AudioChannelSet::stereo())
+      return false;
+  }
+
     // This checks if the input layout matches the output layout
 #if !JucePlugin_IsSynth
   if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
@@ -140,6 +351,9 @@ bool PianoMannAudioProcessor::isBusesLayoutSupported(
 
 void PianoMannAudioProcessor::processBlock(AudioBuffer<float> &buffer,
                                            MidiBuffer &midiMessages) {
+  const PianoMannRealtimeSafety::ScopedAudioCallback audioCallback;
+  PIANOMANN_TRACE_SCOPE("processBlock");
+  const auto startTicks = Time::getHighResolutionTicks();
   ScopedNoDenormals noDenormals;
   ignoreUnused(noDenormals);
   const auto totalNumInputChannels = getTotalNumInputChannels();
@@ -150,13 +364,232 @@ void PianoMannAudioProcessor::processBlock(AudioBuffer<float> &buffer,
   }
 
   const auto numSamples = buffer.getNumSamples();
-  keyboardState.processNextMidiBuffer(midiMessages, 0, numSamples, true);
+  keyboardBridge.process(midiMessages);
+
+  if (isRenderingAhead) {
+    // The governor would have to touch `synth`, which belongs to the
+    // background thread in this mode.
+    processBlockRenderingAhead(buffer, midiMessages);
+    processPostFilters(buffer);
+    recorder.process(buffer, midiMessages);
+    visualiserFeed.push(buffer, getMainBusNumOutputChannels());
+    return;
+  }
+
+  // The synthesisers lock themselves against settings changes from the
+  // message thread, and the quality tier changes settings on both.
+  const PianoMannRealtimeSafety::ScopedAllowedLock allowSynthLock(
+      synth.getLock());
+  const PianoMannRealtimeSafety::ScopedAllowedLock allowLiveSynthLock(
+      liveSynth.getLock());
+  if (isBufferingQuanta) {
+    quantumBuffer.process(
+        buffer, midiMessages,
+        [this](AudioBuffer<float> &quantum, const MidiBuffer &quantumMidi) {
+          synth.renderNextBlock(quantum, quantumMidi, 0,
+                                quantum.getNumSamples());
+          processPostFilters(quantum);
+        });
+  } else {
+    synth.renderNextBlock(buffer, midiMessages, 0, numSamples);
+    processPostFilters(buffer);
+  }
+  recorder.process(buffer, midiMessages);
+  visualiserFeed.push(buffer, getMainBusNumOutputChannels());
+
+  if (isNonRealtime()) {
+    hasRenderedOfflineSinceTraceExport = PianoMannTrace::kIsEnabled;
+  }
+  if (pinnedQualityTier != kAdaptiveQualityTier) {
+    return;
+  }
+  // Offline renders have no deadline, so always run them at full quality.
+  if (isNonRealtime()) {
+    if (qualityGovernor.getTier() != 0) {
+      qualityGovernor.reset();
+      applyQualityTier(qualityGovernor.getTier());
+    }
+    return;
+  }
+  const auto elapsedSeconds = Time::highResolutionTicksToSeconds(
+      Time::getHighResolutionTicks() - startTicks);
+  if (qualityGovernor.blockRendered(numSamples, elapsedSeconds)) {
+    applyQualityTier(qualityGovernor.getTier());
+  }
+}
+
+void PianoMannAudioProcessor::processBlockRenderingAhead(
+    AudioBuffer<float> &buffer, MidiBuffer &midiMessages) {
+  const auto numSamples = buffer.getNumSamples();
+  const auto isLive = !isHostPlayingBack();
+
+  liveMidi.clear();
+  MidiBuffer::Iterator midiIterator(midiMessages);
+  const uint8 *midiData;
+  int numBytes, samplePosition;
+  while (midiIterator.getNextEvent(midiData, numBytes, samplePosition)) {
+    // Neither synthesiser responds to sysex, and copying it into a
+    // `MidiMessage` could allocate.
+    if (numBytes > PianoMannRenderAhead::kMaxMidiEventSize) {
+      continue;
+    }
+    const MidiMessage message(midiData, numBytes);
+    if (message.isNoteOnOrOff()) {
+      const auto midiNoteNumber = message.getNoteNumber();
+      if (message.isNoteOn()) {
+        liveNotes[static_cast<size_t>(midiNoteNumber)] = isLive;
+      }
+      if (liveNotes[static_cast<size_t>(midiNoteNumber)]) {
+        liveMidi.addEvent(midiData, numBytes, samplePosition);
+      } else {
+        renderAhead.pushMidiEvent(midiData, numBytes, samplePosition);
+      }
+    } else {
+      // Pedals and other controllers apply to the whole instrument.
+      liveMidi.addEvent(midiData, numBytes, samplePosition);
+      renderAhead.pushMidiEvent(midiData, numBytes, samplePosition);
+    }
+  }
+
+  renderAhead.processNextBlock(buffer, numSamples);
+  // `synth` belongs to the background thread, so only `liveSynth` may lock.
+  const PianoMannRealtimeSafety::ScopedAllowedLock allowLiveSynthLock(
+      liveSynth.getLock());
+  liveSynth.renderNextBlock(buffer, liveMidi, 0, numSamples);
+}
+
+bool PianoMannAudioProcessor::isHostPlayingBack() {
+  if (auto *playHead = getPlayHead()) {
+    AudioPlayHead::CurrentPositionInfo positionInfo;
+    if (playHead->getCurrentPosition(positionInfo)) {
+      return positionInfo.isPlaying && !positionInfo.isRecording;
+    }
+  }
+  return false;
+}
+
+void PianoMannAudioProcessor::setRenderAheadEnabled(bool shouldRenderAhead) {
+  isRenderAheadRequested = shouldRenderAhead;
+}
+
+void PianoMannAudioProcessor::setQuantumBufferingEnabled(bool shouldBuffer) {
+  isQuantumBufferingRequested = shouldBuffer;
+}
+
+void PianoMannAudioProcessor::setPinnedQualityTier(int tier) {
+  jassert(tier == kAdaptiveQualityTier ||
+          isPositiveAndBelow(tier, PianoMannQualityGovernor::kNumTiers));
+  requestedPinnedQualityTier = tier;
+}
+
+PianoMannSynthesiser::RetirementStats
+PianoMannAudioProcessor::getRetirementStats() const {
+  auto stats = synth.getRetirementStats();
+  const auto liveStats = liveSynth.getRetirementStats();
+  stats.numStrikes += liveStats.numStrikes;
+  stats.numRetiredVoices += liveStats.numRetiredVoices;
+  stats.maxRingingVoices =
+      jmax(stats.maxRingingVoices, liveStats.maxRingingVoices);
+  return stats;
+}
+
+PianoMannSynthesiser::AttackStats
+PianoMannAudioProcessor::getAttackStats() const {
+  auto stats = synth.getAttackStats();
+  const auto liveStats = liveSynth.getAttackStats();
+  stats.numHammeredStrikes += liveStats.numHammeredStrikes;
+  stats.numAttackSamples += liveStats.numAttackSamples;
+  return stats;
+}
+
+void PianoMannAudioProcessor::setExcitationSeed(int64 newExcitationSeed) {
+  excitationSeed = newExcitationSeed;
+  synth.setExcitationSeed(excitationSeed);
+  liveSynth.setExcitationSeed(excitationSeed);
+}
+
+void PianoMannAudioProcessor::setStrikeVariationEnabled(bool shouldVary) {
+  isStrikeVariationEnabled = shouldVary;
+  synth.setStrikeVariationEnabled(isStrikeVariationEnabled);
+  liveSynth.setStrikeVariationEnabled(isStrikeVariationEnabled);
+}
+
+void PianoMannAudioProcessor::setVelocityShapingEnabled(bool shouldShape) {
+  isVelocityShapingEnabled = shouldShape;
+  synth.setVelocityShapingEnabled(isVelocityShapingEnabled);
+  liveSynth.setVelocityShapingEnabled(isVelocityShapingEnabled);
+}
+
+void PianoMannAudioProcessor::setHammerModelEnabled(bool shouldStrike) {
+  isHammerModelEnabled = shouldStrike;
+  synth.setHammerModelEnabled(isHammerModelEnabled);
+  liveSynth.setHammerModelEnabled(isHammerModelEnabled);
+}
+
+void PianoMannAudioProcessor::setVisualiserOpen(bool isOpen) {
+  numOpenVisualisers += isOpen ? 1 : -1;
+  jassert(numOpenVisualisers >= 0);
+  const auto isAnyVisualiserOpen = numOpenVisualisers > 0;
+  visualiserFeed.setActive(isAnyVisualiserOpen);
+  synth.setPublishingStringLevels(isAnyVisualiserOpen);
+  liveSynth.setPublishingStringLevels(isAnyVisualiserOpen);
+}
+
+bool PianoMannAudioProcessor::startRecording(const File &audioFile) {
+  jassert(canRecord());
+  return recorder.start(audioFile);
+}
+
+bool PianoMannAudioProcessor::startRenderingMidiFile(const File &midiFile) {
+  PianoMannOfflineRenderer::Settings settings;
+  if (getSampleRate() > 0.0) {
+    settings.sampleRate = getSampleRate();
+  }
+  settings.numChannels = jmax(1, getMainBusNumOutputChannels());
+  settings.excitationSeed = excitationSeed;
+  settings.isStrikeVariationEnabled = isStrikeVariationEnabled;
+  settings.isVelocityShapingEnabled = isVelocityShapingEnabled;
+  settings.isHammerModelEnabled = isHammerModelEnabled;
+  settings.tuning = tuning;
+  settings.voicing = voicing;
+  return offlineRenderer.start(
+      midiFile, PianoMannOfflineRenderer::getDefaultFile(midiFile), settings);
+}
 
-  synth.renderNextBlock(buffer, midiMessages, 0, numSamples);
+void PianoMannAudioProcessor::setRenderCacheEnabled(bool shouldCache) {
+  isRenderCacheEnabled = shouldCache;
+  synth.setRenderCacheEnabled(isRenderCacheEnabled);
+  liveSynth.setRenderCacheEnabled(isRenderCacheEnabled);
+}
+
+void PianoMannAudioProcessor::setCompactDelayLineEnabled(bool shouldCompact) {
+  isCompactDelayLineEnabled = shouldCompact;
+  synth.setCompactDelayLineEnabled(isCompactDelayLineEnabled);
+  liveSynth.setCompactDelayLineEnabled(isCompactDelayLineEnabled);
+}
+
+void PianoMannAudioProcessor::setTuning(const PianoMannTuning &newTuning) {
+  tuning = newTuning;
+  synth.setTuning(tuning, *voicing);
+  liveSynth.setTuning(tuning, *voicing);
+}
+
+Result PianoMannAudioProcessor::setVoicingFile(const File &file) {
+  const auto result = voicingWatcher.watch(file);
+  if (file == File()) {
+    setVoicing(PianoMannVoicing::getBuiltIn());
+  }
+  return result;
+}
 
-  dsp::AudioBlock<float> block(buffer);
-  const dsp::ProcessContextReplacing<float> processContext(block);
-  synthPostProcessor.process(processContext);
+void PianoMannAudioProcessor::setVoicing(
+    std::shared_ptr<const PianoMannVoicing> newVoicing) {
+  voicing = std::move(newVoicing);
+  synth.setTuning(tuning, *voicing);
+  liveSynth.setTuning(tuning, *voicing);
+  for (auto &synthPostProcessor : synthPostProcessors) {
+    synthPostProcessor.setVoicing(*voicing);
+  }
 }
 
 //==============================================================================
@@ -167,19 +600,63 @@ AudioProcessorEditor *PianoMannAudioProcessor::createEditor() {
 }
 
 //==============================================================================
+static const Identifier kStateTag("PianoMannState");
+static const Identifier kRenderAheadAttribute("renderAhead");
+static const Identifier kQuantumBufferingAttribute("quantumBuffering");
+static const Identifier kExcitationSeedAttribute("excitationSeed");
+static const Identifier kRenderCacheAttribute("renderCache");
+static const Identifier kCompactDelayLineAttribute("compactDelayLine");
+static const Identifier kStrikeVariationAttribute("strikeVariation");
+static const Identifier kVelocityShapingAttribute("velocityShaping");
+static const Identifier kHammerModelAttribute("hammerModel");
+static const Identifier kTuningAttribute("tuning");
+static const Identifier kVoicingFileAttribute("voicingFile");
+
 void PianoMannAudioProcessor::getStateInformation(MemoryBlock &destData) {
-  // You should use this method to store your parameters in the memory block.
-  // You could do that either as raw data, or use the XML or ValueTree classes
-  // as intermediaries to make it easy to save and load complex data.
-  ignoreUnused(destData);
+  XmlElement state(kStateTag);
+  state.setAttribute(kRenderAheadAttribute, isRenderAheadEnabled());
+  state.setAttribute(kQuantumBufferingAttribute, isQuantumBufferingEnabled());
+  state.setAttribute(kExcitationSeedAttribute, String(excitationSeed));
+  state.setAttribute(kRenderCacheAttribute, isRenderCacheEnabled);
+  state.setAttribute(kCompactDelayLineAttribute, isCompactDelayLineEnabled);
+  state.setAttribute(kStrikeVariationAttribute, isStrikeVariationEnabled);
+  state.setAttribute(kVelocityShapingAttribute, isVelocityShapingEnabled);
+  state.setAttribute(kHammerModelAttribute, isHammerModelEnabled);
+  state.setAttribute(kTuningAttribute, tuning.toString());
+  state.setAttribute(kVoicingFileAttribute, getVoicingFile().getFullPathName());
+  copyXmlToBinary(state, destData);
 }
 
 void PianoMannAudioProcessor::setStateInformation(const void *data,
                                                   int sizeInBytes) {
-  // You should use this method to restore your parameters from this memory
-  // block, whose contents will have been created by the getStateInformation()
-  // call.
-  ignoreUnused(data, sizeInBytes);
+  const auto state = getXmlFromBinary(data, sizeInBytes);
+  if (state == nullptr || !state->hasTagName(kStateTag.toString())) {
+    return;
+  }
+  setRenderAheadEnabled(state->getBoolAttribute(kRenderAheadAttribute));
+  setQuantumBufferingEnabled(
+      state->getBoolAttribute(kQuantumBufferingAttribute));
+  if (state->hasAttribute(kExcitationSeedAttribute)) {
+    setExcitationSeed(state->getStringAttribute(kExcitationSeedAttribute)
+                          .getLargeIntValue());
+  }
+  setRenderCacheEnabled(state->getBoolAttribute(kRenderCacheAttribute));
+  setCompactDelayLineEnabled(
+      state->getBoolAttribute(kCompactDelayLineAttribute));
+  setStrikeVariationEnabled(
+      state->getBoolAttribute(kStrikeVariationAttribute));
+  setVelocityShapingEnabled(
+      state->getBoolAttribute(kVelocityShapingAttribute));
+  setHammerModelEnabled(state->getBoolAttribute(kHammerModelAttribute));
+  setTuning(state->hasAttribute(kTuningAttribute)
+                ? PianoMannTuning::fromString(
+                      state->getStringAttribute(kTuningAttribute))
+                : PianoMannTuning::equalTemperament());
+  // A voicing file that has gone missing is still watched, and heard as soon
+  // as it is back.
+  const auto voicingPath = state->getStringAttribute(kVoicingFileAttribute);
+  setVoicingFile(File::isAbsolutePath(voicingPath) ? File(voicingPath)
+                                                   : File());
 }
 
 //==============================================================================
@@ -10,21 +10,141 @@
 
 #pragma once
 
-#include "PianoMannButterworthLowPassFilter.h"
+#include "PianoMannBackgroundPreparation.h"
+#include "PianoMannDspKernels.h"
+#include "PianoMannKeyboardBridge.h"
+#include "PianoMannOfflineRenderer.h"
+#include "PianoMannPostFilter.h"
+#include "PianoMannQuantumBuffer.h"
+#include "PianoMannQualityGovernor.h"
+#include "PianoMannRecorder.h"
+#include "PianoMannRenderAhead.h"
+#include "PianoMannRenderCache.h"
+#include "PianoMannSynthesiser.h"
+#include "PianoMannTrace.h"
+#include "PianoMannTuning.h"
+#include "PianoMannVisualiserFeed.h"
+#include "PianoMannVoicing.h"
 #include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
 
 //==============================================================================
 /**
  */
 class PianoMannAudioProcessor : public AudioProcessor {
 public:
+  /**
+   * The state of the on-screen keyboard, for the message thread only, see
+   * `PianoMannKeyboardBridge`.
+   */
   MidiKeyboardState keyboardState;
 
 private:
-  Synthesiser synth;
-  void initializeSynth();
-  dsp::ProcessorChain<PianoMannButterworthLowPassFilter<5000, 17>>
-      synthPostProcessor;
+  PianoMannKeyboardBridge keyboardBridge{keyboardState};
+
+  PianoMannSynthesiser synth;
+  void initializeSynth(PianoMannSynthesiser &synthToInitialize);
+
+  /**
+   * The main output plus one optional output per register. A register whose output is disabled
+   * is mixed into the main output.
+   */
+  static constexpr int kNumOutputBuses = 1 + PianoMannSynthesiser::kNumRegisters;
+  std::array<PianoMannPostFilter, kNumOutputBuses> synthPostProcessors;
+  void routeRegistersToOutputBuses();
+  void processPostFilters(AudioBuffer<float> &buffer);
+
+  /**
+   * In render-ahead mode, `synth` is rendered ahead of time on a background thread. Notes played
+   * live are rendered by `liveSynth` on the audio thread instead so they are not delayed.
+   */
+  PianoMannRenderAhead renderAhead{synth};
+  PianoMannSynthesiser liveSynth;
+  std::atomic<bool> isRenderAheadRequested{false};
+  bool isRenderingAhead = false;
+  /**
+   * Which notes were started on `liveSynth`, so their note-offs follow them there.
+   */
+  std::bitset<128> liveNotes;
+  MidiBuffer liveMidi;
+  void processBlockRenderingAhead(AudioBuffer<float> &buffer,
+                                  MidiBuffer &midiMessages);
+  /**
+   * Whether the host is playing back pre-recorded material, as opposed to a performer playing
+   * live or recording.
+   */
+  bool isHostPlayingBack();
+
+  /**
+   * Otherwise, `synth` can be rendered in whole quanta behind `quantumBuffer`.
+   */
+  PianoMannQuantumBuffer quantumBuffer;
+  std::atomic<bool> isQuantumBufferingRequested{false};
+  bool isBufferingQuanta = false;
+
+  int64 excitationSeed = kDefaultExcitationSeed;
+
+  bool isRenderCacheEnabled = false;
+  bool isCompactDelayLineEnabled = false;
+  bool isStrikeVariationEnabled = true;
+  bool isVelocityShapingEnabled = true;
+  bool isHammerModelEnabled = true;
+  PianoMannTuning tuning = PianoMannTuning::equalTemperament();
+
+  /**
+   * The voicing of the strings and the post filter, from the watched voicing file if there is
+   * one. Only the message thread swaps it, and the audio thread only ever sees copies of what it
+   * holds, handed over by `PianoMannSynthesiser::setTuning` and `PianoMannPostFilter::setVoicing`.
+   */
+  std::shared_ptr<const PianoMannVoicing> voicing =
+      PianoMannVoicing::getBuiltIn();
+  PianoMannVoicing::Watcher voicingWatcher{
+      [this](std::shared_ptr<const PianoMannVoicing> loadedVoicing) {
+        setVoicing(std::move(loadedVoicing));
+      }};
+  void setVoicing(std::shared_ptr<const PianoMannVoicing> newVoicing);
+
+  /**
+   * Builds what is expensive to prepare for a sample rate without stalling the host. The render
+   * cache file is read as part of it, through `renderCacheReader`.
+   */
+  PianoMannBackgroundPreparation preparation;
+  std::unique_ptr<PianoMannRenderCache::Reader> renderCacheReader;
+  void startBackgroundPreparation(double sampleRate);
+
+  PianoMannRecorder recorder;
+  PianoMannOfflineRenderer offlineRenderer;
+
+  PianoMannVisualiserFeed visualiserFeed;
+  int numOpenVisualisers = 0;
+
+  /**
+   * Whether there was an offline render since the trace was last exported, see `PianoMannTrace`.
+   */
+  bool hasRenderedOfflineSinceTraceExport = false;
+
+  PianoMannQualityGovernor qualityGovernor;
+  void applyQualityTier(int tier);
+  /**
+   * The current tier of `qualityGovernor`, readable from any thread.
+   */
+  std::atomic<int> qualityTier{0};
+  AudioParameterInt *qualityTierParameter;
+  /**
+   * Copies `qualityTier` into `qualityTierParameter` from the message thread. Notifying the host
+   * takes the parameter's listener locks, so the audio thread leaves it alone.
+   */
+  class QualityTierReporter;
+  std::unique_ptr<QualityTierReporter> qualityTierReporter;
+  /**
+   * The tier pinned by `setPinnedQualityTier`, as requested and as in effect since the last
+   * `prepareToPlay`.
+   */
+  std::atomic<int> requestedPinnedQualityTier{kAdaptiveQualityTier};
+  int pinnedQualityTier = kAdaptiveQualityTier;
 
 public:
   //==============================================================================
@@ -41,6 +161,196 @@ public:
 
   void processBlock(AudioBuffer<float> &, MidiBuffer &) override;
 
+  /**
+   * The quality tier currently chosen by the governor, 0 being full quality.
+   */
+  int getQualityTier() const { return qualityTier.load(); }
+
+  /**
+   * The instruction set the DSP kernels were built for, as picked when the plugin was created,
+   * see `PianoMannDspKernels`.
+   */
+  const char *getIsaName() const {
+    return PianoMannDspKernels::getIsaName(
+        PianoMannDspKernels::getKernels().isa);
+  }
+
+  /**
+   * Holds the quality at `tier` rather than leaving it to the governor, or leaves it to the
+   * governor again given `kAdaptiveQualityTier`. Benchmarks pin it to measure one tier at a time.
+   * The tier is pinned the next time the host prepares the plugin.
+   */
+  static constexpr int kAdaptiveQualityTier = -1;
+  void setPinnedQualityTier(int tier);
+  int getPinnedQualityTier() const { return requestedPinnedQualityTier.load(); }
+
+  /**
+   * See `PianoMannSynthesiser::getRetirementStats` and `getAttackStats`, across both
+   * synthesisers. Call once processing has stopped.
+   */
+  PianoMannSynthesiser::RetirementStats getRetirementStats() const;
+  PianoMannSynthesiser::AttackStats getAttackStats() const;
+
+  /**
+   * Whether the strings and filters for the current sample rate have been built in the
+   * background since `prepareToPlay`. Notes played before then are held back.
+   */
+  bool isBackgroundPreparationFinished() const {
+    return preparation.isPrepared();
+  }
+
+  /**
+   * Opts in to rendering ahead of the audio callback at the cost of added latency. The mode
+   * switches the next time the host prepares the plugin. Until then the latency reported is still
+   * that of the mode running, since that is what the audio is delayed by.
+   */
+  void setRenderAheadEnabled(bool shouldRenderAhead);
+  bool isRenderAheadEnabled() const { return isRenderAheadRequested.load(); }
+  /**
+   * The number of callbacks that found less audio rendered ahead than they needed since the host
+   * last prepared the plugin, see `PianoMannRenderAhead::getNumUnderruns`.
+   */
+  int getNumRenderAheadUnderruns() const { return renderAhead.getNumUnderruns(); }
+
+  /**
+   * Opts in to rendering and post-filtering in whole quanta regardless of the host's block size,
+   * at the cost of `PianoMannQuantumBuffer::kLatencySamples` of latency. Rendering ahead already
+   * renders in whole quanta, so this only matters without it. The mode, and the latency reported,
+   * switch the next time the host prepares the plugin.
+   */
+  void setQuantumBufferingEnabled(bool shouldBuffer);
+  bool isQuantumBufferingEnabled() const {
+    return isQuantumBufferingRequested.load();
+  }
+
+  /**
+   * The seed of the excitation noise, so renders are reproducible across runs and instances. A
+   * new seed takes effect the next time the host prepares the plugin.
+   */
+  static constexpr int64 kDefaultExcitationSeed = 0x5069616e6f;
+  void setExcitationSeed(int64 newExcitationSeed);
+  int64 getExcitationSeed() const { return excitationSeed; }
+
+  /**
+   * Gives every strike its own noise, and softer strikes a duller tone. Both are on for new
+   * instances, and off for sessions saved before they existed so those keep their sound. Either
+   * keeps strikes out of the render cache, see `setRenderCacheEnabled`.
+   */
+  void setStrikeVariationEnabled(bool shouldVary);
+  bool getStrikeVariationEnabled() const { return isStrikeVariationEnabled; }
+  void setVelocityShapingEnabled(bool shouldShape);
+  bool getVelocityShapingEnabled() const { return isVelocityShapingEnabled; }
+
+  /**
+   * Strikes the strings with a nonlinear felt hammer model rather than a burst of noise, see
+   * `PianoMannVoice::setHammerModelEnabled`. Velocity shaping then comes from the hammer itself.
+   * On for new instances and off for older sessions, like the settings above, and likewise keeps
+   * strikes out of the render cache.
+   */
+  void setHammerModelEnabled(bool shouldStrike);
+  bool getHammerModelEnabled() const { return isHammerModelEnabled; }
+
+  /**
+   * Opts in to playing back unmodulated strikes from a per-note cache of their waveform, which
+   * persists on disk between sessions. The cache is recorded as notes are played and is loaded
+   * and saved when the host prepares and releases the plugin.
+   *
+   * Only identical strikes can be cached, which means strike variation, velocity shaping and the
+   * hammer model must all be off. All three are on in a new instance, so there the cache records
+   * nothing until they are turned off. It is meant for sessions that trade those for the cheapest
+   * strikes, such as older sessions, which load with them off.
+   */
+  void setRenderCacheEnabled(bool shouldCache);
+  bool getRenderCacheEnabled() const { return isRenderCacheEnabled; }
+
+  /**
+   * Opts in to keeping ringing strings in half precision, for sessions with many instances where
+   * the strings no longer fit in the caches, see `PianoMannVoice::setCompactDelayLineEnabled`.
+   * Takes effect when the host next prepares the plugin.
+   */
+  void setCompactDelayLineEnabled(bool shouldCompact);
+  bool getCompactDelayLineEnabled() const { return isCompactDelayLineEnabled; }
+
+  /**
+   * Retunes the piano without preparing it again. Each string switches to its new pitch the next
+   * time it is struck, so strings already ringing carry on undisturbed. Called from the message
+   * thread.
+   */
+  void setTuning(const PianoMannTuning &newTuning);
+  const PianoMannTuning &getTuning() const { return tuning; }
+
+  /**
+   * Voices the piano from a voicing file, see `PianoMannVoicing`, and keeps watching it so every
+   * change to it is heard from the next strike of each string, without preparing the plugin again.
+   * A file that cannot be loaded yet is still watched. An empty `File` goes back to the built-in
+   * voicing. Called from the message thread.
+   */
+  Result setVoicingFile(const File &file);
+  const File &getVoicingFile() const { return voicingWatcher.getWatchedFile(); }
+  /**
+   * Whether the voicing file could be loaded when it last changed. Otherwise the piano keeps the
+   * voicing it had.
+   */
+  const Result &getVoicingFileResult() const {
+    return voicingWatcher.getLastResult();
+  }
+
+  /**
+   * Recording takes is a feature of the standalone app. Hosts have their own means to record.
+   */
+  bool canRecord() const { return wrapperType == wrapperType_Standalone; }
+  /**
+   * Starts recording the main output and incoming MIDI, see `PianoMannRecorder::start`. Stopped
+   * by `stopRecording` or when the device is reconfigured.
+   */
+  bool startRecording(const File &audioFile);
+  void stopRecording() { recorder.stop(); }
+  bool isRecording() const { return recorder.isRecordingInProgress(); }
+
+  /**
+   * Renders a MIDI file at full quality with the current settings, on every core, to a WAV file
+   * next to it. See `PianoMannOfflineRenderer`. Returns whether the MIDI file could be read.
+   */
+  bool startRenderingMidiFile(const File &midiFile);
+  bool isRenderingMidiFile() const { return offlineRenderer.isRendering(); }
+  /**
+   * How the last render ended, see `PianoMannOfflineRenderer::getLastResult`.
+   */
+  const PianoMannOfflineRenderer &getMidiFileRenderer() const {
+    return offlineRenderer;
+  }
+
+  /**
+   * Visualisers register themselves while open, and the audio thread only feeds them while any
+   * are. Called from the message thread.
+   */
+  void setVisualiserOpen(bool isOpen);
+  /**
+   * Likewise for keyboards showing `keyboardState`.
+   */
+  void setKeyboardShown(bool isShown) {
+    keyboardBridge.setKeyboardShown(isShown);
+  }
+
+  /**
+   * In builds with tracing, offline renders export their trace when the host releases the
+   * plugin, and the standalone app exports on request.
+   */
+  bool exportTrace(const File &file) {
+    return PianoMannTrace::exportChromeTrace(file);
+  }
+  const PianoMannVisualiserFeed &getVisualiserFeed() const {
+    return visualiserFeed;
+  }
+  /**
+   * The level of the string of a note across both synthesisers, see
+   * `PianoMannSynthesiser::getStringLevel`.
+   */
+  float getStringLevel(int midiNoteNumber) const {
+    return jmax(synth.getStringLevel(midiNoteNumber),
+                liveSynth.getStringLevel(midiNoteNumber));
+  }
+
   //==============================================================================
   AudioProcessorEditor *createEditor() override;
   bool hasEditor() const override;
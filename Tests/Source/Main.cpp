@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 20 Oct 2026 2:14:37pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTestHelpers.h"
+#include <iostream>
+
+namespace {
+constexpr auto kUsage =
+    "Usage: PianoMannTests [options]\n"
+    "\n"
+    "Runs every PianoMann unit test, and exits with a non-zero status if any\n"
+    "of them fails.\n"
+    "\n"
+    "  --data <folder>           the Tests/Data folder, default found by\n"
+    "                            walking up from this executable\n"
+    "  --update-goldens          writes the golden renders in Data/Golden\n"
+    "                            instead of checking against them\n";
+
+/**
+ * Prints every result as it comes, which a console shows while the longer tests run.
+ */
+class PianoMannTestRunner : public UnitTestRunner {
+  void logMessage(const String &message) override {
+    std::cout << message << std::endl;
+  }
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  // The processor's voicing watcher is a timer, which needs a message manager.
+  const ScopedJuceInitialiser_GUI juceInitialiser;
+
+  StringArray arguments;
+  for (auto index = 1; index < argc; ++index) {
+    arguments.add(argv[index]);
+  }
+  if (arguments.contains("--help")) {
+    std::cout << kUsage;
+    return 0;
+  }
+  const auto dataIndex = arguments.indexOf("--data");
+  if (dataIndex >= 0) {
+    if (dataIndex + 1 >= arguments.size()) {
+      std::cerr << kUsage;
+      return 2;
+    }
+    PianoMannTestHelpers::setDataDirectory(
+        File::getCurrentWorkingDirectory().getChildFile(
+            arguments[dataIndex + 1]));
+  }
+  PianoMannTestHelpers::setUpdatingGoldens(
+      arguments.contains("--update-goldens"));
+  if (!PianoMannTestHelpers::getDataDirectory().isDirectory()) {
+    std::cerr << "Cannot find Tests/Data, pass it with --data" << std::endl;
+    return 2;
+  }
+
+  PianoMannTestRunner runner;
+  runner.setAssertOnFailure(false);
+  runner.runTestsInCategory(PianoMannTestHelpers::kCategory);
+
+  auto numFailures = 0;
+  for (auto index = 0; index < runner.getNumResults(); ++index) {
+    numFailures += runner.getResult(index)->failures;
+  }
+  return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    PianoMannOfflineRendererTests.cpp
+    Created: 20 Oct 2026 7:31:52pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannOfflineRenderer.h"
+#include "PianoMannTestHelpers.h"
+#include <limits>
+
+namespace {
+constexpr auto kSampleRate = 48000.0;
+constexpr auto kNumPhrases = 8;
+/**
+ * Short enough for several chunks between the phrases, which rest long enough for every string to
+ * die away.
+ */
+constexpr auto kMinChunkSeconds = 0.5;
+constexpr auto kRestSeconds = 1.5;
+
+/**
+ * Phrases of notes and chords across the keyboard, some under the sustain pedal and some
+ * overlapping the next, with rests in between.
+ */
+MidiMessageSequence perform(Random &random) {
+  constexpr auto kSustainPedalController = 0x40;
+  MidiMessageSequence midi;
+  auto seconds = 0.0;
+  for (auto phrase = 0; phrase < kNumPhrases; ++phrase) {
+    const auto isPedalled = random.nextBool();
+    if (isPedalled) {
+      midi.addEvent(
+          MidiMessage::controllerEvent(1, kSustainPedalController, 127),
+          seconds);
+    }
+    const auto numStrikes = 2 + random.nextInt(6);
+    for (auto strike = 0; strike < numStrikes; ++strike) {
+      const auto numChordNotes = 1 + random.nextInt(3);
+      for (auto chordNote = 0; chordNote < numChordNotes; ++chordNote) {
+        const auto note = 36 + random.nextInt(60);
+        const auto velocity = 0.2f + 0.8f * random.nextFloat();
+        midi.addEvent(MidiMessage::noteOn(1, note, velocity), seconds);
+        midi.addEvent(MidiMessage::noteOff(1, note),
+                      seconds + 0.05 + 0.4 * random.nextDouble());
+      }
+      seconds += 0.05 + 0.2 * random.nextDouble();
+    }
+    seconds += 0.5;
+    if (isPedalled) {
+      midi.addEvent(
+          MidiMessage::controllerEvent(1, kSustainPedalController, 0), seconds);
+    }
+    // Now and then the next phrase comes too soon to cut before it.
+    seconds += random.nextInt(4) == 0 ? 0.1 : kRestSeconds;
+  }
+  midi.sort();
+  midi.updateMatchedPairs();
+  return midi;
+}
+} // namespace
+
+/**
+ * Renders random performances in parallel chunks and in a single chunk, which is rendering them
+ * in order, and checks that the two are the same sample for sample.
+ */
+class PianoMannOfflineRendererTests : public UnitTest {
+public:
+  PianoMannOfflineRendererTests()
+      : UnitTest("Offline rendering", PianoMannTestHelpers::kCategory) {}
+
+  void runTest() override {
+    auto random = getRandom();
+    for (const auto isHammerModelEnabled : {false, true}) {
+      beginTest(String("Parallel matches serial, ") +
+                (isHammerModelEnabled ? "hammered" : "struck with noise"));
+      PianoMannOfflineRenderer::Settings settings;
+      settings.sampleRate = kSampleRate;
+      settings.excitationSeed =
+          PianoMannAudioProcessor::kDefaultExcitationSeed;
+      settings.isHammerModelEnabled = isHammerModelEnabled;
+      const auto midi = perform(random);
+
+      auto serialSettings = settings;
+      serialSettings.numThreads = 1;
+      serialSettings.minChunkSeconds = std::numeric_limits<double>::max();
+      PianoMannOfflineRenderer::Report serialReport;
+      const auto serial = render(midi, serialSettings, serialReport);
+      expectEquals(serialReport.numChunks, 1, "Serial chunks");
+
+      // A single thread only ever has a couple of chunks in flight, so the
+      // later chunks are queued as the earlier ones are written.
+      for (const auto numThreads : {1, 4}) {
+        auto parallelSettings = settings;
+        parallelSettings.numThreads = numThreads;
+        parallelSettings.minChunkSeconds = kMinChunkSeconds;
+        PianoMannOfflineRenderer::Report parallelReport;
+        const auto parallel = render(midi, parallelSettings, parallelReport);
+        expectGreaterThan(parallelReport.numChunks, 1, "Parallel chunks");
+        // Every cut is at a long rest, where the strings are silent for
+        // certain. A repaired chunk is rendered in order after all.
+        expectEquals(parallelReport.numRepairedChunks, 0, "Repaired chunks");
+
+        expectEquals(parallel.getNumSamples(), serial.getNumSamples(),
+                     "Length");
+        if (parallel.getNumSamples() == serial.getNumSamples()) {
+          const auto difference =
+              PianoMannTestHelpers::getMaxDifference(parallel, serial);
+          expectEquals(difference, 0.f, "Parallel differs from serial");
+        }
+      }
+    }
+  }
+
+private:
+  static AudioBuffer<float>
+  render(const MidiMessageSequence &midi,
+         const PianoMannOfflineRenderer::Settings &settings,
+         PianoMannOfflineRenderer::Report &report) {
+    AudioBuffer<float> output(settings.numChannels, 0);
+    auto numSamples = 0;
+    report = PianoMannOfflineRenderer::render(
+        midi, settings, [&](const AudioBuffer<float> &block) {
+          output.setSize(settings.numChannels,
+                         numSamples + block.getNumSamples(), true);
+          for (auto channel = 0; channel < settings.numChannels; ++channel) {
+            output.copyFrom(channel, numSamples, block, channel, 0,
+                            block.getNumSamples());
+          }
+          numSamples += block.getNumSamples();
+        });
+    return output;
+  }
+};
+
+static PianoMannOfflineRendererTests offlineRendererTests;
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+    PianoMannRealtimeSafetyFuzzTests.cpp
+    Created: 20 Oct 2026 5:47:09pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTestHelpers.h"
+#include <cmath>
+
+namespace {
+constexpr double kSampleRates[] = {22050.0, 44100.0, 48000.0, 88200.0,
+                                   96000.0};
+/**
+ * The largest block the host announces in each round. Blocks within a round take any size up to
+ * it, so odd sizes and single samples come up in every round.
+ */
+constexpr int kMaxBlockSizes[] = {1, 3, 17, 64, 127, 480, 512, 1025};
+constexpr auto kNumRounds = 16;
+constexpr auto kNumBlocksPerRound = 600;
+constexpr auto kMaxEventsPerBlock = 6;
+/**
+ * Hosts reserve their MIDI buffers up front, so adding events in the callback does not allocate.
+ */
+constexpr auto kMidiBufferBytes = 4096;
+
+void addRandomEvent(Random &random, MidiBuffer &midi, int numSamples) {
+  const auto channel = 1 + random.nextInt(16);
+  const auto samplePosition = random.nextInt(numSamples);
+  const auto noteNumber = random.nextInt(128);
+  const auto value = random.nextInt(128);
+  switch (random.nextInt(8)) {
+  case 0:
+  case 1:
+    midi.addEvent(
+        MidiMessage::noteOn(channel, noteNumber, static_cast<uint8>(value)),
+        samplePosition);
+    break;
+  case 2:
+  case 3:
+    midi.addEvent(MidiMessage::noteOff(channel, noteNumber), samplePosition);
+    break;
+  case 4: {
+    // The pedals, then anything else including all notes off.
+    constexpr int kControllers[] = {64, 66, 67, 120, 123};
+    const auto controller = random.nextBool()
+                                ? kControllers[random.nextInt(5)]
+                                : random.nextInt(128);
+    midi.addEvent(MidiMessage::controllerEvent(channel, controller, value),
+                  samplePosition);
+    break;
+  }
+  case 5:
+    midi.addEvent(MidiMessage::pitchWheel(channel, random.nextInt(16384)),
+                  samplePosition);
+    break;
+  case 6:
+    midi.addEvent(MidiMessage::channelPressureChange(channel, value),
+                  samplePosition);
+    break;
+  default: {
+    uint8 sysex[32];
+    const auto size = 1 + random.nextInt(static_cast<int>(sizeof(sysex)));
+    for (auto index = 0; index < size; ++index) {
+      sysex[index] = static_cast<uint8>(random.nextInt(128));
+    }
+    midi.addEvent(MidiMessage::createSysExMessage(sysex, size), samplePosition);
+    break;
+  }
+  }
+}
+} // namespace
+
+/**
+ * Plays random MIDI through the processor in blocks of random sizes, and prepares it again at
+ * another sample rate, in another mode, every round. The test runner is built with
+ * `PIANOMANN_CHECK_REALTIME_SAFETY`, so anything in the audio callback that allocates, locks a
+ * mutex it was not allowed to, sleeps or does I/O aborts the run with what it did.
+ */
+class PianoMannRealtimeSafetyFuzzTests : public UnitTest {
+public:
+  PianoMannRealtimeSafetyFuzzTests()
+      : UnitTest("Realtime safety fuzzing", PianoMannTestHelpers::kCategory) {}
+
+  void runTest() override {
+    beginTest("Checks enabled");
+    expect(PIANOMANN_CHECK_REALTIME_SAFETY != 0,
+           "The tests must be built with PIANOMANN_CHECK_REALTIME_SAFETY=1");
+
+    beginTest("Random MIDI, block sizes and sample rates");
+    auto random = getRandom();
+    PianoMannAudioProcessor processor;
+    // Keeps the feeds to the editor running as well.
+    processor.setVisualiserOpen(true);
+    processor.setKeyboardShown(true);
+    for (auto round = 0; round < kNumRounds; ++round) {
+      playRound(processor, random);
+    }
+    processor.setKeyboardShown(false);
+    processor.setVisualiserOpen(false);
+
+    beginTest("Preparing again at the same rate");
+    testSameRatePrepare();
+  }
+
+private:
+  /**
+   * Hosts prepare again at the same rate when the block size or the latency changes. The strings
+   * are rebuilt in the background either way, so none may still be ringing, and notes played
+   * meanwhile wait for their string.
+   */
+  void testSameRatePrepare() {
+    constexpr auto kSampleRate = 48000.0;
+    constexpr auto kSustainPedalController = 0x40;
+    constexpr int kChord[] = {48, 60, 64, 67};
+    auto processor =
+        PianoMannTestHelpers::createPreparedProcessor(kSampleRate, 256);
+    processor->setKeyboardShown(true);
+    MidiBuffer midi;
+    midi.ensureSize(kMidiBufferBytes);
+    midi.addEvent(MidiMessage::controllerEvent(1, kSustainPedalController, 127),
+                  0);
+    for (const auto note : kChord) {
+      midi.addEvent(MidiMessage::noteOn(1, note, 0.8f), 0);
+    }
+    playBlocks(*processor, midi, 256, 32);
+    for (const auto note : kChord) {
+      expectGreaterThan(processor->getStringLevel(note), 0.f,
+                        "Note " + String(note) + " is not ringing");
+    }
+
+    // The block size changes and the pedal stays down.
+    processor->setRateAndBufferSizeDetails(kSampleRate, 128);
+    processor->prepareToPlay(kSampleRate, 128);
+    midi.clear();
+    playBlocks(*processor, midi, 128, 1);
+    for (const auto note : kChord) {
+      expectEquals(processor->getStringLevel(note), 0.f,
+                   "Note " + String(note) + " rang on after preparing");
+    }
+
+    midi.addEvent(MidiMessage::noteOn(1, kChord[0], 0.8f), 0);
+    playBlocks(*processor, midi, 128, 1);
+    while (!processor->isBackgroundPreparationFinished()) {
+      Thread::sleep(1);
+    }
+    midi.clear();
+    expect(playBlocks(*processor, midi, 128, 32), "The output was not finite");
+    expectGreaterThan(processor->getStringLevel(kChord[0]), 0.f,
+                      "A note played while preparing never started");
+    processor->setKeyboardShown(false);
+    processor->releaseResources();
+  }
+
+  /**
+   * Plays `midi` in the first of `numBlocks` blocks, returning whether the output was finite.
+   */
+  static bool playBlocks(PianoMannAudioProcessor &processor,
+                         const MidiBuffer &midi, int blockSize, int numBlocks) {
+    const auto numChannels = jmax(processor.getTotalNumInputChannels(),
+                                  processor.getTotalNumOutputChannels());
+    AudioBuffer<float> block(numChannels, blockSize);
+    MidiBuffer blockMidi;
+    blockMidi.ensureSize(kMidiBufferBytes);
+    auto isOutputFinite = true;
+    for (auto blockIndex = 0; blockIndex < numBlocks; ++blockIndex) {
+      blockMidi.clear();
+      if (blockIndex == 0) {
+        blockMidi.addEvents(midi, 0, blockSize, 0);
+      }
+      processor.processBlock(block, blockMidi);
+      isOutputFinite = isOutputFinite && isFinite(block);
+    }
+    return isOutputFinite;
+  }
+
+  void playRound(PianoMannAudioProcessor &processor, Random &random) {
+    const auto sampleRate = kSampleRates[random.nextInt(
+        static_cast<int>(std::size(kSampleRates)))];
+    const auto maxBlockSize = kMaxBlockSizes[random.nextInt(
+        static_cast<int>(std::size(kMaxBlockSizes)))];
+    processor.setRenderAheadEnabled(random.nextInt(4) == 0);
+    processor.setQuantumBufferingEnabled(random.nextInt(3) == 0);
+    // Mostly left to the governor, whose tier changes happen in the callback.
+    processor.setPinnedQualityTier(
+        random.nextInt(4) == 0
+            ? random.nextInt(PianoMannQualityGovernor::kNumTiers)
+            : PianoMannAudioProcessor::kAdaptiveQualityTier);
+    logMessage(String(sampleRate) + " Hz in blocks of up to " +
+               String(maxBlockSize) +
+               (processor.isRenderAheadEnabled() ? ", rendering ahead" : "") +
+               (processor.isQuantumBufferingEnabled() ? ", in quanta" : ""));
+
+    processor.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+    processor.prepareToPlay(sampleRate, maxBlockSize);
+    expectLatencyOfModes(processor, sampleRate, maxBlockSize);
+    // Notes are also played while the strings are still being built.
+    if (random.nextBool()) {
+      while (!processor.isBackgroundPreparationFinished()) {
+        Thread::sleep(1);
+      }
+    }
+
+    const auto numChannels = jmax(processor.getTotalNumInputChannels(),
+                                  processor.getTotalNumOutputChannels());
+    AudioBuffer<float> block(numChannels, maxBlockSize);
+    MidiBuffer midi;
+    midi.ensureSize(kMidiBufferBytes);
+    auto isOutputFinite = true;
+    // Now and then the host prepares again mid-round at the same rate, as
+    // it does when the latency changes.
+    const auto reprepareBlockIndex =
+        random.nextBool() ? random.nextInt(kNumBlocksPerRound) : -1;
+    for (auto blockIndex = 0; blockIndex < kNumBlocksPerRound; ++blockIndex) {
+      if (blockIndex == reprepareBlockIndex) {
+        // The modes switched in the meantime only change the latency once
+        // the host prepares again.
+        const auto latencySamples = processor.getLatencySamples();
+        processor.setRenderAheadEnabled(random.nextInt(4) == 0);
+        processor.setQuantumBufferingEnabled(random.nextInt(3) == 0);
+        expectEquals(processor.getLatencySamples(), latencySamples,
+                     "Latency before preparing again");
+        processor.prepareToPlay(sampleRate, maxBlockSize);
+        expectLatencyOfModes(processor, sampleRate, maxBlockSize);
+      }
+      const auto numSamples = 1 + random.nextInt(maxBlockSize);
+      AudioBuffer<float> hostBlock(block.getArrayOfWritePointers(), numChannels,
+                                   numSamples);
+      midi.clear();
+      const auto numEvents = random.nextInt(kMaxEventsPerBlock + 1);
+      for (auto event = 0; event < numEvents; ++event) {
+        addRandomEvent(random, midi, numSamples);
+      }
+      // Keys played on the on-screen keyboard between callbacks.
+      if (random.nextInt(32) == 0) {
+        const auto noteNumber = random.nextInt(128);
+        processor.keyboardState.noteOn(1, noteNumber, random.nextFloat());
+        processor.keyboardState.noteOff(1, noteNumber, 0.f);
+      }
+
+      processor.processBlock(hostBlock, midi);
+      isOutputFinite = isOutputFinite && isFinite(hostBlock);
+    }
+    expect(isOutputFinite, "The output was not finite");
+    processor.releaseResources();
+  }
+
+  void expectLatencyOfModes(const PianoMannAudioProcessor &processor,
+                            double sampleRate, int maxBlockSize) {
+    auto latencySamples = 0;
+    if (processor.isRenderAheadEnabled()) {
+      latencySamples =
+          PianoMannRenderAhead::getLatencySamplesFor(sampleRate, maxBlockSize);
+    } else if (processor.isQuantumBufferingEnabled()) {
+      latencySamples = PianoMannQuantumBuffer::kLatencySamples;
+    }
+    expectEquals(processor.getLatencySamples(), latencySamples, "Latency");
+  }
+
+  static bool isFinite(const AudioBuffer<float> &buffer) {
+    for (auto channel = 0; channel < buffer.getNumChannels(); ++channel) {
+      const auto *samples = buffer.getReadPointer(channel);
+      for (auto sample = 0; sample < buffer.getNumSamples(); ++sample) {
+        if (!std::isfinite(samples[sample])) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+};
+
+static PianoMannRealtimeSafetyFuzzTests realtimeSafetyFuzzTests;
@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    PianoMannRegressionTests.cpp
+    Created: 20 Oct 2026 2:14:37pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTestHelpers.h"
+#include <memory>
+
+namespace {
+constexpr double kSampleRates[] = {44100.0, 48000.0, 96000.0};
+/**
+ * Goldens are rendered in blocks of this size, and every other block size must match it.
+ */
+constexpr auto kReferenceBlockSize = 512;
+constexpr int kOtherBlockSizes[] = {1, 7, 64, 257};
+/**
+ * Long enough for the last pedal of every file in `Data/Midi` to be lifted.
+ */
+constexpr auto kRenderSeconds = 1.75;
+
+/**
+ * Splitting blocks differently only moves where the post filter snaps its decaying state to zero.
+ */
+constexpr auto kBlockSizeTolerance = 1.0e-5f;
+bool writeGolden(const File &goldenFile, const AudioBuffer<float> &output,
+                 double sampleRate) {
+  goldenFile.deleteFile();
+  std::unique_ptr<FileOutputStream> stream(goldenFile.createOutputStream());
+  if (stream == nullptr) {
+    return false;
+  }
+  WavAudioFormat format;
+  // The synth goes past full scale, so the goldens are floating point.
+  constexpr auto kBitsPerSample = 32;
+  std::unique_ptr<AudioFormatWriter> writer(format.createWriterFor(
+      stream.get(), sampleRate, 1, kBitsPerSample, {}, 0));
+  if (writer == nullptr) {
+    return false;
+  }
+  // The writer owns the stream now.
+  stream.release();
+  return writer->writeFromAudioSampleBuffer(
+      PianoMannTestHelpers::referToChannel(output, 0), 0,
+      output.getNumSamples());
+}
+} // namespace
+
+/**
+ * Renders every MIDI file in `Data/Midi` through the processor at several sample rates. Checks
+ * that the block size the host picks makes no difference to the output, and that the output still
+ * matches the golden render in `Data/Golden`. After a deliberate change to the sound, run the
+ * tests with `--update-goldens` and listen to the new goldens before committing them.
+ */
+class PianoMannRegressionTests : public UnitTest {
+public:
+  PianoMannRegressionTests()
+      : UnitTest("Regression", PianoMannTestHelpers::kCategory) {}
+
+  void runTest() override {
+    const auto midiDirectory =
+        PianoMannTestHelpers::getDataDirectory().getChildFile("Midi");
+    auto midiFiles =
+        midiDirectory.findChildFiles(File::findFiles, false, "*.mid");
+    midiFiles.sort();
+    beginTest("Corpus");
+    expect(!midiFiles.isEmpty(),
+           "No MIDI files in " + midiDirectory.getFullPathName());
+
+    for (const auto &midiFile : midiFiles) {
+      for (const auto sampleRate : kSampleRates) {
+        beginTest(midiFile.getFileName() + " at " + String(sampleRate) +
+                  " Hz");
+        testMidiFile(midiFile, sampleRate);
+      }
+    }
+  }
+
+private:
+  void testMidiFile(const File &midiFile, double sampleRate) {
+    const auto messages =
+        PianoMannTestHelpers::readMidiFile(midiFile, sampleRate);
+    expect(!messages.empty(), "Could not read " + midiFile.getFullPathName());
+    const auto numSamples = roundToInt(kRenderSeconds * sampleRate);
+
+    const auto output = renderInBlocksOf(messages, sampleRate,
+                                         kReferenceBlockSize, numSamples);
+    for (const auto blockSize : kOtherBlockSizes) {
+      const auto difference = PianoMannTestHelpers::getMaxDifference(
+          output, renderInBlocksOf(messages, sampleRate, blockSize, numSamples));
+      expect(difference <= kBlockSizeTolerance,
+             "Blocks of " + String(blockSize) + " differ from blocks of " +
+                 String(kReferenceBlockSize) + " by " + String(difference));
+    }
+
+    const auto goldenFile =
+        PianoMannTestHelpers::getGoldenFile(midiFile, sampleRate);
+    if (PianoMannTestHelpers::isUpdatingGoldens()) {
+      expect(writeGolden(goldenFile, output, sampleRate),
+             "Could not write " + goldenFile.getFullPathName());
+      logMessage("Wrote " + goldenFile.getFullPathName());
+      return;
+    }
+    AudioBuffer<float> golden;
+    if (!PianoMannTestHelpers::readGolden(goldenFile, golden)) {
+      expect(false, "Could not read " + goldenFile.getFullPathName());
+      return;
+    }
+    expectEquals(golden.getNumSamples(), numSamples, "Golden length");
+    if (golden.getNumSamples() != numSamples) {
+      return;
+    }
+    for (auto channel = 0; channel < output.getNumChannels(); ++channel) {
+      const auto difference = PianoMannTestHelpers::getMaxDifference(
+          PianoMannTestHelpers::referToChannel(output, channel), golden);
+      expect(difference <= PianoMannTestHelpers::kGoldenTolerance,
+             "Channel " + String(channel) + " differs from " +
+                 goldenFile.getFileName() + " by " + String(difference));
+    }
+  }
+
+  static AudioBuffer<float>
+  renderInBlocksOf(const std::vector<PianoMannTestHelpers::TimedMessage> &messages,
+                   double sampleRate, int blockSize, int numSamples) {
+    const auto processor =
+        PianoMannTestHelpers::createPreparedProcessor(sampleRate, blockSize);
+    return PianoMannTestHelpers::render(*processor, messages, blockSize,
+                                        numSamples);
+  }
+};
+
+static PianoMannRegressionTests regressionTests;
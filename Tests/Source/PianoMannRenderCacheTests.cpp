@@ -0,0 +1,265 @@
+/*
+  ==============================================================================
+
+    PianoMannRenderCacheTests.cpp
+    Created: 22 Oct 2026 2:46:08pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannRenderCache.h"
+#include "PianoMannSynthesiser.h"
+#include "PianoMannTestHelpers.h"
+#include <algorithm>
+#include <memory>
+
+namespace {
+constexpr auto kSampleRate = 48000.0;
+constexpr auto kBlockSize = 512;
+constexpr auto kExcitationSeed = PianoMannAudioProcessor::kDefaultExcitationSeed;
+constexpr auto kNote = 60;
+constexpr auto kOtherNote = 72;
+/**
+ * Strikes are recorded at one velocity and played back at another. Cached samples are scaled by
+ * velocity and back, and a hand-off rebuilds the string from them, each rounding a little.
+ */
+constexpr auto kRecordedVelocity = 0.8f;
+constexpr auto kVelocity = 0.5f;
+constexpr auto kTolerance = 1.0e-4f;
+
+/**
+ * Strings tuned as the processor tunes them, see `PianoMannAudioProcessor`.
+ */
+PianoMannStringTuning tuneString(int midiNote) {
+  return PianoMannVoice::tuneString(
+      *PianoMannVoicing::getBuiltIn(), midiNote,
+      PianoMannTuning::equalTemperament().getFrequency(midiNote), kSampleRate);
+}
+
+/**
+ * A synthesiser whose strikes are all unmodulated, so they can be cached. Its strings are
+ * restored from `reader` where it holds a cache recorded with the same loop, as the processor
+ * does.
+ */
+std::unique_ptr<PianoMannSynthesiser>
+createSynth(bool isRenderCacheEnabled,
+            const PianoMannRenderCache::Reader *reader = nullptr) {
+  auto synth = std::make_unique<PianoMannSynthesiser>();
+  synth->addKeys();
+  synth->setExcitationSeed(kExcitationSeed);
+  synth->setStrikeVariationEnabled(false);
+  synth->setVelocityShapingEnabled(false);
+  synth->setHammerModelEnabled(false);
+  synth->setRenderCacheEnabled(isRenderCacheEnabled);
+  synth->setCurrentPlaybackSampleRate(kSampleRate);
+  for (auto midiNote = PianoMannSound::kMinNote;
+       midiNote <= PianoMannSound::kMaxNote; ++midiNote) {
+    const auto stringTuning = tuneString(midiNote);
+    auto cached = reader != nullptr ? reader->getEntry(midiNote)
+                                    : PianoMannRenderCache::Reader::Entry{};
+    if (!cached.isRecordedWith(stringTuning)) {
+      cached = {};
+    }
+    synth->findVoiceForNote(midiNote)->prepareForCurrentSampleRate(
+        stringTuning, cached.samples, cached.numSamples);
+  }
+  return synth;
+}
+
+/**
+ * Strikes `midiNote`, releases it after `holdSeconds` and renders `numSeconds` in all, in blocks.
+ * Every string is stopped afterwards so the next strike starts afresh.
+ */
+AudioBuffer<float> strike(PianoMannSynthesiser &synth, int midiNote,
+                          float velocity, double holdSeconds,
+                          double numSeconds) {
+  const auto numSamples = roundToInt(numSeconds * kSampleRate);
+  AudioBuffer<float> output(1, numSamples);
+  output.clear();
+  MidiBuffer midi;
+  midi.addEvent(MidiMessage::noteOn(1, midiNote, velocity), 0);
+  midi.addEvent(MidiMessage::noteOff(1, midiNote),
+                roundToInt(holdSeconds * kSampleRate));
+  for (auto startSample = 0; startSample < numSamples;
+       startSample += kBlockSize) {
+    synth.renderNextBlock(output, midi, startSample,
+                          jmin(kBlockSize, numSamples - startSample));
+  }
+  synth.allNotesOff(0, false);
+  return output;
+}
+
+/**
+ * Records a full cache of `midiNote`, which is a second long.
+ */
+void record(PianoMannSynthesiser &synth, int midiNote) {
+  strike(synth, midiNote, kRecordedVelocity, 1.2, 1.3);
+}
+} // namespace
+
+/**
+ * Plays strikes back from the render cache, before and after saving it to a file, and checks
+ * that they sound as if they were synthesised live, including once they hand off to live
+ * synthesis.
+ */
+class PianoMannRenderCacheTests : public UnitTest {
+public:
+  PianoMannRenderCacheTests()
+      : UnitTest("Render cache", PianoMannTestHelpers::kCategory) {}
+
+  void runTest() override {
+    testPlayback();
+
+    const auto directory =
+        File::getSpecialLocation(File::tempDirectory)
+            .getNonexistentChildFile("PianoMannRenderCacheTests", "", false);
+    expect(directory.createDirectory().wasOk(),
+           "Cannot create " + directory.getFullPathName());
+    const auto file = directory.getChildFile("Cache.pmcache");
+    testFile(file);
+    testTruncatedFiles(file);
+    directory.deleteRecursively();
+  }
+
+private:
+  void testPlayback() {
+    beginTest("Playing back from the cache");
+    const auto cachedSynth = createSynth(true);
+    const auto liveSynth = createSynth(false);
+    record(*cachedSynth, kNote);
+    record(*liveSynth, kNote);
+    const auto *voice = cachedSynth->findVoiceForNote(kNote);
+    expectEquals(voice->getRenderCacheValidLength(),
+                 static_cast<int>(voice->getRenderCache().size()),
+                 "Recorded samples");
+    expect(liveSynth->findVoiceForNote(kNote)->getRenderCache().empty(),
+           "The live synthesiser recorded");
+
+    // Released well within the cache, then held past its end.
+    for (const auto holdSeconds : {0.3, 1.5}) {
+      expectSameStrikes(*cachedSynth, *liveSynth, kNote, holdSeconds,
+                        "Held for " + String(holdSeconds) + "s");
+    }
+
+    // The strike really comes from the cache: one recorded at half the
+    // level plays back at half the level until it is released.
+    std::vector<float> halvedCache(voice->getRenderCache());
+    FloatVectorOperations::multiply(halvedCache.data(), 0.5f,
+                                    static_cast<int>(halvedCache.size()));
+    const auto halvedSynth = createSynth(true);
+    auto *halvedVoice = halvedSynth->findVoiceForNote(kNote);
+    halvedVoice->setCurrentPlaybackSampleRate(kSampleRate);
+    halvedVoice->prepareForCurrentSampleRate(
+        tuneString(kNote), halvedCache.data(),
+        static_cast<int>(halvedCache.size()));
+    constexpr auto kHoldSeconds = 0.3;
+    auto halved = strike(*halvedSynth, kNote, kVelocity, kHoldSeconds, 0.2);
+    halved.applyGain(2.f);
+    const auto live = strike(*liveSynth, kNote, kVelocity, kHoldSeconds, 0.2);
+    expectLessOrEqual(PianoMannTestHelpers::getMaxDifference(halved, live),
+                      kTolerance, "A halved cache");
+  }
+
+  void testFile(const File &file) {
+    beginTest("Saving and loading the cache");
+    const auto cachedSynth = createSynth(true);
+    expect(PianoMannRenderCache::save(*cachedSynth, file, kSampleRate,
+                                      kExcitationSeed),
+           "Cannot save an empty cache");
+    expect(!file.exists(), "An empty cache was saved");
+
+    record(*cachedSynth, kNote);
+    record(*cachedSynth, kOtherNote);
+    expect(PianoMannRenderCache::save(*cachedSynth, file, kSampleRate,
+                                      kExcitationSeed),
+           "Cannot save to " + file.getFullPathName());
+    {
+      PianoMannRenderCache::Reader reader(file, kSampleRate, kExcitationSeed);
+      for (const auto midiNote : {kNote, kOtherNote}) {
+        const auto *voice = cachedSynth->findVoiceForNote(midiNote);
+        const auto entry = reader.getEntry(midiNote);
+        expectEquals(entry.numSamples, voice->getRenderCacheValidLength(),
+                     "Samples of note " + String(midiNote));
+        expect(entry.isRecordedWith(voice->getStringTuning()),
+               "Note " + String(midiNote) + " has another loop");
+        expect(entry.samples != nullptr &&
+                   std::equal(entry.samples, entry.samples + entry.numSamples,
+                              voice->getRenderCache().begin()),
+               "Note " + String(midiNote) + " was not saved as recorded");
+      }
+      expect(reader.getEntry(kNote + 1).samples == nullptr,
+             "A note never struck was cached");
+
+      // The first strike after loading is already played back from the
+      // cache, and sounds like a live one.
+      const auto loadedSynth = createSynth(true, &reader);
+      const auto liveSynth = createSynth(false);
+      expectSameStrikes(*loadedSynth, *liveSynth, kNote, 0.3,
+                        "The loaded cache");
+    }
+
+    for (const auto &other :
+         {std::make_pair(kSampleRate * 2.0, kExcitationSeed),
+          std::make_pair(kSampleRate, kExcitationSeed + 1)}) {
+      PianoMannRenderCache::Reader reader(file, other.first, other.second);
+      expect(reader.getEntry(kNote).samples == nullptr,
+             "A cache was read at " + String(other.first) + " Hz with seed " +
+                 String(other.second));
+    }
+  }
+
+  void testTruncatedFiles(const File &file) {
+    beginTest("Truncated cache files");
+    MemoryBlock data;
+    expect(file.loadFileAsData(data), "Cannot read " + file.getFullPathName());
+    const auto truncatedFile = file.getSiblingFile("Truncated.pmcache");
+
+    // Cut short in the last entry, which is the higher note.
+    expect(truncatedFile.replaceWithData(data.getData(), data.getSize() - 4),
+           "Cannot write " + truncatedFile.getFullPathName());
+    {
+      PianoMannRenderCache::Reader reader(truncatedFile, kSampleRate,
+                                          kExcitationSeed);
+      expect(reader.getEntry(kNote).samples != nullptr,
+             "The whole entry was dropped");
+      expect(reader.getEntry(kOtherNote).samples == nullptr,
+             "The truncated entry was read");
+      const auto loadedSynth = createSynth(true, &reader);
+      const auto liveSynth = createSynth(false);
+      expectSameStrikes(*loadedSynth, *liveSynth, kOtherNote, 0.3,
+                        "The truncated note");
+    }
+
+    // Cut short in the header.
+    expect(truncatedFile.replaceWithData(data.getData(), 20),
+           "Cannot write " + truncatedFile.getFullPathName());
+    {
+      PianoMannRenderCache::Reader reader(truncatedFile, kSampleRate,
+                                          kExcitationSeed);
+      for (const auto midiNote : {kNote, kOtherNote}) {
+        expect(reader.getEntry(midiNote).samples == nullptr,
+               "Note " + String(midiNote) + " was read without a header");
+      }
+    }
+  }
+
+  /**
+   * Strikes `midiNote` on both synthesisers and checks they sound the same.
+   */
+  void expectSameStrikes(PianoMannSynthesiser &synth,
+                         PianoMannSynthesiser &expectedSynth, int midiNote,
+                         double holdSeconds, const String &what) {
+    const auto numSeconds = holdSeconds + 0.3;
+    const auto output =
+        strike(synth, midiNote, kVelocity, holdSeconds, numSeconds);
+    const auto expected =
+        strike(expectedSynth, midiNote, kVelocity, holdSeconds, numSeconds);
+    expectGreaterThan(expected.getMagnitude(0, 0, expected.getNumSamples()),
+                      0.1f, what + " is silent");
+    expectLessOrEqual(PianoMannTestHelpers::getMaxDifference(output, expected),
+                      kTolerance, what + " differs");
+  }
+};
+
+static PianoMannRenderCacheTests renderCacheTests;
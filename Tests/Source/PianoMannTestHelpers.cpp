@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    PianoMannTestHelpers.cpp
+    Created: 20 Oct 2026 2:14:37pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTestHelpers.h"
+#include "PianoMannOfflineRenderer.h"
+#include <cmath>
+#include <memory>
+
+namespace PianoMannTestHelpers {
+namespace {
+File dataDirectory;
+bool isUpdatingGoldenRenders = false;
+
+/**
+ * Build folders sit a few levels below `Tests`, which holds `Data`.
+ */
+File findDataDirectory() {
+  for (auto directory =
+           File::getSpecialLocation(File::currentExecutableFile).getParentDirectory();
+       !directory.isRoot(); directory = directory.getParentDirectory()) {
+    const auto candidate = directory.getChildFile("Data");
+    if (candidate.getChildFile("Golden").isDirectory()) {
+      return candidate;
+    }
+  }
+  return {};
+}
+} // namespace
+
+File getDataDirectory() {
+  if (dataDirectory == File()) {
+    dataDirectory = findDataDirectory();
+  }
+  return dataDirectory;
+}
+
+void setDataDirectory(const File &directory) { dataDirectory = directory; }
+
+bool isUpdatingGoldens() { return isUpdatingGoldenRenders; }
+
+void setUpdatingGoldens(bool shouldUpdate) {
+  isUpdatingGoldenRenders = shouldUpdate;
+}
+
+File getGoldenFile(const File &midiFile, double sampleRate) {
+  return getDataDirectory()
+      .getChildFile("Golden")
+      .getChildFile(midiFile.getFileNameWithoutExtension() + "_" +
+                    String(roundToInt(sampleRate)) + ".wav");
+}
+
+bool readGolden(const File &goldenFile, AudioBuffer<float> &golden) {
+  WavAudioFormat format;
+  std::unique_ptr<AudioFormatReader> reader(
+      format.createReaderFor(new FileInputStream(goldenFile), true));
+  if (reader == nullptr || reader->numChannels != 1) {
+    return false;
+  }
+  golden.setSize(1, static_cast<int>(reader->lengthInSamples));
+  reader->read(&golden, 0, golden.getNumSamples(), 0, true, false);
+  return true;
+}
+
+std::vector<TimedMessage> readMidiFile(const File &midiFile,
+                                       double sampleRate) {
+  MidiMessageSequence midi;
+  if (!PianoMannOfflineRenderer::readMidiFile(midiFile, midi)) {
+    return {};
+  }
+  std::vector<TimedMessage> messages;
+  for (const auto *holder : midi) {
+    const auto &message = holder->message;
+    if (message.getChannel() == 0) {
+      continue;
+    }
+    messages.push_back(
+        {jmax(int64(0), static_cast<int64>(
+                            std::llround(message.getTimeStamp() * sampleRate))),
+         message});
+  }
+  return messages;
+}
+
+std::unique_ptr<PianoMannAudioProcessor>
+createPreparedProcessor(double sampleRate, int blockSize, int qualityTier) {
+  auto processor = std::make_unique<PianoMannAudioProcessor>();
+  processor->setPinnedQualityTier(qualityTier);
+  processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+  processor->prepareToPlay(sampleRate, blockSize);
+  while (!processor->isBackgroundPreparationFinished()) {
+    Thread::sleep(1);
+  }
+  return processor;
+}
+
+AudioBuffer<float> render(PianoMannAudioProcessor &processor,
+                          const std::vector<TimedMessage> &messages,
+                          int blockSize, int numSamples) {
+  const auto numChannels = jmax(processor.getTotalNumInputChannels(),
+                                processor.getTotalNumOutputChannels());
+  AudioBuffer<float> output(numChannels, numSamples);
+  AudioBuffer<float> block(numChannels, blockSize);
+  MidiBuffer midi;
+  size_t nextMessage = 0;
+  for (auto startSample = 0; startSample < numSamples;
+       startSample += blockSize) {
+    const auto numBlockSamples = jmin(blockSize, numSamples - startSample);
+    AudioBuffer<float> hostBlock(block.getArrayOfWritePointers(), numChannels,
+                                 numBlockSamples);
+    midi.clear();
+    for (; nextMessage < messages.size() &&
+           messages[nextMessage].samplePosition <
+               startSample + numBlockSamples;
+         ++nextMessage) {
+      midi.addEvent(messages[nextMessage].message,
+                    static_cast<int>(messages[nextMessage].samplePosition -
+                                     startSample));
+    }
+    processor.processBlock(hostBlock, midi);
+    for (auto channel = 0; channel < numChannels; ++channel) {
+      output.copyFrom(channel, startSample, hostBlock, channel, 0,
+                      numBlockSamples);
+    }
+  }
+  return output;
+}
+
+float getMaxDifference(const AudioBuffer<float> &a,
+                       const AudioBuffer<float> &b) {
+  jassert(a.getNumChannels() == b.getNumChannels() &&
+          a.getNumSamples() == b.getNumSamples());
+  auto maxDifference = 0.f;
+  for (auto channel = 0; channel < a.getNumChannels(); ++channel) {
+    const auto *aSamples = a.getReadPointer(channel);
+    const auto *bSamples = b.getReadPointer(channel);
+    for (auto sample = 0; sample < a.getNumSamples(); ++sample) {
+      maxDifference =
+          jmax(maxDifference, std::abs(aSamples[sample] - bSamples[sample]));
+    }
+  }
+  return maxDifference;
+}
+
+AudioBuffer<float> referToChannel(const AudioBuffer<float> &buffer,
+                                  int channel) {
+  return AudioBuffer<float>(
+      const_cast<float *const *>(buffer.getArrayOfReadPointers()) + channel, 1,
+      buffer.getNumSamples());
+}
+} // namespace PianoMannTestHelpers
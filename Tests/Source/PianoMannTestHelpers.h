@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    PianoMannTestHelpers.h
+    Created: 20 Oct 2026 2:14:37pm
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PluginProcessor.h"
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+/**
+ * Drives `PianoMannAudioProcessor` the way a host would, for the tests. See `Main.cpp`.
+ */
+namespace PianoMannTestHelpers {
+/**
+ * The category every PianoMann test registers under.
+ */
+constexpr auto kCategory = "PianoMann";
+
+/**
+ * The `Tests/Data` folder, found by walking up from the test runner, or the folder given with
+ * `--data`.
+ */
+File getDataDirectory();
+void setDataDirectory(const File &directory);
+
+/**
+ * Whether the regression tests should write their golden renders instead of checking against
+ * them, as asked for with `--update-goldens`.
+ */
+bool isUpdatingGoldens();
+void setUpdatingGoldens(bool shouldUpdate);
+
+/**
+ * Goldens carry over between compilers and CPUs, whose maths libraries and fused multiply-adds
+ * round differently, see `PianoMannDspKernels`.
+ */
+constexpr auto kGoldenTolerance = 1.0e-3f;
+
+/**
+ * The golden render of a MIDI file in `Data/Golden`. Goldens hold a single channel: the synth
+ * renders the same signal to every channel.
+ */
+File getGoldenFile(const File &midiFile, double sampleRate);
+bool readGolden(const File &goldenFile, AudioBuffer<float> &golden);
+
+struct TimedMessage {
+  int64 samplePosition;
+  MidiMessage message;
+};
+
+/**
+ * The channel messages of a MIDI file by sample, or none if it cannot be read.
+ */
+std::vector<TimedMessage> readMidiFile(const File &midiFile, double sampleRate);
+
+/**
+ * An instance prepared at `sampleRate` and `blockSize` with its strings built and its quality tier
+ * pinned, so the output depends on neither the machine's speed nor the background thread.
+ */
+std::unique_ptr<PianoMannAudioProcessor>
+createPreparedProcessor(double sampleRate, int blockSize, int qualityTier = 0);
+
+/**
+ * Plays `messages` through `processor` in blocks of `blockSize`, the last one cut short to end at
+ * `numSamples`.
+ */
+AudioBuffer<float> render(PianoMannAudioProcessor &processor,
+                          const std::vector<TimedMessage> &messages,
+                          int blockSize, int numSamples);
+
+/**
+ * The largest difference between two renders of the same length, over every channel.
+ */
+float getMaxDifference(const AudioBuffer<float> &a, const AudioBuffer<float> &b);
+
+/**
+ * Channel `channel` of `buffer`, referring to its samples.
+ */
+AudioBuffer<float> referToChannel(const AudioBuffer<float> &buffer,
+                                  int channel);
+} // namespace PianoMannTestHelpers
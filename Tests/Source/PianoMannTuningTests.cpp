@@ -0,0 +1,266 @@
+/*
+  ==============================================================================
+
+    PianoMannTuningTests.cpp
+    Created: 22 Oct 2026 10:04:17am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTestHelpers.h"
+#include "PianoMannTuning.h"
+#include <cmath>
+
+namespace {
+/**
+ * Twelve-tone equal temperament as a Scala file would have it, comments and all.
+ */
+const char *const kEqualTemperamentScale = "! 12-tet.scl\n"
+                                           "!\n"
+                                           "12-tone equal temperament\n"
+                                           " 12\n"
+                                           "!\n"
+                                           " 100.0\n 200.0\n 300.0\n"
+                                           " 400.0\n 500.0\n 600.0\n"
+                                           " 700.0\n 800.0\n 900.0\n"
+                                           " 1000.0\n 1100.0\n 2/1\n";
+
+/**
+ * A just pentatonic scale in ratios.
+ */
+const char *const kPentatonicScale = "Just pentatonic\n"
+                                     "5\n"
+                                     "9/8\n5/4\n3/2\n5/3 the major sixth\n2\n";
+
+double getCents(double frequency, double referenceFrequency) {
+  return 1200.0 * std::log2(frequency / referenceFrequency);
+}
+} // namespace
+
+/**
+ * Checks the tunings built in, Scala files with and without keyboard mappings, and tunings saved
+ * with the plugin's state.
+ */
+class PianoMannTuningTests : public UnitTest {
+public:
+  PianoMannTuningTests()
+      : UnitTest("Tuning", PianoMannTestHelpers::kCategory) {}
+
+  void runTest() override {
+    beginTest("Equal temperament");
+    const auto equalTemperament = PianoMannTuning::equalTemperament();
+    expectWithinAbsoluteError(equalTemperament.getFrequency(69), 440.0, 1.0e-9,
+                              "A4");
+    expectWithinAbsoluteError(equalTemperament.getFrequency(57), 220.0, 1.0e-9,
+                              "A3");
+
+    beginTest("Stretched tuning");
+    expectSameFrequencies(PianoMannTuning::stretched(0.0), equalTemperament,
+                          "Unstretched");
+    const auto stretched = PianoMannTuning::stretched();
+    for (auto note = 57; note <= 69; ++note) {
+      expectWithinAbsoluteError(
+          getCents(stretched.getFrequency(note),
+                   equalTemperament.getFrequency(note)),
+          0.0, 1.0e-6, "Note " + String(note) + " is not tempered equally");
+    }
+    // Each octave out from the tempered one is stretched further.
+    auto isStretchedOutwards = true;
+    for (auto note = 70; note < PianoMannTuning::kNumNotes; ++note) {
+      isStretchedOutwards =
+          isStretchedOutwards && getStretchCents(stretched, note) >
+                                     getStretchCents(stretched, note - 12);
+    }
+    for (auto note = 56; note >= 0; --note) {
+      isStretchedOutwards =
+          isStretchedOutwards && getStretchCents(stretched, note) <
+                                     getStretchCents(stretched, note + 12);
+    }
+    expect(isStretchedOutwards, "The stretch does not grow outwards");
+    constexpr auto kNoteA0 = 21, kNoteC8 = 108;
+    expectGreaterThan(getStretchCents(stretched, kNoteC8), 15.0, "C8");
+    expectLessThan(getStretchCents(stretched, kNoteC8), 40.0, "C8");
+    expectLessThan(getStretchCents(stretched, kNoteA0), -5.0, "A0");
+    expectGreaterThan(getStretchCents(stretched, kNoteA0), -15.0, "A0");
+    expectGreaterThan(
+        getStretchCents(PianoMannTuning::stretched(2.0), kNoteC8),
+        getStretchCents(stretched, kNoteC8), "Doubled stretch");
+
+    beginTest("Scala scale");
+    {
+      PianoMannTuning tuning;
+      expect(PianoMannTuning::parseScala(kEqualTemperamentScale, "", tuning)
+                 .wasOk(),
+             "The scale was rejected");
+      expectSameFrequencies(tuning, equalTemperament, "12-tone scale");
+      expectEquals(tuning.getName(), String("12-tone equal temperament"));
+    }
+    {
+      // Degree 0 is middle C, and the degrees below it are in the period
+      // below.
+      PianoMannTuning tuning;
+      expect(PianoMannTuning::parseScala(kPentatonicScale, "", tuning).wasOk(),
+             "The scale was rejected");
+      const auto middleC = equalTemperament.getFrequency(60);
+      expectFrequency(tuning, 60, middleC);
+      expectFrequency(tuning, 61, middleC * 9.0 / 8.0);
+      expectFrequency(tuning, 64, middleC * 5.0 / 3.0);
+      expectFrequency(tuning, 65, middleC * 2.0);
+      expectFrequency(tuning, 59, middleC * 5.0 / 6.0);
+      expectFrequency(tuning, 55, middleC / 2.0);
+      expectFrequency(tuning, 54, middleC * 5.0 / 12.0);
+    }
+
+    beginTest("Keyboard mapping");
+    {
+      // Consecutive keys on consecutive degrees, with A3 the reference.
+      const auto keyboardMapping = "! linear.kbm\n"
+                                   "0\n0\n127\n60\n57\n200.0\n0\n";
+      PianoMannTuning tuning;
+      expect(PianoMannTuning::parseScala(kPentatonicScale, keyboardMapping,
+                                         tuning)
+                 .wasOk(),
+             "The mapping was rejected");
+      // A3 is three keys and one period below middle C, on degree 2 of the
+      // period below.
+      const auto middleC = 200.0 / (5.0 / 4.0 / 2.0);
+      expectFrequency(tuning, 57, 200.0);
+      expectFrequency(tuning, 60, middleC);
+      expectFrequency(tuning, 62, middleC * 5.0 / 4.0);
+      expectFrequency(tuning, 58, middleC * 3.0 / 2.0 / 2.0);
+    }
+    {
+      // A pattern of seven keys with gaps, within the range of a piano.
+      const auto keyboardMapping = "! gaps.kbm\n"
+                                   "7 ! size\n"
+                                   "21 ! first note\n"
+                                   "108 ! last note\n"
+                                   "60 ! middle note\n"
+                                   "69 ! reference note\n"
+                                   "432.0 ! reference frequency\n"
+                                   "12 ! octave degree\n"
+                                   "! mapping\n"
+                                   "0\nx\n2\n4\nX\n7\n9\n";
+      PianoMannTuning tuning;
+      expect(PianoMannTuning::parseScala(kEqualTemperamentScale,
+                                         keyboardMapping, tuning)
+                 .wasOk(),
+             "The mapping was rejected");
+      // Key 69 is in the pattern above middle C, on degree 12 + 2.
+      const auto getFrequency = [](int degree) {
+        return 432.0 * std::pow(2.0, (degree - 14) / 12.0);
+      };
+      expectFrequency(tuning, 69, 432.0);
+      expectFrequency(tuning, 60, getFrequency(0));
+      expectFrequency(tuning, 62, getFrequency(2));
+      expectFrequency(tuning, 66, getFrequency(9));
+      expectFrequency(tuning, 67, getFrequency(12));
+      // Keys below middle C wrap into the pattern below.
+      expectFrequency(tuning, 59, getFrequency(-3));
+      expectFrequency(tuning, 53, getFrequency(-12));
+      expectFrequency(tuning, 25, getFrequency(-60));
+      // Unmapped keys and keys out of range keep equal temperament.
+      for (const auto note : {61, 64, 54, 57, 20, 109, 127}) {
+        expectFrequency(tuning, note, equalTemperament.getFrequency(note));
+      }
+    }
+    {
+      const auto keyboardMapping = "2\n0\n127\n60\n61\n440.0\n12\n0\nx\n";
+      auto tuning = PianoMannTuning::stretched();
+      expect(PianoMannTuning::parseScala(kEqualTemperamentScale,
+                                         keyboardMapping, tuning)
+                 .failed(),
+             "An unmapped reference key was accepted");
+      expectSameFrequencies(tuning, PianoMannTuning::stretched(),
+                            "Rejected mapping");
+    }
+
+    beginTest("Malformed Scala files");
+    for (const auto scale :
+         {"", "No number of pitches\n", "Not a number\nfive\n100.0\n",
+          "Too few pitches\n3\n100.0\n200.0\n",
+          "No pitches\n0\n",
+          "Unreadable pitch\n2\n100.0\nhalf\n",
+          "Unreadable cents\n2\n1.0.0x\n2/1\n",
+          "Negative ratio\n2\n-3/2\n2/1\n",
+          "Zero ratio\n2\n0/2\n2/1\n",
+          "Infinite ratio\n2\n3/0\n2/1\n",
+          "Unreadable ratio\n2\n3/b\n2/1\n"}) {
+      expectRejected(scale, "", "Scale \"" + String(scale) + "\"");
+    }
+    for (const auto keyboardMapping :
+         {"12\n0\n127\n60\n69\n", "-1\n0\n127\n60\n69\n440.0\n12\n",
+          "99999\n0\n127\n60\n69\n440.0\n12\n",
+          "1\n0\n127\n60\n69\n0.0\n12\n0\n",
+          "1\n0\n127\n60\n69\nfast\n12\n0\n",
+          "1\nfirst\n127\n60\n69\n440.0\n12\n0\n",
+          "1\n0\n127\n60\n69\n440.0\n12\n-2\n",
+          "1\n0\n127\n60\n69\n440.0\n12\ny\n"}) {
+      expectRejected(kEqualTemperamentScale, keyboardMapping,
+                     "Mapping \"" + String(keyboardMapping) + "\"");
+    }
+
+    beginTest("Saved tunings");
+    // Frequencies are saved to a millionth of a hertz, which is the most
+    // error in the lowest notes.
+    constexpr auto kSavedCents = 1.0e-3;
+    for (const auto &tuning :
+         {equalTemperament, stretched, parseScale(kPentatonicScale)}) {
+      const auto restored = PianoMannTuning::fromString(tuning.toString());
+      expectSameFrequencies(restored, tuning, tuning.getName(), kSavedCents);
+      expectEquals(restored.getName(), tuning.getName());
+    }
+    StringArray unusableTexts{"", "Name only", "Too few\n440.0 880.0"};
+    unusableTexts.add(
+        "Zero\n" + String::repeatedString("0.0 ", PianoMannTuning::kNumNotes));
+    unusableTexts.add("Unreadable\n" +
+                      String::repeatedString("a ", PianoMannTuning::kNumNotes));
+    for (const auto &text : unusableTexts) {
+      expectSameFrequencies(PianoMannTuning::fromString(text),
+                            equalTemperament,
+                            "Restored \"" + text.upToFirstOccurrenceOf(
+                                                 "\n", false, false) +
+                                "\"");
+    }
+  }
+
+private:
+  static double getStretchCents(const PianoMannTuning &tuning, int note) {
+    return getCents(tuning.getFrequency(note),
+                    PianoMannTuning::equalTemperament().getFrequency(note));
+  }
+
+  static PianoMannTuning parseScale(const String &scale) {
+    PianoMannTuning tuning;
+    PianoMannTuning::parseScala(scale, "", tuning);
+    return tuning;
+  }
+
+  void expectFrequency(const PianoMannTuning &tuning, int note,
+                       double frequency) {
+    expectWithinAbsoluteError(getCents(tuning.getFrequency(note), frequency),
+                              0.0, 1.0e-6, "Note " + String(note));
+  }
+
+  void expectSameFrequencies(const PianoMannTuning &tuning,
+                             const PianoMannTuning &expected,
+                             const String &what, double maxError = 1.0e-6) {
+    auto maxCents = 0.0;
+    for (auto note = 0; note < PianoMannTuning::kNumNotes; ++note) {
+      maxCents = jmax(maxCents, std::abs(getCents(tuning.getFrequency(note),
+                                                  expected.getFrequency(note))));
+    }
+    expectWithinAbsoluteError(maxCents, 0.0, maxError, what);
+  }
+
+  void expectRejected(const String &scale, const String &keyboardMapping,
+                      const String &what) {
+    auto tuning = PianoMannTuning::stretched();
+    expect(PianoMannTuning::parseScala(scale, keyboardMapping, tuning).failed(),
+           what + " was accepted");
+    expect(tuning == PianoMannTuning::stretched(), what + " changed the tuning");
+  }
+};
+
+static PianoMannTuningTests tuningTests;
@@ -0,0 +1,246 @@
+/*
+  ==============================================================================
+
+    PianoMannVoicingTests.cpp
+    Created: 21 Oct 2026 9:12:40am
+    Author:  Pranjal Raihan
+
+  ==============================================================================
+*/
+
+#include "PianoMannTestHelpers.h"
+#include "PianoMannVoicing.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace {
+/**
+ * The sizes of the header and the notes of a voicing file, see `PianoMannVoicing`.
+ */
+constexpr size_t kHeaderSize = 32;
+constexpr size_t kNotesSize = PianoMannVoicing::kNumNotes * 3 * sizeof(float);
+constexpr auto kSampleRate = 48000.0;
+constexpr auto kBlockSize = 512;
+} // namespace
+
+/**
+ * Checks that voicings out of range are turned away, whether they come as JSON or are made in
+ * memory as a file would be, and that voicing files load back as written and sound the same.
+ */
+class PianoMannVoicingTests : public UnitTest {
+public:
+  PianoMannVoicingTests()
+      : UnitTest("Voicing", PianoMannTestHelpers::kCategory) {}
+
+  void runTest() override {
+    beginTest("Notes out of range");
+    constexpr auto kNote = 60;
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    const auto denormal = std::numeric_limits<float>::denorm_min();
+    for (const auto sustain : {0.f, -0.5f, 1.f, nan, denormal}) {
+      auto description = PianoMannVoicing::describeBuiltIn();
+      description.notes[kNote].sustain = sustain;
+      expectRejected(description, "A sustain of " + String(sustain));
+    }
+    for (const auto weight : {0.f, 1.5f, nan, denormal}) {
+      auto description = PianoMannVoicing::describeBuiltIn();
+      description.notes[kNote].weightedAverageFilter = weight;
+      expectRejected(description, "A filter weight of " + String(weight));
+    }
+
+    beginTest("Notes at the edge of the range");
+    auto description = PianoMannVoicing::describeBuiltIn();
+    description.notes[kNote].sustain = 1.0e-3f;
+    description.notes[kNote].weightedAverageFilter = 1.f;
+    std::shared_ptr<const PianoMannVoicing> voicing;
+    expect(PianoMannVoicing::create(description, voicing).wasOk(),
+           "The voicing was rejected");
+
+    const auto directory =
+        File::getSpecialLocation(File::tempDirectory)
+            .getNonexistentChildFile("PianoMannVoicingTests", "", false);
+    expect(directory.createDirectory().wasOk(),
+           "Cannot create " + directory.getFullPathName());
+    const auto builtInFile = directory.getChildFile("BuiltIn.pmvoicing");
+    testFile(builtInFile);
+    testMalformedFiles(builtInFile);
+    testGoldens(builtInFile);
+    directory.deleteRecursively();
+  }
+
+private:
+  void testFile(const File &file) {
+    beginTest("Voicing files");
+    const auto builtIn = PianoMannVoicing::getBuiltIn();
+    expect(PianoMannVoicing::write(PianoMannVoicing::describeBuiltIn(), file)
+               .wasOk(),
+           "Cannot write " + file.getFullPathName());
+    std::shared_ptr<const PianoMannVoicing> voicing;
+    expect(PianoMannVoicing::load(file, voicing).wasOk(),
+           "Cannot load " + file.getFullPathName());
+    if (voicing == nullptr) {
+      return;
+    }
+    expect(voicing->getFile() == file, "The file was not kept");
+    expectSameDescription(voicing->describe(), builtIn->describe());
+    // 32kHz has no table, so its post filter is designed as it is for the
+    // built-in voicing.
+    for (const auto sampleRate : {44100.0, 48000.0, 96000.0, 32000.0}) {
+      for (const auto isFullOrder : {true, false}) {
+        expectSameCascade(
+            voicing->getPostFilterCascade(sampleRate, isFullOrder),
+            builtIn->getPostFilterCascade(sampleRate, isFullOrder),
+            String(sampleRate) + " Hz" + (isFullOrder ? "" : " in economy"));
+      }
+    }
+
+    std::shared_ptr<const PianoMannVoicing> sharedVoicing;
+    expect(PianoMannVoicing::load(file, sharedVoicing).wasOk(),
+           "Cannot load " + file.getFullPathName() + " again");
+    expect(sharedVoicing == voicing, "The unchanged file was mapped again");
+  }
+
+  void testMalformedFiles(const File &file) {
+    beginTest("Malformed voicing files");
+    MemoryBlock image;
+    expect(file.loadFileAsData(image), "Cannot read " + file.getFullPathName());
+    if (image.getSize() <= kHeaderSize + kNotesSize) {
+      expect(false, "The voicing file has no tables");
+      return;
+    }
+
+    for (const auto size :
+         {size_t(3), kHeaderSize - 1, kHeaderSize,
+          kHeaderSize + kNotesSize / 2, kHeaderSize + kNotesSize,
+          image.getSize() - 1}) {
+      expectLoadFails(file.getSiblingFile("Truncated" + String(int64(size)) +
+                                          ".pmvoicing"),
+                      MemoryBlock(image.getData(), size),
+                      "Truncated to " + String(int64(size)) + " bytes");
+    }
+    auto extended = image;
+    extended.append("\0", 1);
+    expectLoadFails(file.getSiblingFile("Extended.pmvoicing"), extended,
+                    "An extra byte");
+
+    auto wrongMagic = image;
+    std::memcpy(wrongMagic.getData(), "PMVX", 4);
+    expectLoadFails(file.getSiblingFile("WrongMagic.pmvoicing"), wrongMagic,
+                    "A wrong magic");
+    auto wrongVersion = image;
+    constexpr int32 kFutureVersion = 2;
+    std::memcpy(static_cast<char *>(wrongVersion.getData()) + 4,
+                &kFutureVersion, sizeof(kFutureVersion));
+    expectLoadFails(file.getSiblingFile("WrongVersion.pmvoicing"),
+                    wrongVersion, "A wrong version");
+  }
+
+  /**
+   * The built-in voicing read back from a file sounds like the goldens, which are rendered with it
+   * compiled in, see `PianoMannRegressionTests`.
+   */
+  void testGoldens(const File &file) {
+    beginTest("Voicing files sound like the goldens");
+    if (PianoMannTestHelpers::isUpdatingGoldens()) {
+      logMessage("Skipped while updating the goldens");
+      return;
+    }
+    auto midiFiles = PianoMannTestHelpers::getDataDirectory()
+                         .getChildFile("Midi")
+                         .findChildFiles(File::findFiles, false, "*.mid");
+    midiFiles.sort();
+    expect(!midiFiles.isEmpty(), "No MIDI files");
+    for (const auto &midiFile : midiFiles) {
+      const auto goldenFile =
+          PianoMannTestHelpers::getGoldenFile(midiFile, kSampleRate);
+      AudioBuffer<float> golden;
+      if (!PianoMannTestHelpers::readGolden(goldenFile, golden)) {
+        expect(false, "Could not read " + goldenFile.getFullPathName());
+        continue;
+      }
+
+      PianoMannAudioProcessor processor;
+      processor.setPinnedQualityTier(0);
+      expect(processor.setVoicingFile(file).wasOk(),
+             "Cannot voice the piano from " + file.getFullPathName());
+      processor.setRateAndBufferSizeDetails(kSampleRate, kBlockSize);
+      processor.prepareToPlay(kSampleRate, kBlockSize);
+      while (!processor.isBackgroundPreparationFinished()) {
+        Thread::sleep(1);
+      }
+      const auto output = PianoMannTestHelpers::render(
+          processor, PianoMannTestHelpers::readMidiFile(midiFile, kSampleRate),
+          kBlockSize, golden.getNumSamples());
+      const auto difference = PianoMannTestHelpers::getMaxDifference(
+          PianoMannTestHelpers::referToChannel(output, 0), golden);
+      expect(difference <= PianoMannTestHelpers::kGoldenTolerance,
+             midiFile.getFileName() + " differs from " +
+                 goldenFile.getFileName() + " by " + String(difference));
+    }
+  }
+
+  void expectLoadFails(const File &file, const MemoryBlock &image,
+                       const String &what) {
+    expect(file.replaceWithData(image.getData(), image.getSize()),
+           "Cannot write " + file.getFullPathName());
+    const auto builtIn = PianoMannVoicing::getBuiltIn();
+    auto voicing = builtIn;
+    expect(PianoMannVoicing::load(file, voicing).failed(),
+           what + " was loaded");
+    expect(voicing == builtIn, what + " replaced the voicing");
+  }
+
+  void expectSameDescription(const PianoMannVoicing::Description &description,
+                             const PianoMannVoicing::Description &expected) {
+    auto isSame = true;
+    for (size_t index = 0; index < description.notes.size(); ++index) {
+      const auto &note = description.notes[index];
+      const auto &expectedNote = expected.notes[index];
+      isSame = isSame &&
+               note.weightedAverageFilter ==
+                   expectedNote.weightedAverageFilter &&
+               note.sustain == expectedNote.sustain &&
+               note.damperDecaySeconds == expectedNote.damperDecaySeconds;
+    }
+    expect(isSame, "The notes differ");
+    expectEquals(description.postFilter.cutoffFrequency,
+                 expected.postFilter.cutoffFrequency, "Cut-off");
+    expectEquals(description.postFilter.fullOrder,
+                 expected.postFilter.fullOrder, "Full order");
+    expectEquals(description.postFilter.economyOrder,
+                 expected.postFilter.economyOrder, "Economy order");
+  }
+
+  void expectSameCascade(const PianoMannDspKernels::BiquadCascade &cascade,
+                         const PianoMannDspKernels::BiquadCascade &expected,
+                         const String &what) {
+    expectEquals(cascade.numSections, expected.numSections, what);
+    auto isSame = cascade.numSections == expected.numSections;
+    for (auto section = 0; isSame && section < cascade.numSections;
+         ++section) {
+      isSame = cascade.b0[section] == expected.b0[section] &&
+               cascade.b1[section] == expected.b1[section] &&
+               cascade.b2[section] == expected.b2[section] &&
+               cascade.a1[section] == expected.a1[section] &&
+               cascade.a2[section] == expected.a2[section];
+    }
+    expect(isSame, what + " has different coefficients");
+  }
+
+  void expectRejected(const PianoMannVoicing::Description &description,
+                      const String &what) {
+    std::shared_ptr<const PianoMannVoicing> voicing;
+    expect(PianoMannVoicing::create(description, voicing).failed(),
+           what + " was accepted");
+    expect(voicing == nullptr, what + " made a voicing");
+    PianoMannVoicing::Description parsed;
+    expect(
+        PianoMannVoicing::parseJson(PianoMannVoicing::toJson(description), parsed)
+            .failed(),
+        what + " was accepted from JSON");
+  }
+};
+
+static PianoMannVoicingTests voicingTests;